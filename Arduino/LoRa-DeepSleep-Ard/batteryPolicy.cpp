@@ -0,0 +1,50 @@
+/**
+ * @file batteryPolicy.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Battery level dependent send interval, TX power and RX duty cycle
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "batteryPolicy.h"
+
+/**
+ * Settings per battery level for a LiPo cell.
+ * The lower the battery, the less often we send, with less power and without listening.
+ */
+const batt_policy_t battPolicy[BATT_LEVEL_NUM] = {
+	{3700, 1, 22, true},  // BATT_LEVEL_FULL
+	{3500, 2, 17, true},  // BATT_LEVEL_OK
+	{3300, 4, 14, false}, // BATT_LEVEL_LOW
+	{0, 8, 10, false},	  // BATT_LEVEL_CRITICAL
+};
+
+/**
+ * @brief Get the battery level for a voltage.
+ * Going down a level happens immediately, going up to a level
+ * needs BATT_HYSTERESIS_MV more than the limit of that level.
+ *
+ * @param voltage battery voltage in mV
+ * @param lastLevel the level of the previous measurement
+ * @return uint8_t BATT_LEVEL_xxx
+ */
+uint8_t battLevel(uint16_t voltage, uint8_t lastLevel)
+{
+	uint8_t level = 0;
+	while ((level < BATT_LEVEL_NUM - 1) && (voltage < battPolicy[level].minVoltage))
+	{
+		level++;
+	}
+
+	if ((level < lastLevel) && (lastLevel < BATT_LEVEL_NUM))
+	{
+		// Only go up to a level if we are clearly above its limit
+		while ((level < lastLevel) && (voltage < battPolicy[level].minVoltage + BATT_HYSTERESIS_MV))
+		{
+			level++;
+		}
+	}
+	return level;
+}
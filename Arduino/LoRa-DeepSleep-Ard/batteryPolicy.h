@@ -0,0 +1,43 @@
+/**
+ * @file batteryPolicy.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Battery level dependent send interval, TX power and RX duty cycle
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef BATTERY_POLICY_H
+#define BATTERY_POLICY_H
+
+#include <stdint.h>
+
+// Battery levels
+#define BATT_LEVEL_FULL 0
+#define BATT_LEVEL_OK 1
+#define BATT_LEVEL_LOW 2
+#define BATT_LEVEL_CRITICAL 3
+#define BATT_LEVEL_NUM 4
+
+/** Voltage change needed to go back to a higher level, avoids toggling */
+#define BATT_HYSTERESIS_MV 50
+
+/** Node settings for a battery level */
+typedef struct
+{
+	/** Lower voltage limit of the level in mV */
+	uint16_t minVoltage;
+	/** Multiplier for SLEEP_TIME */
+	uint8_t sleepMultiplier;
+	/** TX power in dBm */
+	int8_t txPower;
+	/** RX duty cycle enabled */
+	bool rxDutyCycle;
+} batt_policy_t;
+
+extern const batt_policy_t battPolicy[BATT_LEVEL_NUM];
+
+uint8_t battLevel(uint16_t voltage, uint8_t lastLevel);
+
+#endif
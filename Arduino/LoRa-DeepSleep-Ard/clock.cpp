@@ -0,0 +1,169 @@
+/**
+ * @file clock.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Drift corrected clock for the job scheduler and network time, disciplined by time reference downlinks
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/** Drift of the 32.768kHz clock behind millis() and the software timers.
+ * Updated by clockReference() in the radio task and read by the loop task, all
+ * accesses of the estimate and the offset are inside a critical section. */
+clock_drift_t clockDrift;
+
+/** Network time minus drift corrected time */
+static uint32_t networkOffset = 0;
+/** A time reference was received, the network time is valid */
+bool clockSynced = false;
+/** clockNow() of the last time reference */
+static uint32_t lastSync = 0;
+/** millis() at the end of the last uplink */
+static uint32_t lastTxDone = 0;
+/** lastTxDone is valid */
+static bool txDoneValid = false;
+
+/**
+ * @brief Start the corrected clock at the local time
+ *
+ */
+void clockInit(void)
+{
+	driftInit(&clockDrift, millis());
+}
+
+/**
+ * @brief Drift corrected time, the time base of the job scheduler
+ *
+ * @return uint32_t time in ms
+ */
+uint32_t clockNow(void)
+{
+	taskENTER_CRITICAL();
+	uint32_t now = driftNow(&clockDrift, millis());
+	taskEXIT_CRITICAL();
+	return now;
+}
+
+/**
+ * @brief Time of the network, the clock of the sender of the time references
+ *
+ * @return uint32_t time in ms, the corrected clock until the first time reference
+ */
+uint32_t clockNetworkTime(void)
+{
+	taskENTER_CRITICAL();
+	uint32_t time = driftNow(&clockDrift, millis()) + networkOffset;
+	taskEXIT_CRITICAL();
+	return time;
+}
+
+/**
+ * @brief Check if the node should ask for a time reference in its next uplink
+ *
+ * @return true if there was no time reference for CLOCK_SYNC_MAX_AGE
+ */
+bool clockNeedsSync(void)
+{
+	taskENTER_CRITICAL();
+	bool needed = !clockSynced || ((uint32_t)(driftNow(&clockDrift, millis()) - lastSync) > CLOCK_SYNC_MAX_AGE);
+	taskEXIT_CRITICAL();
+	return needed;
+}
+
+/**
+ * @brief Software timer period for an interval of the corrected clock
+ *
+ * @param interval interval in ms
+ * @return uint32_t timer period in ms
+ */
+uint32_t clockTimerPeriod(uint32_t interval)
+{
+	taskENTER_CRITICAL();
+	uint32_t period = driftLocalInterval(&clockDrift, interval);
+	taskEXIT_CRITICAL();
+	return period;
+}
+
+/**
+ * @brief Guard time for a receive window that is interval ms after the last synchronisation
+ *
+ * @param interval time until the window in ms
+ * @return uint32_t guard time on each side of the window in ms
+ */
+uint32_t clockGuard(uint32_t interval)
+{
+	taskENTER_CRITICAL();
+	uint32_t guard = driftGuard(&clockDrift, interval, CLOCK_MIN_GUARD);
+	taskEXIT_CRITICAL();
+	return guard;
+}
+
+/**
+ * @brief A pair of local time and network time for the same moment
+ *
+ * @param local millis() of the moment
+ * @param reference network time of the moment in ms
+ */
+void clockReference(uint32_t local, uint32_t reference)
+{
+	// Runs in the radio task, the loop task must not see a half updated estimate
+	taskENTER_CRITICAL();
+	uint8_t result = driftUpdate(&clockDrift, local, reference);
+	if (result != DRIFT_REJECTED)
+	{
+		// The drift estimate continues without steps, the offset takes the step
+		uint32_t corrected = driftNow(&clockDrift, local);
+		networkOffset = reference - corrected;
+		lastSync = corrected;
+		clockSynced = true;
+	}
+	taskEXIT_CRITICAL();
+
+	// Only this task changes the estimate, it can read it without the critical section
+	if (result == DRIFT_REJECTED)
+	{
+		myLog_w("Time reference %ld does not fit the clock, ignored", (long)reference);
+	}
+	else if (result == DRIFT_MEASURED)
+	{
+		myLog_d("Clock drift %ldppb spread %ldppb, guard %ldms per send interval",
+				(long)clockDrift.drift, (long)clockDrift.spread, (long)clockGuard(SLEEP_TIME));
+	}
+}
+
+/**
+ * @brief Remember the end of the last uplink for the next ACK
+ *
+ * @param txTime millis() in OnTxDone
+ */
+void clockTxDone(uint32_t txTime)
+{
+	lastTxDone = txTime;
+	txDoneValid = true;
+}
+
+/**
+ * @brief A time reference downlink was received
+ *
+ * @param type TIME_FRAME_BEACON or TIME_FRAME_ACK
+ * @param rxTime millis() when the frame was received, taken at the start of OnRxDone
+ * @param reference time in the frame
+ */
+void clockTimeFrame(uint8_t type, uint32_t rxTime, uint32_t reference)
+{
+	if (type == TIME_FRAME_BEACON)
+	{
+		// The beacon time is the start of the beacon, OnRxDone is called at its end
+		clockReference(rxTime, reference + Radio.TimeOnAir(MODEM_LORA, TIME_FRAME_SIZE));
+	}
+	else if ((type == TIME_FRAME_ACK) && txDoneValid)
+	{
+		// The ACK time is the end of the last uplink at the sender of the ACK
+		clockReference(lastTxDone, reference);
+		txDoneValid = false;
+	}
+}
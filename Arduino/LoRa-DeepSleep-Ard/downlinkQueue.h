@@ -0,0 +1,113 @@
+/**
+ * @file downlinkQueue.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Per node downlink queue of the receiver, sends the commands of a node as one batch into its listen window
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef DOWNLINK_QUEUE_H
+#define DOWNLINK_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nodePayload.h"
+
+/** Nodes the receiver keeps the listen schedule and the commands for */
+#define DOWNLINK_NODES 32
+/** Bytes of queued commands per node, including the size byte of each command */
+#define DOWNLINK_COMMANDS_MAX 64
+/** Largest batch: header, commands and a time reference ACK */
+#define DOWNLINK_BATCH_MAX (DOWNLINK_BATCH_HEADER + DOWNLINK_COMMANDS_MAX + 1 + TIME_FRAME_SIZE)
+/** Longest preamble the SX126x can send, in symbols */
+#define DOWNLINK_PREAMBLE_MAX 0xFFFF
+/** Longest RX duty cycle sleep time of the SX126x in ms, 24 bits of 15.625us */
+#define DOWNLINK_SLEEP_MAX 262143
+
+/**
+ * Listen schedule of the nodes. After an uplink a node starts the RX duty cycle, the first
+ * listen window opens right after the end of the uplink (the ACK window), the next ones
+ * every rxTime + sleepTime times the sleep factor the node sent in the uplink.
+ */
+typedef struct
+{
+	/** Listen time of the RX duty cycle in ms */
+	uint32_t rxTime;
+	/** Sleep time of the RX duty cycle with sleep factor 1 in ms */
+	uint32_t sleepTime;
+	/** Time from the end of the uplink until the node listens in ms, the OnTxDone latency */
+	uint32_t openDelay;
+	/** Preamble time a listen window needs to detect the downlink in ms */
+	uint32_t detectTime;
+	/** Longest time to hold a batch for a listen window in ms, the next uplink of the node has to come sooner */
+	uint32_t maxWait;
+	/** Clock drift of node and receiver together, in ppb */
+	uint32_t drift;
+	/** Guard time for timer resolution and radio start up in ms */
+	uint32_t minGuard;
+	/** LoRa symbol time in us */
+	uint32_t symbolTime;
+	/** Normal preamble length in symbols */
+	uint16_t preambleLength;
+} downlink_window_t;
+
+/** Schedule and queued commands of one node */
+typedef struct
+{
+	uint8_t deviceId;
+	/** Entry in use */
+	bool used;
+	/** An uplink was received, lastUplink is valid */
+	bool known;
+	/** The last uplink asked for a time reference */
+	bool timeRequest;
+	/** RX duty cycle sleep factor from the last uplink, PAYLOAD_RX_UNKNOWN or PAYLOAD_RX_OFF */
+	uint8_t sleepFactor;
+	/** Receiver time at the end of the last uplink in ms */
+	uint32_t lastUplink;
+	/** Commands in batch layout, size byte in front of each */
+	uint8_t commands[DOWNLINK_COMMANDS_MAX];
+	uint8_t size;
+} downlink_node_t;
+
+/** When and how to send the next batch */
+typedef struct
+{
+	/** Index of the node in the queue */
+	uint8_t node;
+	/** Receiver time to start the transmission in ms */
+	uint32_t time;
+	/** Preamble length in symbols */
+	uint16_t preamble;
+	/** Listen window of the node after its last uplink, 0 is the ACK window */
+	uint32_t window;
+} downlink_plan_t;
+
+typedef struct
+{
+	downlink_node_t node[DOWNLINK_NODES];
+	downlink_window_t window;
+	/** Next entry to reuse when the node table is full */
+	uint8_t evict;
+	/** Commands accepted */
+	uint32_t queued;
+	/** Commands rejected, node table or command buffer of the node full */
+	uint32_t rejected;
+	/** Batches sent */
+	uint32_t batches;
+	/** Batches sent with a longer preamble */
+	uint32_t longPreambles;
+} downlink_queue_t;
+
+void downlinkInit(downlink_queue_t *queue, const downlink_window_t *window);
+bool downlinkAdd(downlink_queue_t *queue, uint8_t deviceId, const uint8_t *command, uint8_t length);
+void downlinkUplink(downlink_queue_t *queue, uint8_t deviceId, uint32_t time, bool timeRequest, uint8_t sleepFactor);
+uint32_t downlinkSleepTime(const downlink_window_t *window, uint8_t sleepFactor);
+uint32_t downlinkGuard(const downlink_window_t *window, uint32_t interval);
+bool downlinkPlan(const downlink_queue_t *queue, uint32_t now, downlink_plan_t *plan);
+uint8_t downlinkBuild(downlink_queue_t *queue, const downlink_plan_t *plan, uint8_t *buffer);
+
+#endif
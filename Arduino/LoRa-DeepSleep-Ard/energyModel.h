@@ -0,0 +1,49 @@
+/**
+ * @file energyModel.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Charge accounting per consumer, shared between firmware and host tools
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef ENERGY_MODEL_H
+#define ENERGY_MODEL_H
+
+#include <stdint.h>
+
+// Consumers that are accounted separately
+#define ENERGY_SLEEP 0
+#define ENERGY_MCU 1
+#define ENERGY_RADIO_TX 2
+#define ENERGY_RADIO_RX 3
+#define ENERGY_RADIO_CAD 4
+#define ENERGY_LED 5
+#define ENERGY_SERIAL 6
+#define ENERGY_NUM 7
+
+/** Accumulated time and charge of all consumers */
+typedef struct
+{
+	/** Current of each consumer in uA */
+	uint32_t current[ENERGY_NUM];
+	/** Accumulated on-time of each consumer in ms */
+	uint64_t time[ENERGY_NUM];
+	/** Accumulated charge of each consumer in uA * ms (nC) */
+	uint64_t charge[ENERGY_NUM];
+} energy_model_t;
+
+void energyInit(energy_model_t *model);
+void energySetCurrent(energy_model_t *model, uint8_t consumer, uint32_t current);
+void energyAccount(energy_model_t *model, uint8_t consumer, uint32_t ms);
+uint64_t energyTotalCharge(const energy_model_t *model);
+uint64_t energyTotalTime(const energy_model_t *model, uint8_t consumer);
+uint32_t energyAverageCurrent(const energy_model_t *model, uint64_t elapsed);
+uint32_t energyTxCurrent(int8_t txPower);
+const char *energyName(uint8_t consumer);
+
+/** Convert nC to uAh */
+#define ENERGY_NC_TO_UAH(nc) ((nc) / 3600000ULL)
+
+#endif
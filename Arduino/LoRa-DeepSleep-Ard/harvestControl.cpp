@@ -0,0 +1,115 @@
+/**
+ * @file harvestControl.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Energy neutral duty cycle control for nodes running from solar panel and supercapacitor
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "harvestControl.h"
+
+/**
+ * Steps from most to least energy used.
+ * The send interval, TX power and RX listen ratio are reduced in turns,
+ * RX duty cycle is the first thing that is dropped completely.
+ */
+const harvest_step_t harvestLadder[HARVEST_STEPS] = {
+	{1, 22, 1},
+	{1, 20, 2},
+	{2, 17, 2},
+	{2, 17, 4},
+	{4, 14, 4},
+	{4, 14, 0},
+	{8, 10, 0},
+	{16, 10, 0},
+};
+
+/** Weight of a new sample in the current filters, 1/4 */
+#define HARVEST_FILTER_SHIFT 2
+/** Time in seconds in which the controller tries to bring the storage back to the target voltage */
+#define HARVEST_RECOVERY_TIME 3600
+/** Budget has to differ more than this from the consumption to change the step, in % */
+#define HARVEST_DEADBAND 20
+
+/**
+ * @brief Setup the controller
+ *
+ * @param ctrl the controller
+ * @param capacitance storage capacitance in mF
+ * @param targetVoltage voltage to keep the storage at in mV
+ * @param minVoltage voltage that forces the lowest step in mV
+ */
+void harvestInit(harvest_ctrl_t *ctrl, uint32_t capacitance, uint16_t targetVoltage, uint16_t minVoltage)
+{
+	ctrl->capacitance = capacitance;
+	ctrl->targetVoltage = targetVoltage;
+	ctrl->minVoltage = minVoltage;
+	ctrl->lastVoltage = 0;
+	ctrl->lastConsumed = 0;
+	ctrl->harvestCurrent = 0;
+	ctrl->consumeCurrent = 0;
+	ctrl->step = 0;
+	ctrl->started = false;
+}
+
+/**
+ * @brief Update the controller with a new storage voltage and the
+ * consumed charge from the energy model.
+ * The harvested charge is the change of the stored charge plus
+ * the consumed charge. The budget is the harvested current plus a
+ * correction that moves the storage towards the target voltage.
+ *
+ * @param ctrl the controller
+ * @param voltage storage voltage in mV
+ * @param consumed total consumed charge from the energy model in nC
+ * @param elapsed time since the last update in ms
+ * @return true if the step changed
+ */
+bool harvestUpdate(harvest_ctrl_t *ctrl, uint16_t voltage, uint64_t consumed, uint32_t elapsed)
+{
+	uint8_t oldStep = ctrl->step;
+
+	if (!ctrl->started || (elapsed == 0))
+	{
+		ctrl->started = true;
+		ctrl->lastVoltage = voltage;
+		ctrl->lastConsumed = consumed;
+		return false;
+	}
+
+	// mF * mV = uC = 1000 nC, nC / ms = uA
+	int64_t storedDelta = (int64_t)ctrl->capacitance * ((int32_t)voltage - ctrl->lastVoltage) * 1000;
+	int64_t consumedDelta = (int64_t)(consumed - ctrl->lastConsumed);
+	int32_t harvest = (int32_t)((storedDelta + consumedDelta) / (int64_t)elapsed);
+	int32_t consume = (int32_t)(consumedDelta / (int64_t)elapsed);
+	if (harvest < 0)
+	{
+		harvest = 0;
+	}
+	ctrl->harvestCurrent += (harvest - ctrl->harvestCurrent) >> HARVEST_FILTER_SHIFT;
+	ctrl->consumeCurrent += (consume - ctrl->consumeCurrent) >> HARVEST_FILTER_SHIFT;
+	ctrl->lastVoltage = voltage;
+	ctrl->lastConsumed = consumed;
+
+	if (voltage < ctrl->minVoltage)
+	{
+		ctrl->step = HARVEST_STEPS - 1;
+		return ctrl->step != oldStep;
+	}
+
+	// Charge needed to reach the target voltage, spread over the recovery time
+	int64_t correction = (int64_t)ctrl->capacitance * ((int32_t)voltage - ctrl->targetVoltage) / HARVEST_RECOVERY_TIME;
+	int64_t budget = ctrl->harvestCurrent + correction;
+
+	if ((budget * 100 > (int64_t)ctrl->consumeCurrent * (100 + HARVEST_DEADBAND)) && (ctrl->step > 0))
+	{
+		ctrl->step--;
+	}
+	else if ((budget * 100 < (int64_t)ctrl->consumeCurrent * (100 - HARVEST_DEADBAND)) && (ctrl->step < HARVEST_STEPS - 1))
+	{
+		ctrl->step++;
+	}
+	return ctrl->step != oldStep;
+}
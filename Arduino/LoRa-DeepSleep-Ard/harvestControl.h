@@ -0,0 +1,58 @@
+/**
+ * @file harvestControl.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Energy neutral duty cycle control for nodes running from solar panel and supercapacitor
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HARVEST_CONTROL_H
+#define HARVEST_CONTROL_H
+
+#include <stdint.h>
+
+/** Node settings for one step of the harvesting ladder */
+typedef struct
+{
+	/** Multiplier for SLEEP_TIME */
+	uint8_t sleepMultiplier;
+	/** TX power in dBm */
+	int8_t txPower;
+	/** Multiplier for the RX duty cycle sleep time, 0 switches RX duty cycle off */
+	uint8_t rxSleepFactor;
+} harvest_step_t;
+
+/** Number of steps, step 0 uses most energy */
+#define HARVEST_STEPS 8
+
+extern const harvest_step_t harvestLadder[HARVEST_STEPS];
+
+/** State of the harvesting controller */
+typedef struct
+{
+	/** Storage capacitance in mF */
+	uint32_t capacitance;
+	/** Voltage the controller tries to keep the storage at in mV */
+	uint16_t targetVoltage;
+	/** Voltage below which the node goes straight to the last step in mV */
+	uint16_t minVoltage;
+	/** Storage voltage at the last update in mV */
+	uint16_t lastVoltage;
+	/** Consumed charge from the energy model at the last update in nC */
+	uint64_t lastConsumed;
+	/** Filtered harvested current in uA */
+	int32_t harvestCurrent;
+	/** Filtered consumed current in uA */
+	int32_t consumeCurrent;
+	/** Current step in the ladder */
+	uint8_t step;
+	/** True after the first update */
+	bool started;
+} harvest_ctrl_t;
+
+void harvestInit(harvest_ctrl_t *ctrl, uint32_t capacitance, uint16_t targetVoltage, uint16_t minVoltage);
+bool harvestUpdate(harvest_ctrl_t *ctrl, uint16_t voltage, uint64_t consumed, uint32_t elapsed);
+
+#endif
@@ -17,8 +17,9 @@
 // This function keeps the SX1261/2 chip most of the time in sleep and only wakes up short times
 // to catch incoming data packages
 // See document SX1261_AN1200.36_SX1261-2_RxDutyCycle_V1.0 ==>> https://semtech.my.salesforce.com/sfc/p/#E0000000JelG/a/2R0000001O3w/zsdHpRveb0_jlgJEedwalzsBaBnALfRq_MnJ25M_wtI
-uint32_t duty_cycle_rx_time = 2 * 1024 * 1000 * 15.625;
-uint32_t duty_cycle_sleep_time = 10 * 1024 * 1000 * 15.625;
+// Times are in steps of 15.625us and must fit into 24 bits (max ~262s)
+uint32_t duty_cycle_rx_time = 2 * 1000 * 64;	  // 2s
+uint32_t duty_cycle_sleep_time = 10 * 1000 * 64; // 10s
 
 // LoRa transmission settings
 #define RF_FREQUENCY 923300000	// Hz
@@ -35,6 +36,26 @@ uint32_t duty_cycle_sleep_time = 10 * 1024 * 1000 * 15.625;
 // DIO1 pin on RAK4631
 #define PIN_LORA_DIO_1 47
 
+#if defined(WAKE_PROFILE) || defined(RECEIVER)
+/** DIO1 interrupt handler of the SX126x-Arduino library, it only wakes up the radio task of the library */
+extern void RadioOnDioIrq(void);
+
+/**
+ * @brief DIO1 interrupt. Takes the timestamps for the received frames and the IRQ to callback latency
+ * and hands over to the library, the SPI access and the callbacks run in the radio task of the library.
+ */
+static void radioDio1Irq(void)
+{
+#ifdef RECEIVER
+	receiverIrq();
+#endif
+#ifdef WAKE_PROFILE
+	profileRadioIrq();
+#endif
+	RadioOnDioIrq();
+}
+#endif
+
 // LoRa callbacks
 static RadioEvents_t RadioEvents;
 void OnTxDone(void);
@@ -45,6 +66,7 @@ void OnRxError(void);
 void OnCadDone(bool cadResult);
 
 time_t cadTime;
+time_t txTime;
 time_t channelTimeout;
 uint8_t channelFreeRetryNum = 0;
 
@@ -52,11 +74,118 @@ uint8_t channelFreeRetryNum = 0;
 /** Receiver buffer */
 static uint8_t RcvBuffer[256];
 #endif
-/** Transmit buffer */
-static uint8_t TxdBuffer[256];
+/** Content of the data package */
+static node_payload_t nodeData = {
+	DEVICE_ID, // Device ID
+	0,	 // Lights status
+	0,	 // Lights on/off
+	27,	 // Temperature ones/tens/hundreds
+	35,	 // Temperature tenths/hundredths
+	67,	 // Humidity ones/tens/hundreds
+	55,	 // Humidity tenths/hundredths
+	0x220C, // Light value
+	0x4B00, // Light activation treshold
+	-80, // Strength of last received signal
+	0,	 // Request date/time update
+	0,	 // Flag for secondary light
+	0,	 // Battery voltage in mV
+	0,	 // Sample age, written when the package is sent
+	0};	 // RX sleep factor, written when the package is prepared
+/** Transmit buffers, the next package can be prepared while the radio sends the other one */
+static uint8_t TxdBuffer[2][256];
+/** Size of the package in each transmit buffer, 0 if no package is prepared */
+static uint8_t TxdSize[2] = {0, 0};
+/** clockNow() when the data of each transmit buffer was sampled */
+static uint32_t sampleTime[2];
+/** Buffer for the next package */
+static uint8_t txNext = 0;
+/** Buffer the radio is sending */
+static uint8_t txSend = 0;
+/** Radio is in CAD or TX, settings that need the radio idle wait for the end of the transmission */
+static volatile bool radioBusy = false;
 
 int16_t lastRSSI = 0;
 
+/** TX power in dBm, can be lowered by the battery policy */
+int8_t txPower = TX_OUTPUT_POWER;
+/** TX power changed, TX config has to be updated before next send */
+bool txPowerChanged = false;
+/** RX duty cycle enabled, can be switched off by the battery policy */
+bool rxDutyCycleEnabled = true;
+/** Multiplier for the RX duty cycle sleep time, lowers the listen ratio */
+uint8_t rxSleepFactor = 1;
+
+/**
+ * @brief RX duty cycle sleep time with the sleep factor applied
+ * 
+ * @return uint32_t sleep time in steps of 15.625us, limited to the 24 bits the SX126x takes
+ */
+static uint32_t rxSleepTime(void)
+{
+	uint64_t sleepTime = (uint64_t)duty_cycle_sleep_time * rxSleepFactor;
+	return sleepTime > 0xFFFFFF ? 0xFFFFFF : (uint32_t)sleepTime;
+}
+
+/**
+ * @brief Write the TX settings to the radio
+ * 
+ * @param preamble preamble length in symbols
+ */
+static void setTxConfig(uint16_t preamble)
+{
+	energySetCurrent(&energy, ENERGY_RADIO_TX, energyTxCurrent(txPower));
+	Radio.SetTxConfig(MODEM_LORA, txPower, 0, LORA_BANDWIDTH,
+					  LORA_SPREADING_FACTOR, LORA_CODINGRATE,
+					  preamble, LORA_FIX_LENGTH_PAYLOAD_ON,
+					  true, 0, 0, LORA_IQ_INVERSION_ON, TX_TIMEOUT_VALUE);
+}
+
+/**
+ * @brief Write the RX settings to the radio
+ * 
+ */
+static void setRxConfig(void)
+{
+	Radio.SetRxConfig(MODEM_LORA, LORA_BANDWIDTH, LORA_SPREADING_FACTOR,
+					  LORA_CODINGRATE, 0, LORA_PREAMBLE_LENGTH,
+					  LORA_SYMBOL_TIMEOUT, LORA_FIX_LENGTH_PAYLOAD_ON,
+					  0, true, 0, 0, LORA_IQ_INVERSION_ON, true);
+}
+
+/**
+ * @brief Put the radio into its idle state between transmissions.
+ * To get maximum power savings we use Radio.SetRxDutyCycle instead of Radio.Rx(0)
+ * This function keeps the SX1261/2 chip most of the time in sleep and only wakes up short times
+ * to catch incoming data packages
+ * See document SX1261_AN1200.36_SX1261-2_RxDutyCycle_V1.0 ==>> https://semtech.my.salesforce.com/sfc/p/#E0000000JelG/a/2R0000001O3w/zsdHpRveb0_jlgJEedwalzsBaBnALfRq_MnJ25M_wtI
+ */
+static void radioIdle(void)
+{
+#if defined(RECEIVER)
+	if (radioBusy)
+	{
+		// A downlink changed the packet parameters
+		setRxConfig();
+	}
+	radioBusy = false;
+	// The receiver listens all the time, in continuous mode the radio stays in RX after a frame
+	Radio.Rx(0);
+#elif defined(TX_ONLY)
+	radioBusy = false;
+	Radio.Sleep(); // Radio.Standby();
+#else
+	radioBusy = false;
+	if (rxDutyCycleEnabled)
+	{
+		Radio.SetRxDutyCycle(duty_cycle_rx_time, rxSleepTime());
+	}
+	else
+	{
+		Radio.Sleep();
+	}
+#endif
+}
+
 bool initLoRa(void)
 {
 	// Initialize library
@@ -75,105 +204,312 @@ bool initLoRa(void)
 
 	Radio.Init(&RadioEvents);
 
+#if defined(WAKE_PROFILE) || defined(RECEIVER)
+	// Put the timestamps in front of the DIO1 handler of the library
+	detachInterrupt(PIN_LORA_DIO_1);
+	attachInterrupt(PIN_LORA_DIO_1, radioDio1Irq, RISING);
+#endif
+
 	Radio.Sleep(); // Radio.Standby();
 
 	Radio.SetChannel(RF_FREQUENCY);
 
-	Radio.SetTxConfig(MODEM_LORA, TX_OUTPUT_POWER, 0, LORA_BANDWIDTH,
-					  LORA_SPREADING_FACTOR, LORA_CODINGRATE,
-					  LORA_PREAMBLE_LENGTH, LORA_FIX_LENGTH_PAYLOAD_ON,
-					  true, 0, 0, LORA_IQ_INVERSION_ON, TX_TIMEOUT_VALUE);
+	setTxConfig(LORA_PREAMBLE_LENGTH);
 
-	Radio.SetRxConfig(MODEM_LORA, LORA_BANDWIDTH, LORA_SPREADING_FACTOR,
-					  LORA_CODINGRATE, 0, LORA_PREAMBLE_LENGTH,
-					  LORA_SYMBOL_TIMEOUT, LORA_FIX_LENGTH_PAYLOAD_ON,
-					  0, true, 0, 0, LORA_IQ_INVERSION_ON, true);
+	setRxConfig();
 
+	radioIdle();
+	return true;
+}
+
+/**
+ * @brief Encode the next package, it is sent with the next call of sendLoRa()
+ * 
+ */
+void prepareLoRa(void)
+{
+	PROFILE_ENTER(PROFILE_ENCODE);
+	nodeData.battVoltage = battVoltage;
+	nodeData.timeRequest = clockNeedsSync() ? 1 : 0;
+	// The receiver plans its downlinks with the listen ratio of the node
 #ifdef TX_ONLY
-	Radio.Sleep();
+	nodeData.rxSleepFactor = PAYLOAD_RX_OFF;
 #else
-	// To get maximum power savings we use Radio.SetRxDutyCycle instead of Radio.Rx(0)
-	// This function keeps the SX1261/2 chip most of the time in sleep and only wakes up short times
-	// to catch incoming data packages
-	// See document SX1261_AN1200.36_SX1261-2_RxDutyCycle_V1.0 ==>> https://semtech.my.salesforce.com/sfc/p/#E0000000JelG/a/2R0000001O3w/zsdHpRveb0_jlgJEedwalzsBaBnALfRq_MnJ25M_wtI
-	Radio.SetRxDutyCycle(duty_cycle_rx_time, duty_cycle_sleep_time);
+	if (!rxDutyCycleEnabled)
+	{
+		nodeData.rxSleepFactor = PAYLOAD_RX_OFF;
+	}
+	else
+	{
+		nodeData.rxSleepFactor = rxSleepFactor < PAYLOAD_RX_OFF ? rxSleepFactor : PAYLOAD_RX_UNKNOWN;
+	}
 #endif
-	return true;
+	sampleTime[txNext] = clockNow();
+	uint8_t *buffer = TxdBuffer[txNext];
+	uint8_t size = payloadEncode(&nodeData, buffer);
+#ifdef WAKE_PROFILE
+	// From time to time the awake time statistics are appended
+	size += profileTelemetry(&buffer[size]);
+#endif
+	TxdSize[txNext] = size;
+	PROFILE_EXIT(PROFILE_ENCODE);
 }
 
 /**
- * @brief Prepare packet to be sent and start CAD routine
+ * @brief Start CAD routine for the prepared package.
+ * The package is sent from its own buffer, so the next package
+ * can be prepared while CAD and TX are running.
  * 
  */
 void sendLoRa(void)
 {
-	TxdBuffer[0] = 7;	 // Device ID
-	TxdBuffer[1] = 0;	 // Lights status
-	TxdBuffer[2] = 0;	 // Lights on/off
-	TxdBuffer[3] = 27;	 // Temperature ones/tens/hundreds
-	TxdBuffer[4] = 35;	 // Temperature tenths/hundredths
-	TxdBuffer[5] = 67;	 // Humidity ones/tens/hundreds
-	TxdBuffer[6] = 55;	 // Humidity tenths/hundredths
-	TxdBuffer[7] = 34;	 // Light value
-	TxdBuffer[8] = 12;	 // Light value
-	TxdBuffer[9] = 75;	 // Light activation treshold
-	TxdBuffer[10] = 00;	 // Light activation treshold
-	TxdBuffer[11] = -80; // Strength of last received signal
-	TxdBuffer[12] = 0;	 // Request date/time update
-	TxdBuffer[13] = 0;	 // Flag for secondary light
+	TRACE(TRACE_SEND_START, 0, 0);
+	if (TxdSize[txNext] == 0)
+	{
+		prepareLoRa();
+	}
+	txSend = txNext;
+	txNext ^= 1;
+	TxdSize[txNext] = 0;
 
 	// Prepare LoRa CAD
+	PROFILE_ENTER(PROFILE_CAD);
 	Radio.Sleep(); // Radio.Standby();
+	if (txPowerChanged)
+	{
+		txPowerChanged = false;
+		setTxConfig(LORA_PREAMBLE_LENGTH);
+	}
 	Radio.SetCadParams(LORA_CAD_08_SYMBOL, LORA_SPREADING_FACTOR + 13, 10, LORA_CAD_ONLY, 0);
 	cadTime = millis();
 	channelTimeout = millis();
 
-	// Switch on Indicator lights
-#if MYLOG_LOG_LEVEL > MYLOG_LOG_LEVEL_NONE
-	digitalWrite(LED_CONN, HIGH);
-#endif
-
 	// Start CAD
+	TRACE(TRACE_CAD_START, 0, 0);
+	radioBusy = true;
 	Radio.StartCad();
+	PROFILE_EXIT(PROFILE_CAD);
 }
 
+/**
+ * @brief Change the TX power, used from the next package on
+ * 
+ * @param power TX power in dBm
+ */
+void setLoRaTxPower(int8_t power)
+{
+	if (power != txPower)
+	{
+		txPower = power;
+		txPowerChanged = true;
+	}
+}
+
+/**
+ * @brief Switch RX duty cycle on or off.
+ * Without RX duty cycle the radio sleeps between transmissions
+ * and downlinks are not received.
+ * During CAD or TX the change is applied when the transmission ends.
+ * 
+ * @param enable true to listen for downlinks
+ */
+void setLoRaRxDutyCycle(bool enable)
+{
+	if (enable != rxDutyCycleEnabled)
+	{
+		rxDutyCycleEnabled = enable;
+		if (!radioBusy)
+		{
+			radioIdle();
+		}
+	}
+}
+
+/**
+ * @brief Change the RX listen ratio
+ * 
+ * @param factor multiplier for the RX duty cycle sleep time, 0 switches RX duty cycle off
+ */
+void setLoRaRxSleepFactor(uint8_t factor)
+{
+	if (factor == 0)
+	{
+		setLoRaRxDutyCycle(false);
+		return;
+	}
+	if ((factor != rxSleepFactor) || !rxDutyCycleEnabled)
+	{
+		rxSleepFactor = factor;
+		rxDutyCycleEnabled = true;
+		if (!radioBusy)
+		{
+			radioIdle();
+		}
+	}
+}
+
+/**
+ * @brief Account the time the radio listened in RX duty cycle mode
+ * 
+ * @param ms time the node was sleeping in milliseconds
+ */
+void accountRxDutyCycle(uint32_t ms)
+{
+#ifndef TX_ONLY
+	if (!rxDutyCycleEnabled)
+	{
+		return;
+	}
+	uint64_t rxTime = duty_cycle_rx_time;
+	uint64_t sleepTime = rxSleepTime();
+	energyAccount(&energy, ENERGY_RADIO_RX, (uint32_t)((uint64_t)ms * rxTime / (rxTime + sleepTime)));
+#endif
+}
+
+#ifdef RECEIVER
+/**
+ * @brief Listen schedule of the nodes, from the settings in this file
+ * 
+ * @param window output, listen schedule for the downlink queue
+ */
+void getDownlinkWindow(downlink_window_t *window)
+{
+	// Same conversion as accountRxDutyCycle(), the sleep factor of each node comes with its uplinks
+	window->rxTime = (uint32_t)((uint64_t)duty_cycle_rx_time * 15625 / 1000000);
+	window->sleepTime = (uint32_t)((uint64_t)duty_cycle_sleep_time * 15625 / 1000000);
+	window->openDelay = DOWNLINK_OPEN_DELAY;
+	window->symbolTime = (1000000UL << LORA_SPREADING_FACTOR) / (125000UL << LORA_BANDWIDTH);
+	window->detectTime = (DOWNLINK_DETECT_SYMBOLS * window->symbolTime + 999) / 1000;
+	window->maxWait = DOWNLINK_MAX_WAIT;
+	// Neither the node nor the receiver measured its drift against the other
+	window->drift = 2 * DRIFT_DEFAULT_PPB;
+	window->minGuard = CLOCK_MIN_GUARD;
+	window->preambleLength = LORA_PREAMBLE_LENGTH;
+}
+
+/**
+ * @brief Check if the radio is sending
+ * 
+ * @return true during a downlink
+ */
+bool isLoRaBusy(void)
+{
+	return radioBusy;
+}
+
+/**
+ * @brief Send a downlink without CAD, it has to start at the planned time.
+ * The radio returns to continuous RX with the RX settings after TX done.
+ * 
+ * @param data downlink batch
+ * @param size size of the batch
+ * @param preamble preamble length in symbols
+ */
+void sendDownlink(uint8_t *data, uint8_t size, uint16_t preamble)
+{
+	radioBusy = true;
+	Radio.Standby();
+	setTxConfig(preamble);
+	txTime = millis();
+	TRACE(TRACE_TX_START, 0, size);
+	Radio.Send(data, size);
+}
+#endif
+
 /**
  * @brief Function to be executed on Radio Tx Done event
  */
 void OnTxDone(void)
 {
+	// MAC timestamp of the uplink, an ACK refers to the end of the package
+	clockTxDone(millis());
+	PROFILE_RADIO_START(PROFILE_RADIO_TX_DONE);
+	TRACE(TRACE_TX_DONE, 0, 0);
+	PROFILE_ENTER(PROFILE_CALLBACK);
+	energyAccount(&energy, ENERGY_RADIO_TX, millis() - txTime);
+	radioIdle();
+
+	// Log output and LED after the radio is back in its idle state
+	periphAcquire(PERIPH_SERIAL);
 	myLog_d("OnTxDone");
-#ifdef TX_ONLY
-	Radio.Sleep();
-#else
-	// To get maximum power savings we use Radio.SetRxDutyCycle instead of Radio.Rx(0)
-	// This function keeps the SX1261/2 chip most of the time in sleep and only wakes up short times
-	// to catch incoming data packages
-	// See document SX1261_AN1200.36_SX1261-2_RxDutyCycle_V1.0 ==>> https://semtech.my.salesforce.com/sfc/p/#E0000000JelG/a/2R0000001O3w/zsdHpRveb0_jlgJEedwalzsBaBnALfRq_MnJ25M_wtI
-	Radio.SetRxDutyCycle(duty_cycle_rx_time, duty_cycle_sleep_time);
-#endif
 
-	// Switch off the indicator lights
-#if MYLOG_LOG_LEVEL > MYLOG_LOG_LEVEL_NONE
-	digitalWrite(LED_CONN, LOW);
-#endif
+	// Flash blue LED to show the package is sent
+	ledFlash(LED_BLUE_IDX);
+
+	periphRelease(PERIPH_SERIAL);
+	PROFILE_EXIT(PROFILE_CALLBACK);
+	PROFILE_RADIO_END(PROFILE_RADIO_TX_DONE);
 }
 
 /**@brief Function to be executed on Radio Rx Done event
  */
 void OnRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
 {
-	myLog_d("OnRxDone");
+	PROFILE_RADIO_START(PROFILE_RADIO_RX_DONE);
+	TRACE(TRACE_RX_DONE, (uint8_t)snr, (uint16_t)((uint8_t)size | (uint8_t)(-rssi) << 8));
+#ifdef RECEIVER
+	// The receiver task streams the frame, the radio stays in continuous RX
+	receiverFrame(payload, size, rssi, snr);
+#else
+	// Timestamp of the reception, before anything else delays it
+	uint32_t rxTime = millis();
+	PROFILE_ENTER(PROFILE_CALLBACK);
 
-	delay(10);
+	uint32_t reference;
+	uint8_t timeFrame = timeFrameDecode(payload, size, &reference);
+	if (batchFor(payload, size, nodeData.deviceId))
+	{
+		// The commands go to the loop task with their size in front, a time reference ACK in the batch is handled here
+		rcvdDataLen = 0;
+		uint16_t offset = DOWNLINK_BATCH_HEADER;
+		const uint8_t *command;
+		uint8_t length;
+		while ((length = batchNext(payload, size, &offset, &command)) != 0)
+		{
+			uint8_t type = timeFrameDecode(command, length, &reference);
+			if (type != 0)
+			{
+				timeFrame = type;
+				continue;
+			}
+			rcvdLoRaData[rcvdDataLen++] = length;
+			memcpy(&rcvdLoRaData[rcvdDataLen], command, length);
+			rcvdDataLen += length;
+		}
+		TRACE(TRACE_RX_FRAME, TRACE_FRAME_BATCH, (uint16_t)(rcvdDataLen | timeFrame << 8));
+		if (rcvdDataLen != 0)
+		{
+			wakeLoopTask(WAKE_SOURCE_RX);
+		}
+	}
+	else if (timeFrame != 0)
+	{
+		TRACE(TRACE_RX_FRAME, TRACE_FRAME_TIME, (uint16_t)(timeFrame << 8));
+	}
+	else if ((size == 0) || (payload[0] != DOWNLINK_BATCH))
+	{
+		// Keep a copy for the loop task, the radio reuses the payload buffer
+		memcpy(rcvdLoRaData, payload, size);
+		rcvdDataLen = size;
+		TRACE(TRACE_RX_FRAME, TRACE_FRAME_DATA, rcvdDataLen);
 
-	eventType = 0;
-	// Notify task about the event
-	if (taskEvent != NULL)
+		// Notify task about the event
+		wakeLoopTask(WAKE_SOURCE_RX);
+	}
+	else
 	{
-		xSemaphoreGive(taskEvent);
+		TRACE(TRACE_RX_FRAME, TRACE_FRAME_OTHER_BATCH, 0);
 	}
+	radioIdle();
 
+	// Log output and LED after the radio is back in its idle state
+	periphAcquire(PERIPH_SERIAL);
+	myLog_d("OnRxDone");
+	if (timeFrame != 0)
+	{
+		// Time references are handled here, the loop task keeps sleeping
+		clockTimeFrame(timeFrame, rxTime, reference);
+	}
 #if MYLOG_LOG_LEVEL > MYLOG_LOG_LEVEL_NONE
 	char rcvdData[256 * 4] = {0};
 
@@ -185,110 +521,98 @@ void OnRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
 	myLog_d(rcvdData);
 #endif
 
-#ifdef TX_ONLY
-	Radio.Sleep(); // Radio.Standby();
-#else
-	// To get maximum power savings we use Radio.SetRxDutyCycle instead of Radio.Rx(0)
-	// This function keeps the SX1261/2 chip most of the time in sleep and only wakes up short times
-	// to catch incoming data packages
-	// See document SX1261_AN1200.36_SX1261-2_RxDutyCycle_V1.0 ==>> https://semtech.my.salesforce.com/sfc/p/#E0000000JelG/a/2R0000001O3w/zsdHpRveb0_jlgJEedwalzsBaBnALfRq_MnJ25M_wtI
-	Radio.SetRxDutyCycle(duty_cycle_rx_time, duty_cycle_sleep_time);
-#endif
+	// Double flash blue LED to show a package arrived
+	ledPattern(LED_BLUE_IDX, 0b101, 3, 1);
 
-	// Switch off the indicator lights
-#if MYLOG_LOG_LEVEL > MYLOG_LOG_LEVEL_NONE
-	digitalWrite(LED_CONN, LOW);
+	periphRelease(PERIPH_SERIAL);
+	PROFILE_EXIT(PROFILE_CALLBACK);
 #endif
+	PROFILE_RADIO_END(PROFILE_RADIO_RX_DONE);
 }
 
 /**@brief Function to be executed on Radio Tx Timeout event
  */
 void OnTxTimeout(void)
 {
+	PROFILE_RADIO_START(PROFILE_RADIO_TX_TIMEOUT);
+	TRACE(TRACE_TX_TIMEOUT, 0, 0);
+	PROFILE_ENTER(PROFILE_CALLBACK);
+	energyAccount(&energy, ENERGY_RADIO_TX, millis() - txTime);
+	radioIdle();
+
+	periphAcquire(PERIPH_SERIAL);
 	myLog_d("OnTxTimeout");
 
-#ifdef TX_ONLY
-	Radio.Sleep(); // Radio.Standby();
-#else
-	// To get maximum power savings we use Radio.SetRxDutyCycle instead of Radio.Rx(0)
-	// This function keeps the SX1261/2 chip most of the time in sleep and only wakes up short times
-	// to catch incoming data packages
-	// See document SX1261_AN1200.36_SX1261-2_RxDutyCycle_V1.0 ==>> https://semtech.my.salesforce.com/sfc/p/#E0000000JelG/a/2R0000001O3w/zsdHpRveb0_jlgJEedwalzsBaBnALfRq_MnJ25M_wtI
-	Radio.SetRxDutyCycle(duty_cycle_rx_time, duty_cycle_sleep_time);
-#endif
+	// Blink code 2 on blue LED for TX timeout
+	ledBlinkCode(LED_BLUE_IDX, 2, 1);
 
-	// Switch off the indicator lights
-#if MYLOG_LOG_LEVEL > MYLOG_LOG_LEVEL_NONE
-	digitalWrite(LED_CONN, LOW);
-#endif
+	periphRelease(PERIPH_SERIAL);
+	PROFILE_EXIT(PROFILE_CALLBACK);
+	PROFILE_RADIO_END(PROFILE_RADIO_TX_TIMEOUT);
 }
 
 /**@brief Function to be executed on Radio Rx Timeout event
  */
 void OnRxTimeout(void)
 {
-	myLog_d("OnRxTimeout");
-
-#ifdef TX_ONLY
-	Radio.Sleep(); // Radio.Standby();
-#else
-	// To get maximum power savings we use Radio.SetRxDutyCycle instead of Radio.Rx(0)
-	// This function keeps the SX1261/2 chip most of the time in sleep and only wakes up short times
-	// to catch incoming data packages
-	// See document SX1261_AN1200.36_SX1261-2_RxDutyCycle_V1.0 ==>> https://semtech.my.salesforce.com/sfc/p/#E0000000JelG/a/2R0000001O3w/zsdHpRveb0_jlgJEedwalzsBaBnALfRq_MnJ25M_wtI
-	Radio.SetRxDutyCycle(duty_cycle_rx_time, duty_cycle_sleep_time);
-#endif
+	PROFILE_RADIO_START(PROFILE_RADIO_RX_TIMEOUT);
+	TRACE(TRACE_RX_TIMEOUT, 0, 0);
+	PROFILE_ENTER(PROFILE_CALLBACK);
+	radioIdle();
 
-	// Switch off the indicator lights
-#if MYLOG_LOG_LEVEL > MYLOG_LOG_LEVEL_NONE
-	digitalWrite(LED_CONN, LOW);
-#endif
+	periphAcquire(PERIPH_SERIAL);
+	myLog_d("OnRxTimeout");
+	periphRelease(PERIPH_SERIAL);
+	PROFILE_EXIT(PROFILE_CALLBACK);
+	PROFILE_RADIO_END(PROFILE_RADIO_RX_TIMEOUT);
 }
 
 /**@brief Function to be executed on Radio Rx Error event
  */
 void OnRxError(void)
 {
-#ifdef TX_ONLY
-	Radio.Sleep(); // Radio.Standby();
-#else
-	// To get maximum power savings we use Radio.SetRxDutyCycle instead of Radio.Rx(0)
-	// This function keeps the SX1261/2 chip most of the time in sleep and only wakes up short times
-	// to catch incoming data packages
-	// See document SX1261_AN1200.36_SX1261-2_RxDutyCycle_V1.0 ==>> https://semtech.my.salesforce.com/sfc/p/#E0000000JelG/a/2R0000001O3w/zsdHpRveb0_jlgJEedwalzsBaBnALfRq_MnJ25M_wtI
-	Radio.SetRxDutyCycle(duty_cycle_rx_time, duty_cycle_sleep_time);
-#endif
-
-	// Switch off the indicator lights
-#if MYLOG_LOG_LEVEL > MYLOG_LOG_LEVEL_NONE
-	digitalWrite(LED_CONN, LOW);
-#endif
+	PROFILE_RADIO_START(PROFILE_RADIO_RX_ERROR);
+	TRACE(TRACE_RX_ERROR, 0, 0);
+	PROFILE_ENTER(PROFILE_CALLBACK);
+	radioIdle();
+
+	// Blink code 3 on blue LED for RX error
+	ledBlinkCode(LED_BLUE_IDX, 3, 1);
+	PROFILE_EXIT(PROFILE_CALLBACK);
+	PROFILE_RADIO_END(PROFILE_RADIO_RX_ERROR);
 }
 
-/**@brief Function to be executed on Radio Rx Error event
+/**@brief Function to be executed on Radio CAD Done event.
+ * The package is sent first, the log output comes after the radio is busy with TX.
  */
 void OnCadDone(bool cadResult)
 {
+	PROFILE_RADIO_START(PROFILE_RADIO_CAD_DONE);
+	TRACE(TRACE_CAD_DONE, cadResult, 0);
+	PROFILE_ENTER(PROFILE_CALLBACK);
+	energyAccount(&energy, ENERGY_RADIO_CAD, millis() - cadTime);
 	if (cadResult)
 	{
-#ifdef TX_ONLY
-		Radio.Sleep(); // Radio.Standby();
-#else
-		// To get maximum power savings we use Radio.SetRxDutyCycle instead of Radio.Rx(0)
-		// This function keeps the SX1261/2 chip most of the time in sleep and only wakes up short times
-		// to catch incoming data packages
-		// See document SX1261_AN1200.36_SX1261-2_RxDutyCycle_V1.0 ==>> https://semtech.my.salesforce.com/sfc/p/#E0000000JelG/a/2R0000001O3w/zsdHpRveb0_jlgJEedwalzsBaBnALfRq_MnJ25M_wtI
-		Radio.SetRxDutyCycle(duty_cycle_rx_time, duty_cycle_sleep_time);
-#endif
+		radioIdle();
 
-		// Switch off the indicator lights
-#if MYLOG_LOG_LEVEL > MYLOG_LOG_LEVEL_NONE
-		digitalWrite(LED_CONN, LOW);
-#endif
+		// Blink code 4 on blue LED for channel busy
+		ledBlinkCode(LED_BLUE_IDX, 4, 1);
 	}
 	else
 	{
-		myLog_d("CAD returned channel free after %ldms\n", (long)(millis() - cadTime));
-		Radio.Send(TxdBuffer, 14);
+		txTime = millis();
+		// The age of the sample is written at the last moment
+		payloadSetAge(TxdBuffer[txSend], clockNow() - sampleTime[txSend]);
+		TRACE(TRACE_TX_START, 0, TxdSize[txSend]);
+		PROFILE_ENTER(PROFILE_TX);
+		Radio.Send(TxdBuffer[txSend], TxdSize[txSend]);
+		PROFILE_EXIT(PROFILE_TX);
+
+		periphAcquire(PERIPH_SERIAL);
+		myLog_d("CAD returned channel free after %ldms\n", (long)(txTime - cadTime));
+		periphRelease(PERIPH_SERIAL);
 	}
+
+	PROFILE_EXIT(PROFILE_CALLBACK);
+	PROFILE_RADIO_END(PROFILE_RADIO_CAD_DONE);
 }
\ No newline at end of file
@@ -0,0 +1,87 @@
+/**
+ * @file nodePayload.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Layout of the data package sent by sendLoRa(), shared between firmware and host tools
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef NODE_PAYLOAD_H
+#define NODE_PAYLOAD_H
+
+#include <stdint.h>
+
+/** Size of the encoded package without the optional profiler statistics */
+#define PAYLOAD_SIZE 18
+/** Position of the sample age in the encoded package, it is written right before the package is sent */
+#define PAYLOAD_AGE_OFFSET 16
+/** Unit of the sample age in ms */
+#define PAYLOAD_AGE_UNIT_MS 100
+/** The time request byte carries the RX duty cycle sleep factor of the node in its upper 4 bits */
+#define PAYLOAD_RX_SHIFT 4
+/** Sleep factor not sent (older firmware or a factor above 14), only the ACK window of the node is known */
+#define PAYLOAD_RX_UNKNOWN 0
+/** The node switched RX duty cycle off, it does not listen after its uplinks */
+#define PAYLOAD_RX_OFF 15
+
+/** Content of a data package */
+typedef struct
+{
+	/** Device ID */
+	uint8_t deviceId;
+	/** Lights status */
+	uint8_t lightStatus;
+	/** Lights on/off */
+	uint8_t lightOn;
+	/** Temperature ones/tens/hundreds */
+	uint8_t temperature;
+	/** Temperature tenths/hundredths */
+	uint8_t temperatureFraction;
+	/** Humidity ones/tens/hundreds */
+	uint8_t humidity;
+	/** Humidity tenths/hundredths */
+	uint8_t humidityFraction;
+	/** Light value */
+	uint16_t light;
+	/** Light activation threshold */
+	uint16_t lightThreshold;
+	/** Strength of last received signal */
+	int8_t rssi;
+	/** Request date/time update */
+	uint8_t timeRequest;
+	/** Flag for secondary light */
+	uint8_t secondaryLight;
+	/** Battery voltage in mV */
+	uint16_t battVoltage;
+	/** Time from the sample to the start of the transmission in PAYLOAD_AGE_UNIT_MS */
+	uint16_t sampleAge;
+	/** RX duty cycle sleep factor the node listens with, PAYLOAD_RX_UNKNOWN or PAYLOAD_RX_OFF */
+	uint8_t rxSleepFactor;
+} node_payload_t;
+
+/** First byte of a time reference downlink. A beacon carries the time of the sender when it
+ * started to send the beacon, an ACK the time when the sender received the last uplink of the node. */
+#define TIME_FRAME_BEACON 0xF1
+#define TIME_FRAME_ACK 0xF2
+/** Size of a time reference downlink: type and the time of the sender in ms (32 bit, MSB first) */
+#define TIME_FRAME_SIZE 5
+
+/** First byte of a downlink batch, followed by the device ID of the addressed node and the commands,
+ * each command with its size in front. A time reference ACK is sent as one of the commands. */
+#define DOWNLINK_BATCH 0xF3
+/** Bytes in front of the first command */
+#define DOWNLINK_BATCH_HEADER 2
+
+uint8_t payloadEncode(const node_payload_t *payload, uint8_t *buffer);
+bool payloadDecode(node_payload_t *payload, const uint8_t *buffer, uint16_t size);
+void payloadSetAge(uint8_t *buffer, uint32_t age);
+uint8_t timeFrameEncode(uint8_t type, uint32_t time, uint8_t *buffer);
+uint8_t timeFrameDecode(const uint8_t *buffer, uint16_t size, uint32_t *time);
+uint8_t batchStart(uint8_t deviceId, uint8_t *buffer);
+uint8_t batchAdd(uint8_t *buffer, uint8_t size, const uint8_t *command, uint8_t length);
+bool batchFor(const uint8_t *buffer, uint16_t size, uint8_t deviceId);
+uint8_t batchNext(const uint8_t *buffer, uint16_t size, uint16_t *offset, const uint8_t **command);
+
+#endif
@@ -0,0 +1,188 @@
+/**
+ * @file power.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Reference counted power management for the peripherals
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/** Energy accounting of the node */
+energy_model_t energy;
+
+/** Held while a peripheral is powered up or down, a second user waits until it is ready */
+static SemaphoreHandle_t periphMutex = NULL;
+static StaticSemaphore_t periphMutexBuffer;
+/** Number of users currently holding each peripheral */
+static uint8_t periphUsers[PERIPH_NUM] = {0};
+/** millis() when the peripheral was powered up */
+static uint32_t periphOnSince[PERIPH_NUM] = {0};
+/** Accumulated on-time of each peripheral in milliseconds */
+static uint32_t periphOnTime[PERIPH_NUM] = {0};
+
+/**
+ * @brief Check if a USB host is attached
+ *
+ * @return true if VBUS is detected
+ */
+bool usbHostPresent(void)
+{
+	return (NRF_POWER->USBREGSTATUS & POWER_USBREGSTATUS_VBUSDETECT_Msk) != 0;
+}
+
+/**
+ * @brief Switch off the USBD peripheral and release the HFCLK
+ * it needs, so a debug build without USB host sleeps like a release build.
+ * The USB stack enables the USBD again when VBUS is detected.
+ *
+ */
+void usbDetach(void)
+{
+	if (NRF_USBD->ENABLE)
+	{
+		NRF_USBD->ENABLE = 0;
+	}
+	// The SX1262 has its own TCXO, nothing else needs the HFXO
+	if (NRF_CLOCK->HFCLKSTAT & CLOCK_HFCLKSTAT_SRC_Msk)
+	{
+		NRF_CLOCK->TASKS_HFCLKSTOP = 1;
+	}
+}
+
+/**
+ * @brief Create the mutex of the power manager, before the first periphAcquire()
+ *
+ */
+void periphInit(void)
+{
+	periphMutex = xSemaphoreCreateMutexStatic(&periphMutexBuffer);
+}
+
+/**
+ * @brief Switch a peripheral on
+ *
+ * @param periph PERIPH_SERIAL
+ */
+static void periphPowerUp(uint8_t periph)
+{
+	periphOnSince[periph] = millis();
+	switch (periph)
+	{
+	case PERIPH_SERIAL:
+#if (MYLOG_LOG_LEVEL > MYLOG_LOG_LEVEL_NONE) || defined(RECEIVER)
+		// Without USB host there is nobody to read the log or the frame stream
+		if (usbHostPresent())
+		{
+			Serial.begin(115200);
+		}
+		else
+		{
+			usbDetach();
+		}
+#endif
+		break;
+	}
+}
+
+/**
+ * @brief Switch a peripheral off so that the
+ * USBD does not draw current while sleeping
+ *
+ * @param periph PERIPH_SERIAL
+ */
+static void periphPowerDown(uint8_t periph)
+{
+	switch (periph)
+	{
+	case PERIPH_SERIAL:
+#if (MYLOG_LOG_LEVEL > MYLOG_LOG_LEVEL_NONE) || defined(RECEIVER)
+		if (usbHostPresent())
+		{
+			Serial.flush();
+			Serial.end();
+		}
+#endif
+		break;
+	}
+	uint32_t onTime = millis() - periphOnSince[periph];
+	periphOnTime[periph] += onTime;
+	energyAccount(&energy, ENERGY_SERIAL + periph, onTime);
+}
+
+/**
+ * @brief Request a peripheral. The first user powers it up,
+ * the peripheral is ready when the function returns.
+ *
+ * @param periph PERIPH_SERIAL
+ */
+void periphAcquire(uint8_t periph)
+{
+	if (periph >= PERIPH_NUM)
+	{
+		return;
+	}
+	xSemaphoreTake(periphMutex, portMAX_DELAY);
+	if (periphUsers[periph]++ == 0)
+	{
+		periphPowerUp(periph);
+	}
+	xSemaphoreGive(periphMutex);
+}
+
+/**
+ * @brief Release a peripheral. The last user powers it down.
+ *
+ * @param periph PERIPH_SERIAL
+ */
+void periphRelease(uint8_t periph)
+{
+	if (periph >= PERIPH_NUM)
+	{
+		return;
+	}
+	xSemaphoreTake(periphMutex, portMAX_DELAY);
+	if ((periphUsers[periph] != 0) && (--periphUsers[periph] == 0))
+	{
+		periphPowerDown(periph);
+	}
+	xSemaphoreGive(periphMutex);
+}
+
+/**
+ * @brief Get the accumulated on-time of a peripheral
+ *
+ * @param periph PERIPH_SERIAL
+ * @return uint32_t on-time in milliseconds, including the current on period
+ */
+uint32_t periphGetOnTime(uint8_t periph)
+{
+	if (periph >= PERIPH_NUM)
+	{
+		return 0;
+	}
+	uint32_t onTime = periphOnTime[periph];
+	if (periphUsers[periph] != 0)
+	{
+		onTime += millis() - periphOnSince[periph];
+	}
+	return onTime;
+}
+
+/**
+ * @brief Log the charge used by each consumer since power up
+ *
+ */
+void energyLog(void)
+{
+#if MYLOG_LOG_LEVEL >= MYLOG_LOG_LEVEL_VERBOSE
+	for (uint8_t consumer = 0; consumer < ENERGY_NUM; consumer++)
+	{
+		myLog_v("%s %ldms %ld uAh", energyName(consumer),
+				(long)energyTotalTime(&energy, consumer), (long)ENERGY_NC_TO_UAH(energy.charge[consumer]));
+	}
+	myLog_v("Average current %ld uA", (long)energyAverageCurrent(&energy, millis()));
+#endif
+}
@@ -0,0 +1,227 @@
+/**
+ * @file profile.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Awake time histogram and per phase profiler using the DWT cycle counter
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+#ifdef WAKE_PROFILE
+/** Statistics since the last report */
+static wake_profile_t wakeProfile;
+
+/** Cycle counter at the last timer wakeup */
+static uint32_t lastWakeCycles = 0;
+/** Timer wakeups since the last report */
+static uint16_t wakesSinceReport = 0;
+
+/** Cycle counter at the event that woke up the loop task, per wake source, 0 if no wakeup is pending */
+static uint32_t wakeSourceCycles[PROFILE_SOURCES] = {0};
+
+/** Cycle counter at the last DIO1 interrupt, 0 if it was handled */
+static volatile uint32_t radioIrqCycles = 0;
+/** Cycle counter at the DIO1 interrupt of the running radio callback, 0 if unknown */
+static uint32_t radioEventCycles = 0;
+/** Cycle counter at the start of the running radio callback */
+static uint32_t radioStartCycles = 0;
+/** IRQ to callback latency of the running radio callback */
+static uint32_t radioLatency = PROFILE_NO_LATENCY;
+
+/** Phases can nest, e.g. TX inside the CAD callback. The parent is paused while a child runs. */
+#define PROFILE_STACK 4
+static uint8_t phaseStack[PROFILE_STACK];
+static uint32_t phaseCycles[PROFILE_STACK];
+static uint8_t phaseDepth = 0;
+static uint32_t phaseMark = 0;
+
+/** DWT cycles per us */
+#define CYCLES_PER_US (64)
+
+/**
+ * @brief Start the DWT cycle counter and clear the statistics
+ *
+ */
+void profileInit(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	profileReset(&wakeProfile);
+}
+
+/**
+ * @brief Start a phase, pauses the running phase.
+ * With WAKE_TRACE the start is also a trace point, tools/powerCorr attributes the current to the phases.
+ *
+ * @param phase PROFILE_xxx
+ */
+void profileEnter(uint8_t phase)
+{
+	bool started = false;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint32_t now = DWT->CYCCNT;
+	if (phaseDepth > 0)
+	{
+		phaseCycles[phaseDepth - 1] += now - phaseMark;
+	}
+	if (phaseDepth < PROFILE_STACK)
+	{
+		phaseStack[phaseDepth] = phase;
+		phaseCycles[phaseDepth] = 0;
+		phaseDepth++;
+		started = true;
+	}
+	phaseMark = now;
+	__set_PRIMASK(primask);
+	if (started)
+	{
+		TRACE(TRACE_PHASE_ENTER, phase, 0);
+	}
+}
+
+/**
+ * @brief End a phase and add its time to the statistics.
+ * Ignored if the phase is not the running one, e.g. no dispatch phase on a downlink wakeup.
+ *
+ * @param phase PROFILE_xxx
+ */
+void profileExit(uint8_t phase)
+{
+	bool ended = false;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if ((phaseDepth > 0) && (phaseStack[phaseDepth - 1] == phase))
+	{
+		uint32_t now = DWT->CYCCNT;
+		phaseDepth--;
+		profileAddPhase(&wakeProfile, phase, (phaseCycles[phaseDepth] + now - phaseMark) / CYCLES_PER_US);
+		phaseMark = now;
+		ended = true;
+	}
+	__set_PRIMASK(primask);
+	if (ended)
+	{
+		TRACE(TRACE_PHASE_EXIT, phase, 0);
+	}
+}
+
+/**
+ * @brief Called on every timer wakeup. The cycle counter stops while the CPU sleeps,
+ * so the cycles since the last timer wakeup are the awake time of the last wake cycle,
+ * including all radio callbacks.
+ *
+ */
+void profileWakeCycle(void)
+{
+	uint32_t now = DWT->CYCCNT;
+	// The timer wakeup latency starts here, the RTC interrupt only wakes up the timer task
+	wakeSourceCycles[PROFILE_SOURCE_TIMER] = now | 1;
+	if (lastWakeCycles != 0)
+	{
+		profileAddWake(&wakeProfile, (now - lastWakeCycles) / CYCLES_PER_US);
+		wakesSinceReport++;
+	}
+	lastWakeCycles = now | 1;
+}
+
+/**
+ * @brief Called by the wake source right before it notifies the loop task.
+ * A received package is measured from its DIO1 interrupt, so the wakeup of the radio task
+ * is included. The timer wakeup was already stamped in profileWakeCycle().
+ *
+ * @param source PROFILE_SOURCE_xxx
+ */
+void profileWakeSource(uint8_t source)
+{
+	if ((source == PROFILE_SOURCE_RX) && (radioEventCycles != 0))
+	{
+		wakeSourceCycles[PROFILE_SOURCE_RX] = radioEventCycles;
+	}
+}
+
+/**
+ * @brief Called by the loop task after it got the notification. The CPU does not
+ * sleep while the loop task is ready to run, so the cycle counter covers the whole latency.
+ *
+ * @param source PROFILE_SOURCE_xxx, the wake source that set its notification bit
+ */
+void profileWakeLatency(uint8_t source)
+{
+	if ((source < PROFILE_SOURCES) && (wakeSourceCycles[source] != 0))
+	{
+		profileAddLatency(&wakeProfile, source, (DWT->CYCCNT - wakeSourceCycles[source]) / CYCLES_PER_US);
+		wakeSourceCycles[source] = 0;
+	}
+}
+
+/**
+ * @brief Called in the DIO1 interrupt, before the library wakes up its radio task
+ *
+ */
+void profileRadioIrq(void)
+{
+	radioIrqCycles = DWT->CYCCNT | 1;
+}
+
+/**
+ * @brief Called first in a radio callback
+ *
+ * @param event PROFILE_RADIO_xxx
+ */
+void profileRadioStart(uint8_t event)
+{
+	uint32_t now = DWT->CYCCNT;
+	radioLatency = PROFILE_NO_LATENCY;
+	radioEventCycles = radioIrqCycles;
+	if (radioIrqCycles != 0)
+	{
+		radioLatency = (now - radioIrqCycles) / CYCLES_PER_US;
+		radioIrqCycles = 0;
+	}
+	radioStartCycles = now;
+}
+
+/**
+ * @brief Called last in a radio callback
+ *
+ * @param event PROFILE_RADIO_xxx
+ */
+void profileRadioEnd(uint8_t event)
+{
+	profileAddRadio(&wakeProfile, event, radioLatency, (DWT->CYCCNT - radioStartCycles) / CYCLES_PER_US);
+}
+
+/**
+ * @brief Every PROFILE_REPORT_WAKES wake cycles the statistics are added to the package
+ *
+ * @param buffer where to put the telemetry, needs PROFILE_TELEMETRY_SIZE bytes
+ * @return uint8_t size of the telemetry, 0 if it is not time to report
+ */
+uint8_t profileTelemetry(uint8_t *buffer)
+{
+	if (wakesSinceReport < PROFILE_REPORT_WAKES)
+	{
+		return 0;
+	}
+	uint8_t size = profileEncode(&wakeProfile, buffer);
+	myLog_d("Profile of %d wakes added to package", wakeProfile.wakes);
+	for (uint8_t event = 0; event < PROFILE_RADIO_EVENTS; event++)
+	{
+		const profile_phase_t *latency = &wakeProfile.radioLatency[event];
+		const profile_phase_t *time = &wakeProfile.radioTime[event];
+		if (time->count != 0)
+		{
+			myLog_d("%s: %d events, IRQ latency avg %ldus max %ldus, CPU avg %ldus max %ldus", profileRadioEventName(event), time->count,
+					(long)(latency->count ? latency->sum / latency->count : 0), (long)latency->max,
+					(long)(time->sum / time->count), (long)time->max);
+		}
+	}
+	profileReset(&wakeProfile);
+	wakesSinceReport = 0;
+	return size;
+}
+#endif
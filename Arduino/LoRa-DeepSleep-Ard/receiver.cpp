@@ -0,0 +1,195 @@
+/**
+ * @file receiver.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Receiver / concentrator role, streams every received frame to the host over USB and sends the downlinks of the host
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+#ifdef RECEIVER
+/** Frames between the radio callback and the receiver task */
+static rx_ring_t rxRing;
+
+/** Receiver task, drains the ring into the USB stream */
+static TaskHandle_t receiverTask = NULL;
+static StaticTask_t receiverTaskBuffer;
+static StackType_t receiverTaskStack[RECEIVER_STACK_SIZE];
+
+/** Encoded messages that are written to USB with one call */
+static uint8_t batch[RECEIVER_BATCH_SIZE];
+
+/** Commands of the host, sent as one batch per node into the listen windows of the nodes */
+static downlink_queue_t downlinks;
+/** Parser of the downlink commands coming from the host */
+static stream_parser_t hostParser;
+/** Command being parsed */
+static uint8_t command[RX_FRAME_MAX];
+/** Batch being sent, the radio copies it into its buffer */
+static uint8_t downlinkBatch[DOWNLINK_BATCH_MAX];
+
+/** micros() at the last DIO1 interrupt */
+static volatile uint32_t rxIrqTime = 0;
+
+/**
+ * @brief Called in the DIO1 interrupt, the time stamp of the frame.
+ * For RX done DIO1 rises at the end of the frame.
+ *
+ */
+void receiverIrq(void)
+{
+	rxIrqTime = micros();
+}
+
+/**
+ * @brief Queue a received frame for the receiver task.
+ * Runs in the radio task, only copies the frame into a ring slot.
+ *
+ * @param payload received data
+ * @param size size of the data
+ * @param rssi RSSI in dBm
+ * @param snr SNR in dB
+ */
+void receiverFrame(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
+{
+	rx_frame_t *frame = rxRingReserve(&rxRing);
+	if (frame == NULL)
+	{
+		// All slots in use, the ring counts the drop
+		return;
+	}
+	frame->time = rxIrqTime;
+	frame->rssi = rssi;
+	frame->snr = snr;
+	// Single radio, single channel
+	frame->channel = 0;
+	frame->size = size > RX_FRAME_MAX ? RX_FRAME_MAX : size;
+	memcpy(frame->data, payload, frame->size);
+	rxRingCommit(&rxRing);
+
+	xTaskNotifyGive(receiverTask);
+}
+
+/**
+ * @brief Take the listen schedule and the time request from an uplink of a node
+ *
+ * @param frame received frame
+ */
+static void receiverUplink(const rx_frame_t *frame)
+{
+	node_payload_t payload;
+	if ((frame->size == 0) || (frame->data[0] == DOWNLINK_BATCH) || !payloadDecode(&payload, frame->data, frame->size))
+	{
+		// Not a node package, e.g. the downlink of another receiver
+		return;
+	}
+	// The frame time is micros() at the end of the frame, the node starts listening at that moment
+	uint32_t end = millis() - (micros() - frame->time) / 1000;
+	downlinkUplink(&downlinks, payload.deviceId, end, payload.timeRequest != 0, payload.rxSleepFactor);
+}
+
+/**
+ * @brief Queue the downlink commands the host sent
+ *
+ */
+static void receiverCommands(void)
+{
+	uint8_t deviceId;
+	uint8_t size;
+	while (Serial.available() > 0)
+	{
+		if (streamParseDownlink(&hostParser, (uint8_t)Serial.read(), &deviceId, command, &size))
+		{
+			downlinkAdd(&downlinks, deviceId, command, size);
+		}
+	}
+}
+
+/**
+ * @brief Send the batch that is due, if the radio is free
+ *
+ */
+static void receiverDownlink(void)
+{
+	downlink_plan_t plan;
+	if (isLoRaBusy() || !downlinkPlan(&downlinks, millis(), &plan) || ((int32_t)(plan.time - millis()) > 0))
+	{
+		return;
+	}
+	uint8_t size = downlinkBuild(&downlinks, &plan, downlinkBatch);
+	sendDownlink(downlinkBatch, size, plan.preamble);
+}
+
+/**
+ * @brief Time until the receiver task has to check the USB port or send the next batch
+ *
+ * @return TickType_t time to wait for frames in ticks
+ */
+static TickType_t receiverWait(void)
+{
+	uint32_t wait = RECEIVER_POLL_TIME;
+	downlink_plan_t plan;
+	if (downlinkPlan(&downlinks, millis(), &plan))
+	{
+		int32_t due = (int32_t)(plan.time - millis());
+		if (due < (int32_t)wait)
+		{
+			// At least one tick, the radio may still be busy with the last batch
+			wait = due > 1 ? due : 1;
+		}
+	}
+	return pdMS_TO_TICKS(wait);
+}
+
+/**
+ * @brief Receiver task, writes all queued frames to USB.
+ * The frames waiting in the ring are encoded into one batch, the USB stack moves
+ * the batch with EasyDMA while the task waits for the next frames.
+ * Between the frames the task queues the downlink commands of the host and sends
+ * the batches when the listen windows of the nodes are due.
+ *
+ */
+static void receiverLoop(void *)
+{
+	while (true)
+	{
+		ulTaskNotifyTake(pdTRUE, receiverWait());
+		uint16_t length = 0;
+		const rx_frame_t *frame;
+		while ((frame = rxRingPeek(&rxRing)) != NULL)
+		{
+			receiverUplink(frame);
+			// The slot is free again as soon as the frame is encoded
+			length += streamEncode(frame, &batch[length]);
+			rxRingRelease(&rxRing);
+			if ((length + STREAM_ENCODED_MAX > RECEIVER_BATCH_SIZE) || (rxRingPeek(&rxRing) == NULL))
+			{
+				Serial.write(batch, length);
+				length = 0;
+			}
+		}
+		receiverCommands();
+		receiverDownlink();
+	}
+}
+
+/**
+ * @brief Start the receiver task. The radio stays in continuous RX,
+ * the USB port is powered all the time.
+ *
+ */
+void receiverInit(void)
+{
+	rxRingInit(&rxRing);
+	streamParserInit(&hostParser);
+	downlink_window_t window;
+	getDownlinkWindow(&window);
+	downlinkInit(&downlinks, &window);
+	periphAcquire(PERIPH_SERIAL);
+	receiverTask = xTaskCreateStatic(receiverLoop, "RX", RECEIVER_STACK_SIZE, NULL, TASK_PRIO_HIGH,
+									 receiverTaskStack, &receiverTaskBuffer);
+}
+#endif
@@ -0,0 +1,103 @@
+/**
+ * @file rxRing.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Ring of received frames between the radio callback and the receiver task
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "rxRing.h"
+
+/**
+ * @brief Empty the ring and clear the statistics
+ *
+ * @param ring the ring
+ */
+void rxRingInit(rx_ring_t *ring)
+{
+	ring->head = 0;
+	ring->tail = 0;
+	ring->dropped = 0;
+	ring->highWater = 0;
+}
+
+/**
+ * @brief Get the slot for the next frame. The frame is written in place,
+ * it is visible to the consumer after rxRingCommit().
+ * Producer side only.
+ *
+ * @param ring the ring
+ * @return rx_frame_t* free slot with the sequence number set, NULL if the ring is full (the frame is counted as dropped)
+ */
+rx_frame_t *rxRingReserve(rx_ring_t *ring)
+{
+	if (ring->head - ring->tail >= RX_RING_SLOTS)
+	{
+		ring->dropped++;
+		return NULL;
+	}
+	rx_frame_t *frame = &ring->frame[ring->head & (RX_RING_SLOTS - 1)];
+	frame->sequence = (uint16_t)(ring->head + ring->dropped);
+	return frame;
+}
+
+/**
+ * @brief Hand the reserved frame to the consumer.
+ * Producer side only.
+ *
+ * @param ring the ring
+ */
+void rxRingCommit(rx_ring_t *ring)
+{
+	// The frame has to be complete in memory before the consumer sees the new head
+	__sync_synchronize();
+	ring->head = ring->head + 1;
+	uint32_t waiting = ring->head - ring->tail;
+	if (waiting > ring->highWater)
+	{
+		ring->highWater = waiting;
+	}
+}
+
+/**
+ * @brief Oldest frame that is not released yet.
+ * Consumer side only.
+ *
+ * @param ring the ring
+ * @return const rx_frame_t* the frame, NULL if the ring is empty
+ */
+const rx_frame_t *rxRingPeek(const rx_ring_t *ring)
+{
+	if (ring->head == ring->tail)
+	{
+		return NULL;
+	}
+	__sync_synchronize();
+	return &ring->frame[ring->tail & (RX_RING_SLOTS - 1)];
+}
+
+/**
+ * @brief Give the slot of the oldest frame back to the producer.
+ * Consumer side only.
+ *
+ * @param ring the ring
+ */
+void rxRingRelease(rx_ring_t *ring)
+{
+	__sync_synchronize();
+	ring->tail = ring->tail + 1;
+}
+
+/**
+ * @brief Number of frames waiting
+ *
+ * @param ring the ring
+ * @return uint32_t frames committed and not released
+ */
+uint32_t rxRingCount(const rx_ring_t *ring)
+{
+	return ring->head - ring->tail;
+}
+
@@ -0,0 +1,313 @@
+/**
+ * @file rxStream.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief COBS framed binary stream between receiver and host, received frames up and downlink commands down
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "rxStream.h"
+
+/** CRC-16 CCITT of each nibble, two lookups per byte instead of eight shifts */
+static const uint16_t crcNibble[16] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF};
+
+/**
+ * @brief CRC-16 CCITT, polynomial 0x1021, start 0xFFFF
+ *
+ * @param data bytes
+ * @param size number of bytes
+ * @return uint16_t CRC
+ */
+uint16_t streamCrc16(const uint8_t *data, uint16_t size)
+{
+	uint16_t crc = 0xFFFF;
+	for (uint16_t idx = 0; idx < size; idx++)
+	{
+		crc = (uint16_t)(crc << 4) ^ crcNibble[(crc >> 12) ^ (data[idx] >> 4)];
+		crc = (uint16_t)(crc << 4) ^ crcNibble[(crc >> 12) ^ (data[idx] & 0x0F)];
+	}
+	return crc;
+}
+
+/**
+ * @brief Consistent overhead byte stuffing, the output has no 0x00
+ *
+ * @param data bytes to encode
+ * @param size number of bytes
+ * @param out encoded bytes, at least size + size / 254 + 1 bytes
+ * @return uint16_t number of encoded bytes
+ */
+uint16_t cobsEncode(const uint8_t *data, uint16_t size, uint8_t *out)
+{
+	uint16_t code = 0;
+	uint16_t length = 1;
+	out[code] = 1;
+	for (uint16_t idx = 0; idx < size; idx++)
+	{
+		if (data[idx] != 0)
+		{
+			out[length++] = data[idx];
+			out[code]++;
+		}
+		if ((data[idx] == 0) || (out[code] == 0xFF))
+		{
+			code = length++;
+			out[code] = 1;
+		}
+	}
+	return length;
+}
+
+/**
+ * @brief Undo cobsEncode()
+ *
+ * @param data encoded bytes without the delimiter
+ * @param size number of encoded bytes
+ * @param out decoded bytes, at least size bytes
+ * @return int16_t number of decoded bytes, -1 if the encoding is invalid
+ */
+int16_t cobsDecode(const uint8_t *data, uint16_t size, uint8_t *out)
+{
+	uint16_t length = 0;
+	uint16_t idx = 0;
+	while (idx < size)
+	{
+		uint8_t code = data[idx++];
+		if ((code == 0) || (idx + code - 1 > size))
+		{
+			return -1;
+		}
+		for (uint8_t copy = 1; copy < code; copy++)
+		{
+			if (data[idx] == 0)
+			{
+				return -1;
+			}
+			out[length++] = data[idx++];
+		}
+		// A block shorter than 254 bytes stands for a 0x00, except at the end
+		if ((code != 0xFF) && (idx < size))
+		{
+			out[length++] = 0;
+		}
+	}
+	return length;
+}
+
+/**
+ * @brief Encode a frame as stream message
+ *
+ * @param frame the frame
+ * @param out encoded message with delimiter, at least STREAM_ENCODED_MAX bytes
+ * @return uint16_t number of bytes to send
+ */
+uint16_t streamEncode(const rx_frame_t *frame, uint8_t *out)
+{
+	uint8_t message[STREAM_MESSAGE_MAX];
+	message[0] = STREAM_TYPE_FRAME;
+	message[1] = (uint8_t)frame->sequence;
+	message[2] = (uint8_t)(frame->sequence >> 8);
+	message[3] = (uint8_t)frame->time;
+	message[4] = (uint8_t)(frame->time >> 8);
+	message[5] = (uint8_t)(frame->time >> 16);
+	message[6] = (uint8_t)(frame->time >> 24);
+	message[7] = (uint8_t)frame->rssi;
+	message[8] = (uint8_t)((uint16_t)frame->rssi >> 8);
+	message[9] = (uint8_t)frame->snr;
+	message[10] = frame->channel;
+	for (uint8_t idx = 0; idx < frame->size; idx++)
+	{
+		message[STREAM_HEADER + idx] = frame->data[idx];
+	}
+	uint16_t size = STREAM_HEADER + frame->size;
+	uint16_t crc = streamCrc16(message, size);
+	message[size++] = (uint8_t)crc;
+	message[size++] = (uint8_t)(crc >> 8);
+
+	uint16_t length = cobsEncode(message, size, out);
+	out[length++] = 0;
+	return length;
+}
+
+/**
+ * @brief Reset the parser and its statistics
+ *
+ * @param parser parser state
+ */
+void streamParserInit(stream_parser_t *parser)
+{
+	parser->length = 0;
+	parser->overrun = false;
+	parser->frames = 0;
+	parser->errors = 0;
+	parser->overruns = 0;
+}
+
+/**
+ * @brief Decode one complete message
+ *
+ * @return true if it is a valid frame
+ */
+static bool streamDecode(stream_parser_t *parser, rx_frame_t *frame)
+{
+	uint8_t message[STREAM_ENCODED_MAX];
+	int16_t size = cobsDecode(parser->buffer, parser->length, message);
+	if ((size < STREAM_HEADER + STREAM_CRC) || (size > STREAM_MESSAGE_MAX))
+	{
+		return false;
+	}
+	size -= STREAM_CRC;
+	uint16_t crc = (uint16_t)message[size] | (uint16_t)message[size + 1] << 8;
+	if ((crc != streamCrc16(message, size)) || (message[0] != STREAM_TYPE_FRAME))
+	{
+		return false;
+	}
+	frame->sequence = (uint16_t)message[1] | (uint16_t)message[2] << 8;
+	frame->time = (uint32_t)message[3] | (uint32_t)message[4] << 8 | (uint32_t)message[5] << 16 | (uint32_t)message[6] << 24;
+	frame->rssi = (int16_t)((uint16_t)message[7] | (uint16_t)message[8] << 8);
+	frame->snr = (int8_t)message[9];
+	frame->channel = message[10];
+	frame->size = (uint8_t)(size - STREAM_HEADER);
+	for (uint8_t idx = 0; idx < frame->size; idx++)
+	{
+		frame->data[idx] = message[STREAM_HEADER + idx];
+	}
+	return true;
+}
+
+/**
+ * @brief Collect the bytes of a message up to the delimiter
+ *
+ * @return true if the byte was the delimiter of a message that has to be decoded
+ */
+static bool streamCollect(stream_parser_t *parser, uint8_t byte)
+{
+	if (byte != 0)
+	{
+		if (parser->length < STREAM_ENCODED_MAX)
+		{
+			parser->buffer[parser->length++] = byte;
+		}
+		else if (!parser->overrun)
+		{
+			parser->overrun = true;
+			parser->overruns++;
+		}
+		return false;
+	}
+
+	// Delimiter, empty messages (e.g. two delimiters in a row) are ignored
+	if (parser->overrun || (parser->length == 0))
+	{
+		parser->length = 0;
+		parser->overrun = false;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Count the decoded message and start the next one
+ *
+ * @return valid
+ */
+static bool streamDone(stream_parser_t *parser, bool valid)
+{
+	if (valid)
+	{
+		parser->frames++;
+	}
+	else
+	{
+		parser->errors++;
+	}
+	parser->length = 0;
+	parser->overrun = false;
+	return valid;
+}
+
+/**
+ * @brief Feed one byte of the stream into the parser
+ *
+ * @param parser parser state
+ * @param byte next byte of the stream
+ * @param frame filled with the frame if the byte completed a valid message
+ * @return true if frame holds a new frame
+ */
+bool streamParse(stream_parser_t *parser, uint8_t byte, rx_frame_t *frame)
+{
+	if (!streamCollect(parser, byte))
+	{
+		return false;
+	}
+	return streamDone(parser, streamDecode(parser, frame));
+}
+
+/**
+ * @brief Write a downlink command for the receiver, the host to receiver direction of the stream
+ *
+ * @param deviceId node the command is for
+ * @param command command bytes
+ * @param size size of the command, at most RX_FRAME_MAX
+ * @param out encoded message with delimiter, at least STREAM_ENCODED_MAX bytes
+ * @return uint16_t number of bytes written
+ */
+uint16_t streamEncodeDownlink(uint8_t deviceId, const uint8_t *command, uint8_t size, uint8_t *out)
+{
+	uint8_t message[STREAM_MESSAGE_MAX];
+	message[0] = STREAM_TYPE_DOWNLINK;
+	message[1] = deviceId;
+	for (uint8_t idx = 0; idx < size; idx++)
+	{
+		message[STREAM_DOWNLINK_HEADER + idx] = command[idx];
+	}
+	uint16_t length = STREAM_DOWNLINK_HEADER + size;
+	uint16_t crc = streamCrc16(message, length);
+	message[length++] = (uint8_t)crc;
+	message[length++] = (uint8_t)(crc >> 8);
+
+	length = cobsEncode(message, length, out);
+	out[length++] = 0;
+	return length;
+}
+
+/**
+ * @brief Feed one byte of the host stream into the parser of the receiver
+ *
+ * @param parser parser state
+ * @param byte next byte of the stream
+ * @param deviceId filled with the node of the command
+ * @param command filled with the command, at least RX_FRAME_MAX bytes
+ * @param size filled with the size of the command
+ * @return true if the byte completed a valid downlink command
+ */
+bool streamParseDownlink(stream_parser_t *parser, uint8_t byte, uint8_t *deviceId, uint8_t *command, uint8_t *size)
+{
+	if (!streamCollect(parser, byte))
+	{
+		return false;
+	}
+	uint8_t message[STREAM_ENCODED_MAX];
+	int16_t length = cobsDecode(parser->buffer, parser->length, message);
+	if ((length <= STREAM_DOWNLINK_HEADER + STREAM_CRC) || (length > STREAM_DOWNLINK_HEADER + RX_FRAME_MAX + STREAM_CRC))
+	{
+		return streamDone(parser, false);
+	}
+	length -= STREAM_CRC;
+	uint16_t crc = (uint16_t)message[length] | (uint16_t)message[length + 1] << 8;
+	if ((crc != streamCrc16(message, length)) || (message[0] != STREAM_TYPE_DOWNLINK))
+	{
+		return streamDone(parser, false);
+	}
+	*deviceId = message[1];
+	*size = (uint8_t)(length - STREAM_DOWNLINK_HEADER);
+	for (uint8_t idx = 0; idx < *size; idx++)
+	{
+		command[idx] = message[STREAM_DOWNLINK_HEADER + idx];
+	}
+	return streamDone(parser, true);
+}
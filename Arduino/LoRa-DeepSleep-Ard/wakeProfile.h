@@ -0,0 +1,90 @@
+/**
+ * @file wakeProfile.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Awake time histogram and per phase statistics, shared between firmware and host tools
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef WAKE_PROFILE_H
+#define WAKE_PROFILE_H
+
+#include <stdint.h>
+
+// Phases of a wake cycle
+#define PROFILE_DISPATCH 0
+#define PROFILE_SENSOR 1
+#define PROFILE_ENCODE 2
+#define PROFILE_CAD 3
+#define PROFILE_TX 4
+#define PROFILE_CALLBACK 5
+#define PROFILE_LOG 6
+#define PROFILE_PHASES 7
+
+// Sources that wake up the loop task, the same values as WAKE_SOURCE_xxx in main.h
+#define PROFILE_SOURCE_RX 0
+#define PROFILE_SOURCE_TIMER 1
+#define PROFILE_SOURCES 2
+
+// Radio events, measured from the DIO1 interrupt to the callback and for the CPU time of the callback.
+// They are logged, not sent in the telemetry.
+#define PROFILE_RADIO_CAD_DONE 0
+#define PROFILE_RADIO_TX_DONE 1
+#define PROFILE_RADIO_TX_TIMEOUT 2
+#define PROFILE_RADIO_RX_DONE 3
+#define PROFILE_RADIO_RX_TIMEOUT 4
+#define PROFILE_RADIO_RX_ERROR 5
+#define PROFILE_RADIO_EVENTS 6
+/** No DIO1 timestamp for the event */
+#define PROFILE_NO_LATENCY 0xFFFFFFFF
+
+/** Histogram buckets, bucket n counts awake times below 256us << n, the last one everything above */
+#define PROFILE_BUCKETS 12
+#define PROFILE_BUCKET0_US 256
+
+/** Version of the telemetry layout */
+#define PROFILE_TELEMETRY_VERSION 2
+/** Size of the encoded telemetry: version, bucket counts, average and maximum per phase and per wake source */
+#define PROFILE_TELEMETRY_SIZE (1 + PROFILE_BUCKETS + PROFILE_PHASES * 4 + PROFILE_SOURCES * 4)
+
+/** Statistics of one phase */
+typedef struct
+{
+	/** Sum of the phase times in us */
+	uint32_t sum;
+	/** Longest phase time in us */
+	uint32_t max;
+	/** Number of times the phase ran */
+	uint16_t count;
+} profile_phase_t;
+
+/** Statistics since the last report */
+typedef struct
+{
+	/** Number of wake cycles per awake time bucket */
+	uint8_t histogram[PROFILE_BUCKETS];
+	profile_phase_t phase[PROFILE_PHASES];
+	/** Time from the wake event to the loop task running, per wake source */
+	profile_phase_t latency[PROFILE_SOURCES];
+	/** Time from the DIO1 interrupt to the radio callback, per radio event */
+	profile_phase_t radioLatency[PROFILE_RADIO_EVENTS];
+	/** CPU time of the radio callback, per radio event */
+	profile_phase_t radioTime[PROFILE_RADIO_EVENTS];
+	/** Number of wake cycles */
+	uint16_t wakes;
+} wake_profile_t;
+
+void profileReset(wake_profile_t *profile);
+void profileAddWake(wake_profile_t *profile, uint32_t awake);
+void profileAddPhase(wake_profile_t *profile, uint8_t phase, uint32_t time);
+void profileAddLatency(wake_profile_t *profile, uint8_t source, uint32_t time);
+void profileAddRadio(wake_profile_t *profile, uint8_t event, uint32_t latency, uint32_t time);
+uint8_t profileEncode(const wake_profile_t *profile, uint8_t *buffer);
+bool profileDecode(wake_profile_t *profile, const uint8_t *buffer, uint8_t size);
+const char *profilePhaseName(uint8_t phase);
+const char *profileSourceName(uint8_t source);
+const char *profileRadioEventName(uint8_t event);
+
+#endif
@@ -0,0 +1,76 @@
+/**
+ * @file wakeTrace.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Binary trace records of the wake cycle, shared between firmware and host converter
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "wakeTrace.h"
+
+static const char *eventName[TRACE_EVENT_NUM] = {
+	"TimerWakeup", "LoopWake", "LoopSleep", "SendStart", "CadStart", "CadDone",
+	"TxStart", "TxDone", "TxTimeout", "RxDone", "RxTimeout", "RxError", "Battery", "RxFrame", "PhaseEnter", "PhaseExit"};
+
+/**
+ * @brief Empty the ring
+ *
+ * @param ring the ring buffer
+ */
+void traceRingInit(trace_ring_t *ring)
+{
+	ring->head = 0;
+	ring->tail = 0;
+}
+
+/**
+ * @brief Add a record. If the ring is full the oldest record is dropped.
+ * Not protected, the caller has to lock if it is used from interrupts.
+ *
+ * @param ring the ring buffer
+ * @param record the record to add
+ */
+void traceRingPut(trace_ring_t *ring, const trace_record_t *record)
+{
+	ring->record[ring->head & (TRACE_RING_SIZE - 1)] = *record;
+	ring->head++;
+	if (ring->head - ring->tail > TRACE_RING_SIZE)
+	{
+		ring->tail = ring->head - TRACE_RING_SIZE;
+	}
+}
+
+/**
+ * @brief Get the oldest unread record
+ *
+ * @param ring the ring buffer
+ * @param record the record
+ * @return true if a record was available
+ */
+bool traceRingGet(trace_ring_t *ring, trace_record_t *record)
+{
+	if (ring->tail == ring->head)
+	{
+		return false;
+	}
+	*record = ring->record[ring->tail & (TRACE_RING_SIZE - 1)];
+	ring->tail++;
+	return true;
+}
+
+/**
+ * @brief Name of a trace point
+ *
+ * @param event TRACE_xxx
+ * @return const char* name
+ */
+const char *traceEventName(uint8_t event)
+{
+	if (event < TRACE_EVENT_NUM)
+	{
+		return eventName[event];
+	}
+	return "?";
+}
@@ -0,0 +1,142 @@
+/**
+ * @file clockDrift.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Estimate the drift of the local clock against time references and compensate timers and guard times
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "clockDrift.h"
+
+#include <string.h>
+
+#define PPB 1000000000LL
+
+/**
+ * @brief Start without drift estimate, the corrected clock starts at the local time
+ *
+ * @param clock the estimate
+ * @param local local time in ms
+ */
+void driftInit(clock_drift_t *clock, uint32_t local)
+{
+	memset(clock, 0, sizeof(clock_drift_t));
+	clock->localAnchor = local;
+	clock->correctedAnchor = local;
+}
+
+/**
+ * @brief Add a time reference.
+ * Only the intervals between references are used, so a constant delay between the
+ * timestamp of the sender and the local timestamp (e.g. the airtime) does not matter.
+ * References closer than DRIFT_MIN_INTERVAL_MS to the last one are only checked,
+ * the measurement then uses the longer interval to the next one.
+ *
+ * @param clock the estimate
+ * @param local local time in ms when the reference was received
+ * @param remote time of the reference in ms
+ * @return uint8_t DRIFT_MEASURED if the drift estimate changed, DRIFT_ACCEPTED for a
+ * plausible reference without a measurement, DRIFT_REJECTED for a wrong reference
+ */
+uint8_t driftUpdate(clock_drift_t *clock, uint32_t local, uint32_t remote)
+{
+	if (!clock->referenced)
+	{
+		clock->referenced = true;
+		clock->localRef = local;
+		clock->remoteRef = remote;
+		return DRIFT_ACCEPTED;
+	}
+	int64_t localInterval = (int32_t)(local - clock->localRef);
+	int64_t remoteInterval = (int32_t)(remote - clock->remoteRef);
+	if ((remoteInterval < DRIFT_MIN_INTERVAL_MS) && (remoteInterval > -DRIFT_MIN_INTERVAL_MS))
+	{
+		int64_t deviation = localInterval - remoteInterval;
+		int64_t allowed = (remoteInterval < 0 ? -remoteInterval : remoteInterval) * DRIFT_MAX_PPB / PPB + DRIFT_MAX_JITTER_MS;
+		return ((deviation > allowed) || (deviation < -allowed)) ? DRIFT_REJECTED : DRIFT_ACCEPTED;
+	}
+	clock->localRef = local;
+	clock->remoteRef = remote;
+	int64_t measured = (localInterval - remoteInterval) * PPB / remoteInterval;
+	if ((remoteInterval < 0) || (measured > DRIFT_MAX_PPB) || (measured < -DRIFT_MAX_PPB))
+	{
+		// Reference from a different clock or a lost reference, start again from here
+		return DRIFT_REJECTED;
+	}
+
+	// The corrected clock continues without a step with the new estimate
+	clock->correctedAnchor = driftNow(clock, local);
+	clock->localAnchor = local;
+	if (clock->measurements == 0)
+	{
+		clock->drift = (int32_t)measured;
+		clock->spread = 0;
+	}
+	else
+	{
+		int64_t deviation = measured - clock->drift;
+		clock->drift += (int32_t)(deviation / DRIFT_FILTER);
+		if (deviation < 0)
+		{
+			deviation = -deviation;
+		}
+		clock->spread = (uint32_t)((int64_t)clock->spread + (deviation - (int64_t)clock->spread) / DRIFT_FILTER);
+	}
+	if (clock->measurements < 0xFFFF)
+	{
+		clock->measurements++;
+	}
+	return DRIFT_MEASURED;
+}
+
+/**
+ * @brief Drift corrected time. It runs at the rate of the reference clock
+ * and has no steps when the estimate changes.
+ *
+ * @param clock the estimate
+ * @param local local time in ms
+ * @return uint32_t corrected time in ms
+ */
+uint32_t driftNow(const clock_drift_t *clock, uint32_t local)
+{
+	int64_t elapsed = (uint32_t)(local - clock->localAnchor);
+	return clock->correctedAnchor + (uint32_t)(elapsed * PPB / (PPB + clock->drift));
+}
+
+/**
+ * @brief Local time that passes during an interval of the reference clock, e.g. for a timer period
+ *
+ * @param clock the estimate
+ * @param interval interval of the reference clock in ms
+ * @return uint32_t interval of the local clock in ms
+ */
+uint32_t driftLocalInterval(const clock_drift_t *clock, uint32_t interval)
+{
+	return (uint32_t)(((int64_t)interval * (PPB + clock->drift) + PPB / 2) / PPB);
+}
+
+/**
+ * @brief Guard time before a scheduled receive window, interval times the drift uncertainty.
+ * Before the first drift measurement the crystal tolerance DRIFT_DEFAULT_PPB is used.
+ *
+ * @param clock the estimate
+ * @param interval time since the last synchronisation in ms
+ * @param minGuard guard time for the timer resolution and the radio start up in ms
+ * @return uint32_t guard time in ms
+ */
+uint32_t driftGuard(const clock_drift_t *clock, uint32_t interval, uint32_t minGuard)
+{
+	int64_t uncertainty = DRIFT_DEFAULT_PPB;
+	if (clock->measurements != 0)
+	{
+		uncertainty = clock->spread > DRIFT_MIN_UNCERTAINTY_PPB ? clock->spread : DRIFT_MIN_UNCERTAINTY_PPB;
+		if (clock->measurements < DRIFT_FILTER)
+		{
+			// A few measurements are not yet a stable estimate
+			uncertainty += DRIFT_DEFAULT_PPB / (clock->measurements + 1);
+		}
+	}
+	return minGuard + (uint32_t)(((int64_t)interval * uncertainty + PPB - 1) / PPB);
+}
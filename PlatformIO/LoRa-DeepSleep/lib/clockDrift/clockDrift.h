@@ -0,0 +1,60 @@
+/**
+ * @file clockDrift.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Estimate the drift of the local clock against time references and compensate timers and guard times
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef CLOCK_DRIFT_H
+#define CLOCK_DRIFT_H
+
+#include <stdint.h>
+
+/** Shortest time between two references for a drift measurement in ms, millis() has 1ms resolution */
+#define DRIFT_MIN_INTERVAL_MS 60000
+/** Measurements above this are wrong references, in ppb */
+#define DRIFT_MAX_PPB 500000
+/** Drift assumed for the guard time before the first measurement, 32.768kHz crystal plus temperature, in ppb */
+#define DRIFT_DEFAULT_PPB 50000
+/** Lowest drift uncertainty used for the guard time, in ppb */
+#define DRIFT_MIN_UNCERTAINTY_PPB 1000
+/** Weight of a new measurement is 1 / DRIFT_FILTER */
+#define DRIFT_FILTER 4
+/** Time stamp jitter of two references in ms, e.g. beacon and ACK. A reference closer than
+ * DRIFT_MIN_INTERVAL_MS to the last one is wrong if the intervals differ by more than that plus DRIFT_MAX_PPB */
+#define DRIFT_MAX_JITTER_MS 100
+
+/** Results of driftUpdate() */
+#define DRIFT_REJECTED 0
+#define DRIFT_ACCEPTED 1
+#define DRIFT_MEASURED 2
+
+/** Drift estimate and the drift corrected clock */
+typedef struct
+{
+	/** Drift of the local clock in ppb, positive if the local clock is fast */
+	int32_t drift;
+	/** Mean deviation of the measurements from the estimate in ppb */
+	uint32_t spread;
+	/** Number of drift measurements */
+	uint16_t measurements;
+	/** A reference was received */
+	bool referenced;
+	/** Local time and reference time of the last reference */
+	uint32_t localRef;
+	uint32_t remoteRef;
+	/** Local time and corrected time when the drift estimate last changed */
+	uint32_t localAnchor;
+	uint32_t correctedAnchor;
+} clock_drift_t;
+
+void driftInit(clock_drift_t *clock, uint32_t local);
+uint8_t driftUpdate(clock_drift_t *clock, uint32_t local, uint32_t remote);
+uint32_t driftNow(const clock_drift_t *clock, uint32_t local);
+uint32_t driftLocalInterval(const clock_drift_t *clock, uint32_t interval);
+uint32_t driftGuard(const clock_drift_t *clock, uint32_t interval, uint32_t minGuard);
+
+#endif
@@ -0,0 +1,295 @@
+/**
+ * @file downlinkQueue.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Per node downlink queue of the receiver, sends the commands of a node as one batch into its listen window
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "downlinkQueue.h"
+
+#define PPB 1000000000LL
+
+/**
+ * @brief Empty the queue and clear the statistics
+ *
+ * @param queue the queue
+ * @param window listen schedule of the nodes
+ */
+void downlinkInit(downlink_queue_t *queue, const downlink_window_t *window)
+{
+	for (uint8_t idx = 0; idx < DOWNLINK_NODES; idx++)
+	{
+		queue->node[idx].used = false;
+	}
+	queue->window = *window;
+	queue->evict = 0;
+	queue->queued = 0;
+	queue->rejected = 0;
+	queue->batches = 0;
+	queue->longPreambles = 0;
+}
+
+/**
+ * @brief Find the entry of a node, create it if there is none.
+ * If the table is full an entry without queued work is reused,
+ * its schedule is learned again from the next uplink of the node.
+ *
+ * @return downlink_node_t* entry of the node, NULL if all entries have queued work
+ */
+static downlink_node_t *nodeEntry(downlink_queue_t *queue, uint8_t deviceId)
+{
+	downlink_node_t *free = NULL;
+	for (uint8_t idx = 0; idx < DOWNLINK_NODES; idx++)
+	{
+		downlink_node_t *node = &queue->node[idx];
+		if (!node->used)
+		{
+			free = free == NULL ? node : free;
+		}
+		else if (node->deviceId == deviceId)
+		{
+			return node;
+		}
+	}
+	if (free == NULL)
+	{
+		for (uint8_t count = 0; count < DOWNLINK_NODES; count++)
+		{
+			downlink_node_t *node = &queue->node[queue->evict];
+			queue->evict = (queue->evict + 1) % DOWNLINK_NODES;
+			if ((node->size == 0) && !node->timeRequest)
+			{
+				free = node;
+				break;
+			}
+		}
+		if (free == NULL)
+		{
+			return NULL;
+		}
+	}
+	free->used = true;
+	free->deviceId = deviceId;
+	free->known = false;
+	free->timeRequest = false;
+	free->sleepFactor = PAYLOAD_RX_UNKNOWN;
+	free->size = 0;
+	return free;
+}
+
+/**
+ * @brief Queue a command for a node, it is sent with the other commands of the node in the next batch
+ *
+ * @param queue the queue
+ * @param deviceId device ID of the node
+ * @param command command bytes
+ * @param length size of the command
+ * @return true if the command is queued
+ */
+bool downlinkAdd(downlink_queue_t *queue, uint8_t deviceId, const uint8_t *command, uint8_t length)
+{
+	downlink_node_t *node = nodeEntry(queue, deviceId);
+	if ((node == NULL) || (length == 0) || (node->size + 1 + length > DOWNLINK_COMMANDS_MAX))
+	{
+		queue->rejected++;
+		return false;
+	}
+	node->commands[node->size++] = length;
+	for (uint8_t idx = 0; idx < length; idx++)
+	{
+		node->commands[node->size++] = command[idx];
+	}
+	queue->queued++;
+	return true;
+}
+
+/**
+ * @brief An uplink of a node was received, the listen windows of the node start at its end
+ *
+ * @param queue the queue
+ * @param deviceId device ID of the node
+ * @param time receiver time at the end of the uplink in ms
+ * @param timeRequest the node asked for a time reference
+ * @param sleepFactor RX duty cycle sleep factor of the node, PAYLOAD_RX_UNKNOWN or PAYLOAD_RX_OFF
+ */
+void downlinkUplink(downlink_queue_t *queue, uint8_t deviceId, uint32_t time, bool timeRequest, uint8_t sleepFactor)
+{
+	downlink_node_t *node = nodeEntry(queue, deviceId);
+	if (node == NULL)
+	{
+		return;
+	}
+	node->known = true;
+	node->lastUplink = time;
+	node->timeRequest = timeRequest;
+	node->sleepFactor = sleepFactor;
+}
+
+/**
+ * @brief Sleep time of a node in its RX duty cycle, limited like rxSleepTime() on the node
+ *
+ * @param window listen schedule
+ * @param sleepFactor sleep factor of the node
+ * @return uint32_t sleep time in ms
+ */
+uint32_t downlinkSleepTime(const downlink_window_t *window, uint8_t sleepFactor)
+{
+	uint64_t sleepTime = (uint64_t)window->sleepTime * sleepFactor;
+	return sleepTime > DOWNLINK_SLEEP_MAX ? DOWNLINK_SLEEP_MAX : (uint32_t)sleepTime;
+}
+
+/**
+ * @brief Uncertainty of the position of a listen window, grows with the time since the uplink
+ * like clockGuard() on the node
+ *
+ * @param window listen schedule
+ * @param interval time since the end of the uplink in ms
+ * @return uint32_t guard time on each side of the window in ms
+ */
+uint32_t downlinkGuard(const downlink_window_t *window, uint32_t interval)
+{
+	return window->minGuard + (uint32_t)(((int64_t)interval * window->drift + PPB - 1) / PPB);
+}
+
+/**
+ * @brief Find the transmission for one node.
+ * All times are relative to the end of the last uplink of the node. A preamble starting at
+ * start is detected in the window opening at open if it covers detectTime of the window for every
+ * window position within the guard time:
+ *   start <= open - guard + rxTime - detectTime and start + preamble >= open + guard + detectTime
+ * Without the sleep factor of the node only the ACK window is known. Windows more than maxWait
+ * away are left to the ACK window of the next uplink, a preamble reaching that far would cost
+ * more airtime than all the commands of the node.
+ *
+ * @return true if the node can be reached
+ */
+static bool nodePlan(const downlink_window_t *window, const downlink_node_t *node, uint32_t now, downlink_plan_t *plan)
+{
+	if ((window->rxTime < window->detectTime) || (node->sleepFactor == PAYLOAD_RX_OFF))
+	{
+		// The node can not detect a preamble in its listen windows or does not listen
+		return false;
+	}
+	int64_t elapsed = (int32_t)(now - node->lastUplink);
+	int64_t period = (int64_t)window->rxTime + downlinkSleepTime(window, node->sleepFactor);
+	uint32_t lastIndex = node->sleepFactor == PAYLOAD_RX_UNKNOWN ? 0 : UINT32_MAX;
+	int64_t normal = ((int64_t)window->preambleLength * window->symbolTime) / 1000;
+
+	// First window that has not closed yet
+	uint32_t index = 0;
+	if (elapsed > window->openDelay + window->rxTime)
+	{
+		index = (uint32_t)((elapsed - window->openDelay - window->rxTime) / period) + 1;
+	}
+	for (uint8_t tries = 0; (tries < 2) && (index <= lastIndex); tries++, index++)
+	{
+		int64_t open = window->openDelay + index * period;
+		int64_t guard = downlinkGuard(window, (uint32_t)(open + window->rxTime));
+		int64_t latest = open - guard + window->rxTime - window->detectTime;
+		if (elapsed > latest)
+		{
+			continue;
+		}
+		if (open - guard - elapsed > window->maxWait)
+		{
+			return false;
+		}
+		plan->window = index;
+
+		// Wait for the window and send with the normal preamble
+		int64_t start = open + guard + window->detectTime - normal;
+		start = start > elapsed ? start : elapsed;
+		if (start <= latest)
+		{
+			plan->time = node->lastUplink + (uint32_t)start;
+			plan->preamble = window->preambleLength;
+			return true;
+		}
+
+		// The window is too short for the guard time, a longer preamble covers every position of it
+		start = open - guard > elapsed ? open - guard : elapsed;
+		int64_t length = open + guard + window->detectTime - start;
+		int64_t symbols = (length * 1000 + window->symbolTime - 1) / window->symbolTime + window->preambleLength;
+		if (symbols > DOWNLINK_PREAMBLE_MAX)
+		{
+			return false;
+		}
+		plan->time = node->lastUplink + (uint32_t)start;
+		plan->preamble = (uint16_t)(symbols > window->preambleLength ? symbols : window->preambleLength);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Find the next batch to send, the node whose transmission is due first
+ *
+ * @param queue the queue
+ * @param now receiver time in ms, the earliest start of the transmission
+ * @param plan output, node, start time and preamble of the batch
+ * @return true if a batch is waiting for a node with a known schedule
+ */
+bool downlinkPlan(const downlink_queue_t *queue, uint32_t now, downlink_plan_t *plan)
+{
+	bool found = false;
+	for (uint8_t idx = 0; idx < DOWNLINK_NODES; idx++)
+	{
+		const downlink_node_t *node = &queue->node[idx];
+		if (!node->used || !node->known || ((node->size == 0) && !node->timeRequest))
+		{
+			continue;
+		}
+		downlink_plan_t next;
+		if (!nodePlan(&queue->window, node, now, &next))
+		{
+			continue;
+		}
+		if (!found || ((int32_t)(next.time - plan->time) < 0))
+		{
+			next.node = idx;
+			*plan = next;
+			found = true;
+		}
+	}
+	return found;
+}
+
+/**
+ * @brief Write the batch of the planned node: its queued commands and the time reference
+ * ACK if the last uplink asked for one. The commands are removed from the queue.
+ * The node restarts its listen windows when it receives the batch, so the schedule is
+ * unknown until its next uplink.
+ *
+ * @param queue the queue
+ * @param plan plan from downlinkPlan()
+ * @param buffer output, at least DOWNLINK_BATCH_MAX bytes
+ * @return uint8_t size of the batch
+ */
+uint8_t downlinkBuild(downlink_queue_t *queue, const downlink_plan_t *plan, uint8_t *buffer)
+{
+	downlink_node_t *node = &queue->node[plan->node];
+	uint8_t size = batchStart(node->deviceId, buffer);
+	for (uint8_t idx = 0; idx < node->size; idx++)
+	{
+		buffer[size++] = node->commands[idx];
+	}
+	if (node->timeRequest)
+	{
+		// The ACK carries the receiver time at the end of the uplink
+		uint8_t ack[TIME_FRAME_SIZE];
+		size = batchAdd(buffer, size, ack, timeFrameEncode(TIME_FRAME_ACK, node->lastUplink, ack));
+	}
+	node->size = 0;
+	node->timeRequest = false;
+	node->known = false;
+
+	queue->batches++;
+	if (plan->preamble > queue->window.preambleLength)
+	{
+		queue->longPreambles++;
+	}
+	return size;
+}
@@ -0,0 +1,165 @@
+/**
+ * @file energyModel.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Charge accounting per consumer, shared between firmware and host tools
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "energyModel.h"
+
+#include <string.h>
+
+/**
+ * Default currents in uA.
+ * Sleep is the measured TX-only sleep current from the README,
+ * the radio values are from the SX1262 datasheet,
+ * MCU is the nRF52840 running from flash with DCDC enabled.
+ */
+static const uint32_t defaultCurrent[ENERGY_NUM] = {
+	120,	// ENERGY_SLEEP
+	3300,	// ENERGY_MCU
+	118000, // ENERGY_RADIO_TX at 22dBm
+	4600,	// ENERGY_RADIO_RX
+	4600,	// ENERGY_RADIO_CAD
+	2000,	// ENERGY_LED
+	1000,	// ENERGY_SERIAL
+};
+
+static const char *consumerName[ENERGY_NUM] = {
+	"Sleep", "MCU", "TX", "RX", "CAD", "LED", "Serial"};
+
+/**
+ * @brief Reset all counters and load the default currents
+ *
+ * @param model the model to initialize
+ */
+void energyInit(energy_model_t *model)
+{
+	memset(model, 0, sizeof(energy_model_t));
+	memcpy(model->current, defaultCurrent, sizeof(defaultCurrent));
+}
+
+/**
+ * @brief Change the current of a consumer, e.g. after the TX power changed.
+ * Already accounted charge is not changed.
+ *
+ * @param model the model
+ * @param consumer ENERGY_xxx
+ * @param current current in uA
+ */
+void energySetCurrent(energy_model_t *model, uint8_t consumer, uint32_t current)
+{
+	if (consumer < ENERGY_NUM)
+	{
+		model->current[consumer] = current;
+	}
+}
+
+/**
+ * @brief Add on-time of a consumer
+ *
+ * @param model the model
+ * @param consumer ENERGY_xxx
+ * @param ms on-time in milliseconds
+ */
+void energyAccount(energy_model_t *model, uint8_t consumer, uint32_t ms)
+{
+	if (consumer < ENERGY_NUM)
+	{
+		model->time[consumer] += ms;
+		model->charge[consumer] += (uint64_t)model->current[consumer] * ms;
+	}
+}
+
+/**
+ * @brief Sum of the charge of all consumers
+ *
+ * @param model the model
+ * @return uint64_t charge in nC
+ */
+uint64_t energyTotalCharge(const energy_model_t *model)
+{
+	uint64_t total = 0;
+	for (uint8_t consumer = 0; consumer < ENERGY_NUM; consumer++)
+	{
+		total += model->charge[consumer];
+	}
+	return total;
+}
+
+/**
+ * @brief Accumulated on-time of a consumer
+ *
+ * @param model the model
+ * @param consumer ENERGY_xxx
+ * @return uint64_t on-time in milliseconds
+ */
+uint64_t energyTotalTime(const energy_model_t *model, uint8_t consumer)
+{
+	if (consumer < ENERGY_NUM)
+	{
+		return model->time[consumer];
+	}
+	return 0;
+}
+
+/**
+ * @brief Average current over the elapsed time
+ *
+ * @param model the model
+ * @param elapsed elapsed time in milliseconds
+ * @return uint32_t average current in uA
+ */
+uint32_t energyAverageCurrent(const energy_model_t *model, uint64_t elapsed)
+{
+	if (elapsed == 0)
+	{
+		return 0;
+	}
+	return (uint32_t)(energyTotalCharge(model) / elapsed);
+}
+
+/**
+ * @brief SX1262 supply current for a TX power, interpolated from the
+ * datasheet table for the high power PA
+ *
+ * @param txPower TX power in dBm
+ * @return uint32_t current in uA
+ */
+uint32_t energyTxCurrent(int8_t txPower)
+{
+	static const int8_t power[] = {-9, 0, 10, 14, 17, 20, 22};
+	static const uint32_t current[] = {17000, 24000, 42000, 45000, 58000, 84000, 118000};
+	const uint8_t entries = sizeof(power) / sizeof(power[0]);
+
+	if (txPower <= power[0])
+	{
+		return current[0];
+	}
+	for (uint8_t idx = 1; idx < entries; idx++)
+	{
+		if (txPower <= power[idx])
+		{
+			return current[idx - 1] + (current[idx] - current[idx - 1]) * (txPower - power[idx - 1]) / (power[idx] - power[idx - 1]);
+		}
+	}
+	return current[entries - 1];
+}
+
+/**
+ * @brief Name of a consumer for log output
+ *
+ * @param consumer ENERGY_xxx
+ * @return const char* name
+ */
+const char *energyName(uint8_t consumer)
+{
+	if (consumer < ENERGY_NUM)
+	{
+		return consumerName[consumer];
+	}
+	return "?";
+}
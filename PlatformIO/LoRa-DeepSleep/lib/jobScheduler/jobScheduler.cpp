@@ -0,0 +1,164 @@
+/**
+ * @file jobScheduler.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Cooperative scheduler for periodic jobs that coalesces them into as few wakeups as possible
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "jobScheduler.h"
+
+#include <string.h>
+
+/**
+ * @brief Compare two times in ms, works across the wrap of millis()
+ *
+ * @return true if a is before or equal to b
+ */
+static bool notAfter(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b) <= 0;
+}
+
+/**
+ * @brief Remove all jobs and clear the statistics
+ *
+ * @param sched the scheduler
+ */
+void jobInit(job_scheduler_t *sched)
+{
+	memset(sched, 0, sizeof(job_scheduler_t));
+}
+
+/**
+ * @brief Add a periodic job, it is due the first time one period from now
+ *
+ * @param sched the scheduler
+ * @param run the job
+ * @param period period in ms
+ * @param tolerance how long the job may be delayed to share a wakeup with other jobs, in ms
+ * @param now current time in ms
+ * @return int8_t id of the job, -1 if there is no space left
+ */
+int8_t jobAdd(job_scheduler_t *sched, job_run_t run, uint32_t period, uint32_t tolerance, uint32_t now)
+{
+	if ((sched->count >= JOB_MAX) || (period == 0))
+	{
+		return -1;
+	}
+	job_t *job = &sched->job[sched->count];
+	job->run = run;
+	job->period = period;
+	job->tolerance = tolerance;
+	job->last = now;
+	job->due = now + period;
+	job->runs = 0;
+	return (int8_t)sched->count++;
+}
+
+/**
+ * @brief Change the period of a job, counted from its last run
+ *
+ * @param sched the scheduler
+ * @param id id from jobAdd()
+ * @param period new period in ms
+ */
+void jobSetPeriod(job_scheduler_t *sched, int8_t id, uint32_t period)
+{
+	if ((id < 0) || (id >= sched->count) || (period == 0))
+	{
+		return;
+	}
+	job_t *job = &sched->job[id];
+	job->period = period;
+	job->due = job->last + period;
+}
+
+/**
+ * @brief Time of the next wakeup.
+ * The job with the earliest deadline (due + tolerance) must run before its deadline.
+ * All jobs that are due before that deadline share the wakeup, so the wakeup is at
+ * the latest due time of them. Each of them runs inside its tolerance window.
+ *
+ * @param sched the scheduler
+ * @return uint32_t time of the next wakeup in ms
+ */
+uint32_t jobNextWake(const job_scheduler_t *sched)
+{
+	if (sched->count == 0)
+	{
+		return 0;
+	}
+	uint32_t deadline = sched->job[0].due + sched->job[0].tolerance;
+	for (uint8_t idx = 1; idx < sched->count; idx++)
+	{
+		uint32_t jobDeadline = sched->job[idx].due + sched->job[idx].tolerance;
+		if (notAfter(jobDeadline, deadline))
+		{
+			deadline = jobDeadline;
+		}
+	}
+	uint32_t wake = deadline;
+	bool first = true;
+	for (uint8_t idx = 0; idx < sched->count; idx++)
+	{
+		uint32_t due = sched->job[idx].due;
+		if (notAfter(due, deadline) && (first || !notAfter(due, wake)))
+		{
+			wake = due;
+			first = false;
+		}
+	}
+	return wake;
+}
+
+/**
+ * @brief Run all jobs that are due. A job that missed periods runs once and
+ * continues with the next period in the future.
+ *
+ * @param sched the scheduler
+ * @param now current time in ms
+ * @return uint8_t number of jobs that ran
+ */
+uint8_t jobRunDue(job_scheduler_t *sched, uint32_t now)
+{
+	uint8_t ran = 0;
+	for (uint8_t idx = 0; idx < sched->count; idx++)
+	{
+		job_t *job = &sched->job[idx];
+		if (!notAfter(job->due, now))
+		{
+			continue;
+		}
+		job->last = job->due;
+		job->due = job->last + job->period;
+		job->runs++;
+		ran++;
+		// The job can change its own period
+		job->run();
+		while (notAfter(job->due, now))
+		{
+			job->last = job->due;
+			job->due += job->period;
+		}
+	}
+	if (ran != 0)
+	{
+		sched->wakeups++;
+		sched->runs += ran;
+	}
+	return ran;
+}
+
+/**
+ * @brief Wakeups saved compared to one timer per job
+ *
+ * @param sched the scheduler
+ * @return uint32_t job runs that shared a wakeup with another job
+ */
+uint32_t jobWakeupsSaved(const job_scheduler_t *sched)
+{
+	return sched->runs - sched->wakeups;
+}
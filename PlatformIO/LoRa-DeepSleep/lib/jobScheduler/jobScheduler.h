@@ -0,0 +1,56 @@
+/**
+ * @file jobScheduler.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Cooperative scheduler for periodic jobs that coalesces them into as few wakeups as possible
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef JOB_SCHEDULER_H
+#define JOB_SCHEDULER_H
+
+#include <stdint.h>
+
+/** Maximum number of jobs */
+#define JOB_MAX 8
+
+/** A job, runs in the loop task */
+typedef void (*job_run_t)(void);
+
+/** A periodic job */
+typedef struct
+{
+	job_run_t run;
+	/** Period in ms */
+	uint32_t period;
+	/** How long the job may be delayed after it is due, in ms */
+	uint32_t tolerance;
+	/** Time the job is due next in ms */
+	uint32_t due;
+	/** Time the job was due at its last run, the period counts from there */
+	uint32_t last;
+	/** Number of runs */
+	uint32_t runs;
+} job_t;
+
+/** Scheduler state and statistics */
+typedef struct
+{
+	job_t job[JOB_MAX];
+	uint8_t count;
+	/** Number of wakeups that ran jobs */
+	uint32_t wakeups;
+	/** Number of job runs, with one timer per job this would be the number of wakeups */
+	uint32_t runs;
+} job_scheduler_t;
+
+void jobInit(job_scheduler_t *sched);
+int8_t jobAdd(job_scheduler_t *sched, job_run_t run, uint32_t period, uint32_t tolerance, uint32_t now);
+void jobSetPeriod(job_scheduler_t *sched, int8_t id, uint32_t period);
+uint32_t jobNextWake(const job_scheduler_t *sched);
+uint8_t jobRunDue(job_scheduler_t *sched, uint32_t now);
+uint32_t jobWakeupsSaved(const job_scheduler_t *sched);
+
+#endif
@@ -0,0 +1,201 @@
+/**
+ * @file nodePayload.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Layout of the data package sent by sendLoRa(), shared between firmware and host tools
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "nodePayload.h"
+
+/**
+ * @brief Write a package, 16 bit values MSB first
+ *
+ * @param payload content of the package
+ * @param buffer output, at least PAYLOAD_SIZE bytes
+ * @return uint8_t number of bytes written
+ */
+uint8_t payloadEncode(const node_payload_t *payload, uint8_t *buffer)
+{
+	buffer[0] = payload->deviceId;
+	buffer[1] = payload->lightStatus;
+	buffer[2] = payload->lightOn;
+	buffer[3] = payload->temperature;
+	buffer[4] = payload->temperatureFraction;
+	buffer[5] = payload->humidity;
+	buffer[6] = payload->humidityFraction;
+	buffer[7] = (uint8_t)(payload->light >> 8);
+	buffer[8] = (uint8_t)(payload->light);
+	buffer[9] = (uint8_t)(payload->lightThreshold >> 8);
+	buffer[10] = (uint8_t)(payload->lightThreshold);
+	buffer[11] = (uint8_t)payload->rssi;
+	buffer[12] = (uint8_t)((payload->rxSleepFactor << PAYLOAD_RX_SHIFT) | (payload->timeRequest & 0x0F));
+	buffer[13] = payload->secondaryLight;
+	buffer[14] = (uint8_t)(payload->battVoltage >> 8);
+	buffer[15] = (uint8_t)(payload->battVoltage);
+	buffer[16] = (uint8_t)(payload->sampleAge >> 8);
+	buffer[17] = (uint8_t)(payload->sampleAge);
+	return PAYLOAD_SIZE;
+}
+
+/**
+ * @brief Write the sample age into an encoded package
+ *
+ * @param buffer the encoded package
+ * @param age time from the sample to now in ms
+ */
+void payloadSetAge(uint8_t *buffer, uint32_t age)
+{
+	age = (age + PAYLOAD_AGE_UNIT_MS / 2) / PAYLOAD_AGE_UNIT_MS;
+	if (age > 0xFFFF)
+	{
+		age = 0xFFFF;
+	}
+	buffer[PAYLOAD_AGE_OFFSET] = (uint8_t)(age >> 8);
+	buffer[PAYLOAD_AGE_OFFSET + 1] = (uint8_t)age;
+}
+
+/**
+ * @brief Read a package
+ *
+ * @param payload content of the package
+ * @param buffer received bytes
+ * @param size number of received bytes
+ * @return true if the package is long enough
+ */
+bool payloadDecode(node_payload_t *payload, const uint8_t *buffer, uint16_t size)
+{
+	if (size < PAYLOAD_SIZE)
+	{
+		return false;
+	}
+	payload->deviceId = buffer[0];
+	payload->lightStatus = buffer[1];
+	payload->lightOn = buffer[2];
+	payload->temperature = buffer[3];
+	payload->temperatureFraction = buffer[4];
+	payload->humidity = buffer[5];
+	payload->humidityFraction = buffer[6];
+	payload->light = (uint16_t)(buffer[7] << 8 | buffer[8]);
+	payload->lightThreshold = (uint16_t)(buffer[9] << 8 | buffer[10]);
+	payload->rssi = (int8_t)buffer[11];
+	payload->timeRequest = buffer[12] & 0x0F;
+	payload->rxSleepFactor = buffer[12] >> PAYLOAD_RX_SHIFT;
+	payload->secondaryLight = buffer[13];
+	payload->battVoltage = (uint16_t)(buffer[14] << 8 | buffer[15]);
+	payload->sampleAge = (uint16_t)(buffer[16] << 8 | buffer[17]);
+	return true;
+}
+
+/**
+ * @brief Write a time reference downlink
+ *
+ * @param type TIME_FRAME_BEACON or TIME_FRAME_ACK
+ * @param time time of the sender in ms
+ * @param buffer output, at least TIME_FRAME_SIZE bytes
+ * @return uint8_t number of bytes written
+ */
+uint8_t timeFrameEncode(uint8_t type, uint32_t time, uint8_t *buffer)
+{
+	buffer[0] = type;
+	buffer[1] = (uint8_t)(time >> 24);
+	buffer[2] = (uint8_t)(time >> 16);
+	buffer[3] = (uint8_t)(time >> 8);
+	buffer[4] = (uint8_t)(time);
+	return TIME_FRAME_SIZE;
+}
+
+/**
+ * @brief Read a time reference downlink
+ *
+ * @param buffer received bytes
+ * @param size number of received bytes
+ * @param time output, time of the sender in ms
+ * @return uint8_t TIME_FRAME_BEACON or TIME_FRAME_ACK, 0 if the package is no time reference
+ */
+uint8_t timeFrameDecode(const uint8_t *buffer, uint16_t size, uint32_t *time)
+{
+	if ((size != TIME_FRAME_SIZE) || ((buffer[0] != TIME_FRAME_BEACON) && (buffer[0] != TIME_FRAME_ACK)))
+	{
+		return 0;
+	}
+	*time = (uint32_t)buffer[1] << 24 | (uint32_t)buffer[2] << 16 | (uint32_t)buffer[3] << 8 | buffer[4];
+	return buffer[0];
+}
+
+/**
+ * @brief Start a downlink batch
+ *
+ * @param deviceId node the batch is for
+ * @param buffer output, at least DOWNLINK_BATCH_HEADER bytes
+ * @return uint8_t number of bytes written
+ */
+uint8_t batchStart(uint8_t deviceId, uint8_t *buffer)
+{
+	buffer[0] = DOWNLINK_BATCH;
+	buffer[1] = deviceId;
+	return DOWNLINK_BATCH_HEADER;
+}
+
+/**
+ * @brief Append a command to a downlink batch
+ *
+ * @param buffer batch started with batchStart(), 255 bytes
+ * @param size current size of the batch
+ * @param command command bytes
+ * @param length size of the command
+ * @return uint8_t new size of the batch, unchanged if the command does not fit
+ */
+uint8_t batchAdd(uint8_t *buffer, uint8_t size, const uint8_t *command, uint8_t length)
+{
+	if ((length == 0) || ((uint16_t)size + 1 + length > 255))
+	{
+		return size;
+	}
+	buffer[size++] = length;
+	for (uint8_t idx = 0; idx < length; idx++)
+	{
+		buffer[size++] = command[idx];
+	}
+	return size;
+}
+
+/**
+ * @brief Check if a received package is a downlink batch for a node
+ *
+ * @param buffer received bytes
+ * @param size number of received bytes
+ * @param deviceId device ID of the node
+ * @return true if the batch is addressed to the node
+ */
+bool batchFor(const uint8_t *buffer, uint16_t size, uint8_t deviceId)
+{
+	return (size >= DOWNLINK_BATCH_HEADER) && (buffer[0] == DOWNLINK_BATCH) && (buffer[1] == deviceId);
+}
+
+/**
+ * @brief Get the next command of a downlink batch
+ *
+ * @param buffer received batch
+ * @param size number of received bytes
+ * @param offset position of the next command, start with DOWNLINK_BATCH_HEADER
+ * @param command output, points to the command bytes in the buffer
+ * @return uint8_t size of the command, 0 at the end of the batch or if the batch is cut off
+ */
+uint8_t batchNext(const uint8_t *buffer, uint16_t size, uint16_t *offset, const uint8_t **command)
+{
+	if (*offset >= size)
+	{
+		return 0;
+	}
+	uint8_t length = buffer[*offset];
+	if ((length == 0) || (*offset + 1 + length > size))
+	{
+		return 0;
+	}
+	*command = &buffer[*offset + 1];
+	*offset += 1 + length;
+	return length;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file rxRing.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Ring of received frames between the radio callback and the receiver task
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef RX_RING_H
+#define RX_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Number of frame slots, must be a power of 2 */
+#define RX_RING_SLOTS 16
+/** Largest LoRa payload */
+#define RX_FRAME_MAX 255
+
+/** A received frame with its reception data */
+typedef struct
+{
+	/** micros() at the DIO1 interrupt of RX done, the end of the frame */
+	uint32_t time;
+	/** RSSI in dBm */
+	int16_t rssi;
+	/** SNR in dB */
+	int8_t snr;
+	/** Frames received before this one including dropped ones, a gap shows lost frames */
+	uint16_t sequence;
+	/** Channel index, 0 for a single radio */
+	uint8_t channel;
+	/** Payload size in bytes */
+	uint8_t size;
+	uint8_t data[RX_FRAME_MAX];
+} rx_frame_t;
+
+/**
+ * Single producer (radio callback), single consumer (receiver task) ring.
+ * The producer only writes head, the consumer only writes tail, no lock needed.
+ */
+typedef struct
+{
+	rx_frame_t frame[RX_RING_SLOTS];
+	/** Number of frames committed */
+	volatile uint32_t head;
+	/** Number of frames released */
+	volatile uint32_t tail;
+	/** Frames lost because all slots were in use */
+	uint32_t dropped;
+	/** Highest number of frames waiting at the same time */
+	uint32_t highWater;
+} rx_ring_t;
+
+void rxRingInit(rx_ring_t *ring);
+rx_frame_t *rxRingReserve(rx_ring_t *ring);
+void rxRingCommit(rx_ring_t *ring);
+const rx_frame_t *rxRingPeek(const rx_ring_t *ring);
+void rxRingRelease(rx_ring_t *ring);
+uint32_t rxRingCount(const rx_ring_t *ring);
+
+#endif
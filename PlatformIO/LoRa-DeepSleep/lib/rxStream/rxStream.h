@@ -0,0 +1,65 @@
+/**
+ * @file rxStream.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief COBS framed binary stream between receiver and host, received frames up and downlink commands down
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef RX_STREAM_H
+#define RX_STREAM_H
+
+#include <stdint.h>
+
+#include "rxRing.h"
+
+/**
+ * Message, all values little endian:
+ *   type (1), sequence (2), time (4), RSSI (2), SNR (1), channel (1), payload, CRC-16 (2)
+ * The CRC (CCITT, 0xFFFF start) covers everything before it. The message is COBS encoded
+ * and ends with a 0x00 delimiter, so a parser can start anywhere in the stream.
+ */
+#define STREAM_TYPE_FRAME 0x01
+/**
+ * Downlink command from the host to the receiver, same framing:
+ *   type (1), device ID (1), command, CRC-16 (2)
+ */
+#define STREAM_TYPE_DOWNLINK 0x02
+/** Bytes in front of the payload */
+#define STREAM_HEADER 11
+#define STREAM_CRC 2
+/** Bytes in front of the command of a downlink message */
+#define STREAM_DOWNLINK_HEADER 2
+/** Largest message before COBS encoding */
+#define STREAM_MESSAGE_MAX (STREAM_HEADER + RX_FRAME_MAX + STREAM_CRC)
+/** Largest encoded message including the delimiter, COBS adds one byte per 254 bytes */
+#define STREAM_ENCODED_MAX (STREAM_MESSAGE_MAX + STREAM_MESSAGE_MAX / 254 + 2)
+
+/** Parser state, one per stream */
+typedef struct
+{
+	/** Encoded bytes since the last delimiter */
+	uint8_t buffer[STREAM_ENCODED_MAX];
+	uint16_t length;
+	/** Bytes were lost since the last delimiter, the message is skipped */
+	bool overrun;
+	/** Valid messages */
+	uint32_t frames;
+	/** Messages with a wrong CRC, COBS code or size */
+	uint32_t errors;
+	/** Messages longer than STREAM_ENCODED_MAX */
+	uint32_t overruns;
+} stream_parser_t;
+
+uint16_t streamCrc16(const uint8_t *data, uint16_t size);
+uint16_t cobsEncode(const uint8_t *data, uint16_t size, uint8_t *out);
+int16_t cobsDecode(const uint8_t *data, uint16_t size, uint8_t *out);
+uint16_t streamEncode(const rx_frame_t *frame, uint8_t *out);
+void streamParserInit(stream_parser_t *parser);
+bool streamParse(stream_parser_t *parser, uint8_t byte, rx_frame_t *frame);
+uint16_t streamEncodeDownlink(uint8_t deviceId, const uint8_t *command, uint8_t size, uint8_t *out);
+bool streamParseDownlink(stream_parser_t *parser, uint8_t byte, uint8_t *deviceId, uint8_t *command, uint8_t *size);
+
+#endif
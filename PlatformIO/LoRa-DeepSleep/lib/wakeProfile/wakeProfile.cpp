@@ -0,0 +1,254 @@
+/**
+ * @file wakeProfile.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Awake time histogram and per phase statistics, shared between firmware and host tools
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "wakeProfile.h"
+
+#include <string.h>
+
+static const char *phaseName[PROFILE_PHASES] = {
+	"Dispatch", "Sensor", "Encode", "CAD", "TX", "Callback", "Log"};
+
+static const char *sourceName[PROFILE_SOURCES] = {"RX", "Timer"};
+
+static const char *radioEventName[PROFILE_RADIO_EVENTS] = {
+	"CAD done", "TX done", "TX timeout", "RX done", "RX timeout", "RX error"};
+
+/**
+ * @brief Clear all statistics
+ *
+ * @param profile the statistics
+ */
+void profileReset(wake_profile_t *profile)
+{
+	memset(profile, 0, sizeof(wake_profile_t));
+}
+
+/**
+ * @brief Add the total awake time of one wake cycle to the histogram
+ *
+ * @param profile the statistics
+ * @param awake awake time in us
+ */
+void profileAddWake(wake_profile_t *profile, uint32_t awake)
+{
+	uint8_t bucket = 0;
+	uint32_t limit = PROFILE_BUCKET0_US;
+	while ((bucket < PROFILE_BUCKETS - 1) && (awake >= limit))
+	{
+		bucket++;
+		limit <<= 1;
+	}
+	if (profile->histogram[bucket] < 0xFF)
+	{
+		profile->histogram[bucket]++;
+	}
+	if (profile->wakes < 0xFFFF)
+	{
+		profile->wakes++;
+	}
+}
+
+/**
+ * @brief Add one time to the statistics
+ *
+ * @param stats statistics of a phase or wake source
+ * @param time time in us
+ */
+static void addTime(profile_phase_t *stats, uint32_t time)
+{
+	if (stats->count == 0xFFFF)
+	{
+		return;
+	}
+	stats->sum += time;
+	stats->count++;
+	if (time > stats->max)
+	{
+		stats->max = time;
+	}
+}
+
+/**
+ * @brief Add the time of one phase
+ *
+ * @param profile the statistics
+ * @param phase PROFILE_xxx
+ * @param time phase time in us
+ */
+void profileAddPhase(wake_profile_t *profile, uint8_t phase, uint32_t time)
+{
+	if (phase < PROFILE_PHASES)
+	{
+		addTime(&profile->phase[phase], time);
+	}
+}
+
+/**
+ * @brief Add the wakeup latency of one wake event
+ *
+ * @param profile the statistics
+ * @param source PROFILE_SOURCE_xxx
+ * @param time time from the wake event to the loop task running in us
+ */
+void profileAddLatency(wake_profile_t *profile, uint8_t source, uint32_t time)
+{
+	if (source < PROFILE_SOURCES)
+	{
+		addTime(&profile->latency[source], time);
+	}
+}
+
+/**
+ * @brief Add the measurements of one radio callback
+ *
+ * @param profile the statistics
+ * @param event PROFILE_RADIO_xxx
+ * @param latency time from the DIO1 interrupt to the callback in us, PROFILE_NO_LATENCY if unknown
+ * @param time CPU time of the callback in us
+ */
+void profileAddRadio(wake_profile_t *profile, uint8_t event, uint32_t latency, uint32_t time)
+{
+	if (event >= PROFILE_RADIO_EVENTS)
+	{
+		return;
+	}
+	if (latency != PROFILE_NO_LATENCY)
+	{
+		addTime(&profile->radioLatency[event], latency);
+	}
+	addTime(&profile->radioTime[event], time);
+}
+
+/**
+ * @brief Put a value saturated to 16 bit into the buffer, MSB first
+ */
+static uint8_t *put16(uint8_t *buffer, uint32_t value)
+{
+	if (value > 0xFFFF)
+	{
+		value = 0xFFFF;
+	}
+	*buffer++ = (uint8_t)(value >> 8);
+	*buffer++ = (uint8_t)value;
+	return buffer;
+}
+
+/**
+ * @brief Encode the statistics for the uplink:
+ * version, histogram counts, then average and maximum in us of each phase and of the wakeup
+ * latency of each wake source (16 bit, MSB first)
+ *
+ * @param profile the statistics
+ * @param buffer buffer with at least PROFILE_TELEMETRY_SIZE bytes
+ * @return uint8_t number of bytes written
+ */
+uint8_t profileEncode(const wake_profile_t *profile, uint8_t *buffer)
+{
+	uint8_t *start = buffer;
+	*buffer++ = PROFILE_TELEMETRY_VERSION;
+	memcpy(buffer, profile->histogram, PROFILE_BUCKETS);
+	buffer += PROFILE_BUCKETS;
+	for (uint8_t phase = 0; phase < PROFILE_PHASES; phase++)
+	{
+		const profile_phase_t *stats = &profile->phase[phase];
+		buffer = put16(buffer, stats->count ? stats->sum / stats->count : 0);
+		buffer = put16(buffer, stats->max);
+	}
+	for (uint8_t source = 0; source < PROFILE_SOURCES; source++)
+	{
+		const profile_phase_t *stats = &profile->latency[source];
+		buffer = put16(buffer, stats->count ? stats->sum / stats->count : 0);
+		buffer = put16(buffer, stats->max);
+	}
+	return (uint8_t)(buffer - start);
+}
+
+/**
+ * @brief Decode telemetry from the uplink. The phase and latency sums are restored as average times count 1.
+ *
+ * @param profile the statistics
+ * @param buffer the encoded telemetry
+ * @param size size of the encoded telemetry
+ * @return true if the telemetry was valid
+ */
+bool profileDecode(wake_profile_t *profile, const uint8_t *buffer, uint8_t size)
+{
+	if ((size < PROFILE_TELEMETRY_SIZE) || (buffer[0] != PROFILE_TELEMETRY_VERSION))
+	{
+		return false;
+	}
+	profileReset(profile);
+	buffer++;
+	for (uint8_t bucket = 0; bucket < PROFILE_BUCKETS; bucket++)
+	{
+		profile->histogram[bucket] = *buffer++;
+		profile->wakes += profile->histogram[bucket];
+	}
+	for (uint8_t phase = 0; phase < PROFILE_PHASES; phase++)
+	{
+		profile->phase[phase].sum = ((uint32_t)buffer[0] << 8) | buffer[1];
+		profile->phase[phase].max = ((uint32_t)buffer[2] << 8) | buffer[3];
+		profile->phase[phase].count = 1;
+		buffer += 4;
+	}
+	for (uint8_t source = 0; source < PROFILE_SOURCES; source++)
+	{
+		profile->latency[source].sum = ((uint32_t)buffer[0] << 8) | buffer[1];
+		profile->latency[source].max = ((uint32_t)buffer[2] << 8) | buffer[3];
+		profile->latency[source].count = 1;
+		buffer += 4;
+	}
+	return true;
+}
+
+/**
+ * @brief Name of a phase
+ *
+ * @param phase PROFILE_xxx
+ * @return const char* name
+ */
+const char *profilePhaseName(uint8_t phase)
+{
+	if (phase < PROFILE_PHASES)
+	{
+		return phaseName[phase];
+	}
+	return "?";
+}
+
+/**
+ * @brief Name of a wake source
+ *
+ * @param source PROFILE_SOURCE_xxx
+ * @return const char* name
+ */
+const char *profileSourceName(uint8_t source)
+{
+	if (source < PROFILE_SOURCES)
+	{
+		return sourceName[source];
+	}
+	return "?";
+}
+
+/**
+ * @brief Name of a radio event
+ *
+ * @param event PROFILE_RADIO_xxx
+ * @return const char* name
+ */
+const char *profileRadioEventName(uint8_t event)
+{
+	if (event < PROFILE_RADIO_EVENTS)
+	{
+		return radioEventName[event];
+	}
+	return "?";
+}
@@ -0,0 +1,84 @@
+/**
+ * @file wakeTrace.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Binary trace records of the wake cycle, shared between firmware and host converter
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef WAKE_TRACE_H
+#define WAKE_TRACE_H
+
+#include <stdint.h>
+
+// Trace points
+#define TRACE_TIMER_WAKEUP 0
+#define TRACE_LOOP_WAKE 1
+#define TRACE_LOOP_SLEEP 2
+#define TRACE_SEND_START 3
+#define TRACE_CAD_START 4
+#define TRACE_CAD_DONE 5
+#define TRACE_TX_START 6
+#define TRACE_TX_DONE 7
+#define TRACE_TX_TIMEOUT 8
+/** arg is the SNR, data the package size in the low byte and -RSSI in the high byte */
+#define TRACE_RX_DONE 9
+#define TRACE_RX_TIMEOUT 10
+#define TRACE_RX_ERROR 11
+/** data is the raw ADC value of the battery measurement */
+#define TRACE_BATTERY 12
+/** What the node did with a received package, right after TRACE_RX_DONE. arg is the TRACE_FRAME_xxx kind,
+ * data the bytes handed to the loop task in the low byte and the time reference type in the high byte */
+#define TRACE_RX_FRAME 13
+/** Start and end of a profiler phase, arg is the PROFILE_xxx phase. Only in builds with WAKE_PROFILE and WAKE_TRACE */
+#define TRACE_PHASE_ENTER 14
+#define TRACE_PHASE_EXIT 15
+#define TRACE_EVENT_NUM 16
+
+// Kinds of received packages
+#define TRACE_FRAME_DATA 0
+#define TRACE_FRAME_TIME 1
+#define TRACE_FRAME_BATCH 2
+#define TRACE_FRAME_OTHER_BATCH 3
+
+/** Clock of the DWT cycle counter */
+#define TRACE_CPU_HZ 64000000
+/** FreeRTOS tick rate of the nRF52 core */
+#define TRACE_TICK_HZ 1024
+
+/** One trace record, 12 bytes */
+typedef struct
+{
+	/** DWT cycle counter, only counts while the CPU runs */
+	uint32_t cycles;
+	/** RTC time in 1/1024 s ticks, counts while sleeping */
+	uint32_t ticks;
+	/** TRACE_xxx */
+	uint8_t event;
+	/** Event specific, e.g. CAD result */
+	uint8_t arg;
+	/** Event specific, e.g. package size */
+	uint16_t data;
+} trace_record_t;
+
+/** Number of records in the ring, must be a power of 2 */
+#define TRACE_RING_SIZE 128
+
+/** Ring buffer, the oldest records are overwritten */
+typedef struct
+{
+	trace_record_t record[TRACE_RING_SIZE];
+	/** Total number of records written */
+	uint32_t head;
+	/** Number of records already read */
+	uint32_t tail;
+} trace_ring_t;
+
+void traceRingInit(trace_ring_t *ring);
+void traceRingPut(trace_ring_t *ring, const trace_record_t *record);
+bool traceRingGet(trace_ring_t *ring, trace_record_t *record);
+const char *traceEventName(uint8_t event);
+
+#endif
@@ -0,0 +1,107 @@
+/**
+ * @file battery.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Battery voltage measurement and battery aware settings
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/** Millivolts per LSB with 3.0V reference and 12 bit resolution */
+#define VBAT_MV_PER_LSB (0.73242188F)
+/** Compensation for the resistor divider on the RAK4631 VBAT input */
+#define VBAT_DIVIDER_COMP (1.73F)
+#define REAL_VBAT_MV_PER_LSB (VBAT_DIVIDER_COMP * VBAT_MV_PER_LSB)
+
+/** Last measured battery voltage in mV */
+uint16_t battVoltage = 0;
+/** Current battery level */
+uint8_t battCurrentLevel = BATT_LEVEL_FULL;
+
+#ifdef HARVESTING
+/** Energy neutral controller for solar powered nodes */
+harvest_ctrl_t harvest;
+/** millis() of the last battery check */
+uint32_t lastBattCheck = 0;
+#endif
+
+/**
+ * @brief Setup the SAADC for battery measurement.
+ * With oversampling the core enables burst mode, so one
+ * trigger does all samples and the SAADC is off again after the read.
+ *
+ */
+void initBattery(void)
+{
+	analogReference(AR_INTERNAL_3_0);
+	analogReadResolution(12);
+	analogOversampling(8);
+	// First reading after changing the reference is not reliable
+	analogRead(PIN_VBAT);
+
+#ifdef HARVESTING
+	harvestInit(&harvest, HARVEST_CAPACITANCE, HARVEST_TARGET_MV, HARVEST_MIN_MV);
+#endif
+}
+
+/**
+ * @brief Measure the battery voltage
+ *
+ * @return uint16_t battery voltage in mV
+ */
+uint16_t readBattery(void)
+{
+	uint32_t raw = analogRead(PIN_VBAT);
+	TRACE(TRACE_BATTERY, 0, (uint16_t)raw);
+	battVoltage = (uint16_t)(raw * REAL_VBAT_MV_PER_LSB);
+	return battVoltage;
+}
+
+/**
+ * @brief Measure the battery and adjust send interval,
+ * TX power and RX duty cycle if the battery level changed.
+ * Called from the send job, so it needs no wakeup of its own.
+ *
+ */
+void checkBattery(void)
+{
+	uint16_t voltage = readBattery();
+
+#ifdef HARVESTING
+	// On solar powered nodes the harvesting controller replaces the battery levels
+	uint32_t now = millis();
+	bool changed = harvestUpdate(&harvest, voltage, energyTotalCharge(&energy), now - lastBattCheck);
+	lastBattCheck = now;
+	myLog_d("Storage %dmV harvest %lduA consume %lduA step %d", voltage,
+			(long)harvest.harvestCurrent, (long)harvest.consumeCurrent, harvest.step);
+	if (changed)
+	{
+		const harvest_step_t *step = &harvestLadder[harvest.step];
+		jobSetPeriod(&jobs, sendJob, SLEEP_TIME * step->sleepMultiplier);
+		setLoRaTxPower(step->txPower);
+		setLoRaRxSleepFactor(step->rxSleepFactor);
+	}
+#else
+	// Battery powered nodes follow the battery levels
+	uint8_t level = battLevel(voltage, battCurrentLevel);
+	myLog_d("Battery %dmV level %d", voltage, level);
+
+	if (level == battCurrentLevel)
+	{
+		return;
+	}
+	battCurrentLevel = level;
+
+	myLog_d("Battery level changed, sleep %lds TX %ddBm RX duty cycle %s",
+			(long)(SLEEP_TIME * battPolicy[level].sleepMultiplier / 1000),
+			battPolicy[level].txPower,
+			battPolicy[level].rxDutyCycle ? "on" : "off");
+
+	jobSetPeriod(&jobs, sendJob, SLEEP_TIME * battPolicy[level].sleepMultiplier);
+	setLoRaTxPower(battPolicy[level].txPower);
+	setLoRaRxDutyCycle(battPolicy[level].rxDutyCycle);
+#endif
+}
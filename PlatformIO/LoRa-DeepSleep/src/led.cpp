@@ -0,0 +1,202 @@
+/**
+ * @file led.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Non-blocking LED patterns driven by a RTC based software timer
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+/** Pins of the LEDs */
+static const uint8_t ledPin[LED_NUM] = {LED_BUILTIN, LED_CONN};
+
+/** Running pattern per LED, one bit per step, bit 0 first */
+static uint32_t ledBits[LED_NUM] = {0};
+/** Number of steps in the pattern */
+static uint8_t ledSteps[LED_NUM] = {0};
+/** Current step in the pattern */
+static uint8_t ledStep[LED_NUM] = {0};
+/** Remaining repetitions of the pattern, LED_FOREVER never stops */
+static uint8_t ledRepeat[LED_NUM] = {0};
+/** millis() when the LED was switched on, 0 if it is off */
+static uint32_t ledOnSince[LED_NUM] = {0};
+
+/** Timer stepping through the patterns. It only runs while a pattern is active */
+static TimerHandle_t ledTimer = NULL;
+static StaticTimer_t ledTimerBuffer;
+static bool ledTimerRunning = false;
+
+/**
+ * @brief Switch a LED and account its on-time in the energy model
+ *
+ * @param led LED_GREEN_IDX or LED_BLUE_IDX
+ * @param on true to switch on
+ */
+static void ledWrite(uint8_t led, bool on)
+{
+	if (on && (ledOnSince[led] == 0))
+	{
+		ledOnSince[led] = millis() | 1;
+	}
+	else if (!on && (ledOnSince[led] != 0))
+	{
+		// Bit 0 of ledOnSince is forced to 1, it can be 1ms ahead of millis()
+		int32_t onTime = (int32_t)(millis() - ledOnSince[led]);
+		energyAccount(&energy, ENERGY_LED, onTime > 0 ? onTime : 0);
+		ledOnSince[led] = 0;
+	}
+	digitalWrite(ledPin[led], on ? HIGH : LOW);
+}
+
+/**
+ * @brief Timer event that advances all active patterns by one step
+ *
+ */
+static void ledTick(TimerHandle_t)
+{
+	bool active = false;
+
+	taskENTER_CRITICAL();
+	for (uint8_t led = 0; led < LED_NUM; led++)
+	{
+		if (ledSteps[led] == 0)
+		{
+			continue;
+		}
+		ledStep[led]++;
+		if (ledStep[led] >= ledSteps[led])
+		{
+			ledStep[led] = 0;
+			if ((ledRepeat[led] != LED_FOREVER) && (--ledRepeat[led] == 0))
+			{
+				ledSteps[led] = 0;
+				ledWrite(led, false);
+				continue;
+			}
+		}
+		ledWrite(led, (ledBits[led] >> ledStep[led]) & 1);
+		active = true;
+	}
+	if (!active)
+	{
+		ledTimerRunning = false;
+	}
+	taskEXIT_CRITICAL();
+
+	if (!active)
+	{
+		xTimerStop(ledTimer, 0);
+	}
+}
+
+/**
+ * @brief Setup the LED pins and the pattern timer
+ *
+ */
+void ledInit(void)
+{
+	for (uint8_t led = 0; led < LED_NUM; led++)
+	{
+		pinMode(ledPin[led], OUTPUT);
+		digitalWrite(ledPin[led], LOW);
+	}
+	ledTimer = xTimerCreateStatic("LED", pdMS_TO_TICKS(LED_STEP_MS), pdTRUE, NULL, ledTick, &ledTimerBuffer);
+}
+
+/**
+ * @brief Start a pattern on a LED, replacing the running one.
+ * Returns immediately, the pattern timer does the rest.
+ * LED indications are only shown in debug builds.
+ *
+ * @param led LED_GREEN_IDX or LED_BLUE_IDX
+ * @param bits pattern, one bit per LED_STEP_MS step, bit 0 first
+ * @param steps number of steps (1 to 32)
+ * @param repeat number of repetitions, LED_FOREVER never stops
+ */
+void ledPattern(uint8_t led, uint32_t bits, uint8_t steps, uint8_t repeat)
+{
+#if MYLOG_LOG_LEVEL > MYLOG_LOG_LEVEL_NONE
+	if ((led >= LED_NUM) || (steps == 0) || (steps > 32) || (repeat == 0))
+	{
+		return;
+	}
+	bool startTimer = false;
+
+	taskENTER_CRITICAL();
+	ledBits[led] = bits;
+	ledSteps[led] = steps;
+	ledStep[led] = 0;
+	ledRepeat[led] = repeat;
+	ledWrite(led, bits & 1);
+	if (!ledTimerRunning)
+	{
+		ledTimerRunning = true;
+		startTimer = true;
+	}
+	taskEXIT_CRITICAL();
+
+	if (startTimer)
+	{
+		xTimerStart(ledTimer, 0);
+	}
+#else
+	// Release builds show no LED indications
+	(void)led;
+	(void)bits;
+	(void)steps;
+	(void)repeat;
+#endif
+}
+
+/**
+ * @brief Stop the pattern and switch the LED off
+ *
+ * @param led LED_GREEN_IDX or LED_BLUE_IDX
+ */
+void ledOff(uint8_t led)
+{
+	if (led >= LED_NUM)
+	{
+		return;
+	}
+	taskENTER_CRITICAL();
+	ledSteps[led] = 0;
+	ledWrite(led, false);
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Short single flash
+ *
+ * @param led LED_GREEN_IDX or LED_BLUE_IDX
+ */
+void ledFlash(uint8_t led)
+{
+	ledPattern(led, 0b1, 1, 1);
+}
+
+/**
+ * @brief Blink code for error states: code short flashes followed by a pause
+ *
+ * @param led LED_GREEN_IDX or LED_BLUE_IDX
+ * @param code number of flashes (1 to 8)
+ * @param repeat number of repetitions, LED_FOREVER never stops
+ */
+void ledBlinkCode(uint8_t led, uint8_t code, uint8_t repeat)
+{
+	if ((code == 0) || (code > 8))
+	{
+		return;
+	}
+	uint32_t bits = 0;
+	for (uint8_t flash = 0; flash < code; flash++)
+	{
+		// 1 step on, 2 steps off
+		bits |= 1UL << (flash * 3);
+	}
+	// 8 steps pause after the code
+	ledPattern(led, bits, code * 3 + 8, repeat);
+}
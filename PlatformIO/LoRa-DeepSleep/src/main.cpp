@@ -10,11 +10,20 @@
  */
 #include "main.h"
 
-/** Semaphore used by events to wake up loop task */
-SemaphoreHandle_t taskEvent = NULL;
+/** Loop task, the events wake it up with one notification bit per wake source */
+TaskHandle_t loopTask = NULL;
 
-/** Timer to wakeup task frequently and send message */
-SoftwareTimer taskWakeupTimer;
+/** Timer to wakeup task for the jobs */
+TimerHandle_t taskWakeupTimer = NULL;
+static StaticTimer_t taskWakeupTimerBuffer;
+
+/** Periodic jobs, they share the wakeups of taskWakeupTimer */
+job_scheduler_t jobs;
+/** Job that measures the battery and sends the data package */
+int8_t sendJob = -1;
+
+/** millis() when the loop task went to sleep */
+uint32_t sleepStart = 0;
 
 /** Buffer for received LoRaWan data */
 uint8_t rcvdLoRaData[256];
@@ -22,51 +31,158 @@ uint8_t rcvdLoRaData[256];
 uint8_t rcvdDataLen = 0;
 
 /**
- * @brief Flag for the event type
- * -1 => no event
- * 0 => LoRaWan data received
- * 1 => Timer wakeup
- * 2 => tbd
- * ...
+ * @brief Wake up the loop task for an event.
+ * Both wake sources run in tasks, the software timer callbacks in the timer task and the
+ * radio callbacks in the radio task of the SX126x library. Every source sets its own
+ * notification bit, so an event that arrives while the loop task handles another one
+ * is kept for the next wait and not overwritten.
+ *
+ * @param event WAKE_SOURCE_xxx, same value as PROFILE_SOURCE_xxx
+ */
+void wakeLoopTask(uint8_t event)
+{
+	if (loopTask == NULL)
+	{
+		return;
+	}
+	PROFILE_WAKE_SOURCE(event);
+	xTaskNotify(loopTask, 1UL << event, eSetBits);
+}
+
+/**
+ * @brief Read the sensors and encode the next package
+ *
+ */
+void sampleData(void)
+{
+	/// \todo read sensor or whatever you need to do frequently
+	/// Give the sensor bus an entry in the power manager and wrap the sensor access into
+	/// periphAcquire() and periphRelease(), so the TWIM is only powered while the sensor is read
+
+	// Check the battery, the ADC piggybacks on this wakeup
+	PROFILE_ENTER(PROFILE_SENSOR);
+	checkBattery();
+	PROFILE_EXIT(PROFILE_SENSOR);
+
+	prepareLoRa();
+}
+
+/**
+ * @brief Send job: sample the data and send the data package
+ *
+ */
+void sendData(void)
+{
+#ifdef PIPELINED_WAKE
+	// Start CAD and TX of the package sampled in the last wake cycle, the next package
+	// is sampled while the radio is busy. The radio callbacks preempt the loop task,
+	// the loop task sleeps as soon as the sampling is done.
+	myLog_d("Initiate sending");
+	sendLoRa();
+	sampleData();
+#else
+	sampleData();
+
+	// Send the data package
+	myLog_d("Initiate sending");
+	sendLoRa();
+#endif
+}
+
+/**
+ * @brief Start the wakeup timer for the next job wakeup
+ *
  */
-uint8_t eventType = -1;
+void scheduleWakeup(void)
+{
+	// The jobs run on the drift corrected clock
+	int32_t wait = (int32_t)(jobNextWake(&jobs) - clockNow());
+	// Changing the period also starts the timer
+	xTimerChangePeriod(taskWakeupTimer, pdMS_TO_TICKS(wait > 0 ? clockTimerPeriod(wait) : 1), 0);
+}
 
 /**
- * @brief Timer event that wakes up the loop task frequently
+ * @brief Check if the jobs have to run. Besides the timer wakeup this catches a wakeup by
+ * another event at the time the timer fires.
+ *
+ * @return true if the next job wakeup is due
+ */
+bool jobsDue(void)
+{
+	return (jobs.count != 0) && ((int32_t)(jobNextWake(&jobs) - clockNow()) <= TIMER_EARLY_MS);
+}
+
+/**
+ * @brief Run the jobs that are due and start the timer for the next ones
+ *
+ */
+void runJobs(void)
+{
+	// The timer has tick resolution and can fire up to a tick before the planned wakeup.
+	// A timer wakeup for a wakeup that already ran with another event runs nothing.
+	uint32_t now = clockNow();
+	uint32_t wake = jobNextWake(&jobs);
+	if (((int32_t)(wake - now) > 0) && ((int32_t)(wake - now) <= TIMER_EARLY_MS))
+	{
+		now = wake;
+	}
+	jobRunDue(&jobs, now);
+	myLog_d("%ld job runs in %ld wakeups, %ld saved by coalescing", (long)jobs.runs, (long)jobs.wakeups, (long)jobWakeupsSaved(&jobs));
+	scheduleWakeup();
+}
+
+/**
+ * @brief Timer event that wakes up the loop task frequently.
+ * Runs in the FreeRTOS timer task, not in the RTC interrupt.
  * 
  * @param unused 
  */
 void periodicWakeup(TimerHandle_t unused)
 {
-	// Switch on blue LED to show we are awake
-#if MYLOG_LOG_LEVEL > MYLOG_LOG_LEVEL_NONE
-	digitalWrite(LED_CONN, HIGH);
+#ifdef WAKE_PROFILE
+	profileWakeCycle();
 #endif
-	eventType = 1;
-	// Give the semaphore, so the loop task will wake up
-	xSemaphoreGiveFromISR(taskEvent, pdFALSE);
+	TRACE(TRACE_TIMER_WAKEUP, 0, 0);
+	PROFILE_ENTER(PROFILE_DISPATCH);
+	// Notify the loop task, so it will wake up
+	wakeLoopTask(WAKE_SOURCE_TIMER);
 }
 
 void setup()
 {
+	// setup() runs in the loop task, the wake sources notify it
+	loopTask = xTaskGetCurrentTaskHandle();
+	periphInit();
+
+	// Setup the energy accounting
+	energyInit(&energy);
+
+#ifdef WAKE_TRACE
+	traceInit();
+#endif
+#ifdef WAKE_PROFILE
+	profileInit();
+#endif
+
 	// Setup the build in LED
-	pinMode(LED_BUILTIN, OUTPUT);
-	pinMode(LED_CONN, OUTPUT);
-	digitalWrite(LED_CONN, LOW);
+	ledInit();
+
+	// Setup the battery measurement
+	initBattery();
 
 #if MYLOG_LOG_LEVEL > MYLOG_LOG_LEVEL_NONE
-	digitalWrite(LED_BUILTIN, HIGH);
+	// Blink green LED while waiting for a terminal
+	ledPattern(LED_GREEN_IDX, 0b0011, 4, LED_FOREVER);
 	// Start serial
-	Serial.begin(115200);
+	periphAcquire(PERIPH_SERIAL);
 
-	// Wait max 5 seconds for a terminal to connect
+	// Wait max 5 seconds for a terminal to connect, but only if there is a USB host at all
 	time_t timeout = millis();
-	while (!Serial)
+	while (usbHostPresent() && !Serial)
 	{
 		if ((millis() - timeout) < 15000)
 		{
 			delay(100);
-			digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
 		}
 		else
 		{
@@ -78,78 +194,96 @@ void setup()
 	myLog_d("====================================");
 #endif
 	// Switch off LED
-	digitalWrite(LED_BUILTIN, LOW);
-
-	// Create the semaphore
-	myLog_d("Create task semaphore");
-	delay(100); // Give Serial time to send
-	taskEvent = xSemaphoreCreateBinary();
-
-	// Give the semaphore, seems to be required to initialize it
-	myLog_d("Initialize task Semaphore");
-	delay(100); // Give Serial time to send
-	xSemaphoreGive(taskEvent);
-
-	// Take the semaphore, so loop will be stopped waiting to get it
-	myLog_d("Take task Semaphore");
-	delay(100); // Give Serial time to send
-	xSemaphoreTake(taskEvent, 10);
+	ledOff(LED_GREEN_IDX);
 
 	// Start LoRa
 	if (!initLoRa())
 	{
 		myLog_e("Init LoRa failed");
+		ledBlinkCode(LED_GREEN_IDX, 3, LED_FOREVER);
 		while (1)
 		{
 		}
 	}
 	myLog_d("Init LoRa success");
 
-	// Now we are connected, start the timer that will wakeup the loop frequently
+#ifdef RECEIVER
+	// The receiver does not send, the loop task only wakes up for events
+	myLog_d("Start receiver");
+	receiverInit();
+#else
+	// Now we are connected, start the timer that will wakeup the loop for the jobs
 	myLog_d("Start Wakeup Timer");
-	taskWakeupTimer.begin(SLEEP_TIME, periodicWakeup);
-	taskWakeupTimer.start();
+	clockInit();
+	jobInit(&jobs);
+	sendJob = jobAdd(&jobs, sendData, SLEEP_TIME, SEND_TOLERANCE, clockNow());
+	taskWakeupTimer = xTimerCreateStatic("Wakeup", pdMS_TO_TICKS(SLEEP_TIME), pdFALSE, NULL, periodicWakeup, &taskWakeupTimerBuffer);
+	scheduleWakeup();
+#endif
 
 #if MYLOG_LOG_LEVEL > MYLOG_LOG_LEVEL_NONE
 	// Give Serial some time to send everything
-	delay(1000);
+	if (usbHostPresent())
+	{
+		delay(1000);
+	}
+	// Release Serial, it is only powered up while somebody needs it
+	periphRelease(PERIPH_SERIAL);
 #endif
 }
 
 void loop()
 {
-	// Sleep until we are woken up by an event
-	if (xSemaphoreTake(taskEvent, portMAX_DELAY) == pdTRUE)
+	// Sleep until we are woken up by an event, the bits of all wake sources are taken at once
+	uint32_t events = 0;
+	if (xTaskNotifyWait(0, WAKE_SOURCE_ALL, &events, portMAX_DELAY) == pdTRUE)
 	{
-		// Switch on green LED to show we are awake
-#if MYLOG_LOG_LEVEL > MYLOG_LOG_LEVEL_NONE
-		digitalWrite(LED_BUILTIN, HIGH);
-		delay(500); // Only so we can see the green LED
-#endif
+		for (uint8_t source = 0; source < WAKE_SOURCE_NUM; source++)
+		{
+			if (events & (1UL << source))
+			{
+				TRACE(TRACE_LOOP_WAKE, source, 0);
+				PROFILE_WAKE_LATENCY(source);
+			}
+		}
+		PROFILE_EXIT(PROFILE_DISPATCH);
+
+		// Power up Serial for the log output of this wakeup
+		PROFILE_ENTER(PROFILE_LOG);
+		periphAcquire(PERIPH_SERIAL);
+		PROFILE_EXIT(PROFILE_LOG);
 
-		// Check the wake up reason
-		switch (eventType)
+		uint32_t wakeStart = millis();
+		energyAccount(&energy, ENERGY_SLEEP, wakeStart - sleepStart);
+		accountRxDutyCycle(wakeStart - sleepStart);
+
+		// Flash green LED to show we are awake
+		ledFlash(LED_GREEN_IDX);
+
+		// Check the wake up reasons
+		if (events & (1UL << WAKE_SOURCE_RX))
+		{
+			myLog_d("Received package over LoRaWan, %d bytes", rcvdDataLen);
+		}
+		// The jobs run on every wakeup they are due, the timer is only started again by runJobs()
+		if ((events & (1UL << WAKE_SOURCE_TIMER)) || jobsDue())
 		{
-		case 0: // Wakeup reason is package downlink arrived
-			myLog_d("Received package over LoRaWan");
-			break;
-		case 1: // Wakeup reason is timer
 			myLog_d("Timer wakeup");
+			runJobs();
+		}
+		PROFILE_ENTER(PROFILE_LOG);
+		energyLog();
 
-			/// \todo read sensor or whatever you need to do frequently
+		TRACE(TRACE_LOOP_SLEEP, 0, 0);
+#if defined(WAKE_TRACE) && (MYLOG_LOG_LEVEL > MYLOG_LOG_LEVEL_NONE)
+		traceDump();
+#endif
+		PROFILE_EXIT(PROFILE_LOG);
 
-			// Send the data package
-			myLog_d("Initiate sending");
-			sendLoRa();
-			break;
-		default:
-			myLog_d("This should never happen ;-)");
-			break;
-		}
 		// Go back to sleep
-		xSemaphoreTake(taskEvent, 10);
-#if MYLOG_LOG_LEVEL > MYLOG_LOG_LEVEL_NONE
-		digitalWrite(LED_BUILTIN, LOW);
-#endif
+		// Power down the peripherals before sleeping
+		periphRelease(PERIPH_SERIAL);
+		sleepStart = millis();
+		energyAccount(&energy, ENERGY_MCU, sleepStart - wakeStart);
 	}
 }
\ No newline at end of file
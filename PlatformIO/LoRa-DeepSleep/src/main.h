@@ -16,20 +16,186 @@
 // Debug
 #include <myLog.h>
 
+// Energy accounting
+#include <energyModel.h>
+
+// Battery policy
+#include <batteryPolicy.h>
+
+// Layout of the data package
+#include <nodePayload.h>
+
+// Send the package sampled in the last wake cycle first and sample the next one while
+// the radio is busy with CAD and TX, enable with -DPIPELINED_WAKE in platformio.ini
+// #define PIPELINED_WAKE
+
+// Receiver / concentrator role: continuous RX, every received frame is streamed to the
+// host over USB instead of sending sensor data, enable with -DRECEIVER in platformio.ini
+// #define RECEIVER
+
+// Enable for nodes running from a solar panel and a supercapacitor
+// #define HARVESTING
+// Supercapacitor in mF, voltage to keep it at and voltage that forces lowest energy use in mV
+#define HARVEST_CAPACITANCE 10000
+#define HARVEST_TARGET_MV 4000
+#define HARVEST_MIN_MV 3000
+#include <harvestControl.h>
+
+// Wake cycle tracing, enable with -DWAKE_TRACE in platformio.ini
+#include <wakeTrace.h>
+#ifdef WAKE_TRACE
+void traceInit(void);
+void tracePoint(uint8_t event, uint8_t arg, uint16_t data);
+void traceDump(void);
+#define TRACE(event, arg, data) tracePoint(event, arg, data)
+#else
+#define TRACE(event, arg, data)
+#endif
+
+// Awake time profiler, enable with -DWAKE_PROFILE in platformio.ini
+#include <wakeProfile.h>
+/** Number of timer wakeups between two profile reports in the package */
+#define PROFILE_REPORT_WAKES 60
+#ifdef WAKE_PROFILE
+void profileInit(void);
+void profileEnter(uint8_t phase);
+void profileExit(uint8_t phase);
+void profileWakeCycle(void);
+void profileWakeSource(uint8_t source);
+void profileWakeLatency(uint8_t source);
+void profileRadioIrq(void);
+void profileRadioStart(uint8_t event);
+void profileRadioEnd(uint8_t event);
+uint8_t profileTelemetry(uint8_t *buffer);
+#define PROFILE_ENTER(phase) profileEnter(phase)
+#define PROFILE_EXIT(phase) profileExit(phase)
+#define PROFILE_WAKE_SOURCE(source) profileWakeSource(source)
+#define PROFILE_WAKE_LATENCY(source) profileWakeLatency(source)
+#define PROFILE_RADIO_START(event) profileRadioStart(event)
+#define PROFILE_RADIO_END(event) profileRadioEnd(event)
+#else
+#define PROFILE_ENTER(phase)
+#define PROFILE_EXIT(phase)
+#define PROFILE_WAKE_SOURCE(source)
+#define PROFILE_WAKE_LATENCY(source)
+#define PROFILE_RADIO_START(event)
+#define PROFILE_RADIO_END(event)
+#endif
+
 // LoRa stuff
 #include <SX126x-RAK4630.h>
+/** Device ID of the node in the data package, downlink batches are addressed with it */
+#define DEVICE_ID 7
 /* Time the device is sleeping in milliseconds = 2 minutes * 60 seconds * 1000 milliseconds */
 // #define SLEEP_TIME 2 * 60 * 1000
 #define SLEEP_TIME 10 * 1000
+/* How long the send job may be delayed to share a wakeup with other jobs */
+#define SEND_TOLERANCE (SLEEP_TIME / 10)
 
 // LoRaWan stuff
 bool initLoRa(void);
+void prepareLoRa(void);
 void sendLoRa(void);
+void accountRxDutyCycle(uint32_t ms);
+void setLoRaTxPower(int8_t power);
+void setLoRaRxDutyCycle(bool enable);
+void setLoRaRxSleepFactor(uint8_t factor);
+bool isLoRaBusy(void);
+void sendDownlink(uint8_t *data, uint8_t size, uint16_t preamble);
+
+// Receiver stuff
+#include <rxRing.h>
+#include <rxStream.h>
+/** Stack of the receiver task in words */
+#define RECEIVER_STACK_SIZE 512
+/** Bytes of encoded frames written to USB at once, at least STREAM_ENCODED_MAX */
+#define RECEIVER_BATCH_SIZE 1024
+void receiverInit(void);
+void receiverIrq(void);
+void receiverFrame(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr);
+
+// Downlink stuff
+#include <downlinkQueue.h>
+/** Time between two checks of the USB port for downlink commands in ms */
+#define RECEIVER_POLL_TIME 20
+/** Preamble symbols a node needs in its listen window to detect a downlink */
+#define DOWNLINK_DETECT_SYMBOLS 4
+/** Time from the end of an uplink until the node listens, OnTxDone latency, in ms */
+#define DOWNLINK_OPEN_DELAY 2
+/** Longest time a batch waits for a listen window in ms, later windows are left to the ACK window
+ * the next uplink of the node opens after SLEEP_TIME + SEND_TOLERANCE at the latest */
+#define DOWNLINK_MAX_WAIT (SLEEP_TIME + SEND_TOLERANCE)
+void getDownlinkWindow(downlink_window_t *window);
 
 // Main loop stuff
+#include <jobScheduler.h>
+/** Wake sources of the loop task, each sets notification bit (1 << source). Same values as PROFILE_SOURCE_xxx */
+#define WAKE_SOURCE_RX 0
+#define WAKE_SOURCE_TIMER 1
+#define WAKE_SOURCE_NUM 2
+#define WAKE_SOURCE_ALL ((1UL << WAKE_SOURCE_NUM) - 1)
+/** The wakeup timer has tick resolution and can fire this many ms before the planned wakeup */
+#define TIMER_EARLY_MS 2
 void periodicWakeup(TimerHandle_t unused);
-extern SemaphoreHandle_t taskEvent;
+void wakeLoopTask(uint8_t event);
+void sampleData(void);
+void sendData(void);
+void scheduleWakeup(void);
+bool jobsDue(void);
+void runJobs(void);
+extern job_scheduler_t jobs;
+extern int8_t sendJob;
+extern TaskHandle_t loopTask;
 extern uint8_t rcvdLoRaData[];
 extern uint8_t rcvdDataLen;
-extern uint8_t eventType;
-extern SoftwareTimer taskWakeupTimer;
+extern TimerHandle_t taskWakeupTimer;
+
+// Drift corrected clock
+#include <clockDrift.h>
+/** Guard time for the timer resolution and the radio start up in ms */
+#define CLOCK_MIN_GUARD 2
+/** Time after the last time reference the node asks for a new one in ms */
+#define CLOCK_SYNC_MAX_AGE (60 * 60 * 1000)
+void clockInit(void);
+uint32_t clockNow(void);
+uint32_t clockNetworkTime(void);
+bool clockNeedsSync(void);
+uint32_t clockTimerPeriod(uint32_t interval);
+uint32_t clockGuard(uint32_t interval);
+void clockReference(uint32_t local, uint32_t reference);
+void clockTxDone(uint32_t txTime);
+void clockTimeFrame(uint8_t type, uint32_t rxTime, uint32_t reference);
+extern clock_drift_t clockDrift;
+extern bool clockSynced;
+
+// Peripheral power management
+// The SX126x library owns the SPI bus, sensors on Wire get their own entry when they are added
+#define PERIPH_SERIAL 0
+#define PERIPH_NUM 1
+void periphInit(void);
+void periphAcquire(uint8_t periph);
+void periphRelease(uint8_t periph);
+uint32_t periphGetOnTime(uint8_t periph);
+bool usbHostPresent(void);
+void usbDetach(void);
+extern energy_model_t energy;
+
+// Battery monitoring
+void initBattery(void);
+uint16_t readBattery(void);
+void checkBattery(void);
+extern uint16_t battVoltage;
+extern uint8_t battCurrentLevel;
+void energyLog(void);
+
+// LED indications
+#define LED_GREEN_IDX 0
+#define LED_BLUE_IDX 1
+#define LED_NUM 2
+#define LED_STEP_MS 50
+#define LED_FOREVER 0xFF
+void ledInit(void);
+void ledPattern(uint8_t led, uint32_t bits, uint8_t steps, uint8_t repeat);
+void ledOff(uint8_t led);
+void ledFlash(uint8_t led);
+void ledBlinkCode(uint8_t led, uint8_t code, uint8_t repeat);
@@ -0,0 +1,79 @@
+/**
+ * @file trace.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Wake cycle trace points with DWT cycle counter time stamps
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+
+#ifdef WAKE_TRACE
+/** Trace records, dumped to the log before going to sleep */
+static trace_ring_t traceRing;
+
+/**
+ * @brief Start the DWT cycle counter and empty the trace
+ *
+ */
+void traceInit(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	traceRingInit(&traceRing);
+}
+
+/**
+ * @brief Add a trace point. Can be called from tasks, timer callbacks and interrupts.
+ *
+ * @param event TRACE_xxx
+ * @param arg event specific value
+ * @param data event specific value
+ */
+void tracePoint(uint8_t event, uint8_t arg, uint16_t data)
+{
+	trace_record_t record;
+	record.cycles = DWT->CYCCNT;
+	record.ticks = xTaskGetTickCountFromISR();
+	record.event = event;
+	record.arg = arg;
+	record.data = data;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	traceRingPut(&traceRing, &record);
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief Write all new trace records as hex lines into the log.
+ * tools/traceConv extracts them from a captured log.
+ *
+ */
+void traceDump(void)
+{
+	trace_record_t record;
+	while (true)
+	{
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		bool available = traceRingGet(&traceRing, &record);
+		__set_PRIMASK(primask);
+		if (!available)
+		{
+			break;
+		}
+
+		char line[2 * sizeof(trace_record_t) + 1];
+		uint8_t *bytes = (uint8_t *)&record;
+		for (uint8_t idx = 0; idx < sizeof(trace_record_t); idx++)
+		{
+			sprintf(&line[idx * 2], "%02X", bytes[idx]);
+		}
+		PRINTF("#TRACE %s\n", line);
+	}
+}
+#endif
@@ -0,0 +1,497 @@
+/**
+ * @file bench.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Micro benchmarks of the firmware hot paths on the host, with Cortex-M4 cycle estimates and baseline compare
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build:
+ *   g++ -O2 -o bench bench.cpp ../../PlatformIO/LoRa-DeepSleep/lib/myLog/myLog.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/lib/nodePayload/nodePayload.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/lib/wakeProfile/wakeProfile.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/lib/wakeTrace/wakeTrace.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/lib/energyModel/energyModel.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/lib/rxStream/rxStream.cpp
+ *       -I../common -I../../PlatformIO/LoRa-DeepSleep/lib/myLog -I../../PlatformIO/LoRa-DeepSleep/lib/nodePayload
+ *       -I../../PlatformIO/LoRa-DeepSleep/lib/wakeProfile -I../../PlatformIO/LoRa-DeepSleep/lib/wakeTrace
+ *       -I../../PlatformIO/LoRa-DeepSleep/lib/energyModel -I../../PlatformIO/LoRa-DeepSleep/lib/rxStream
+ *       -I../../PlatformIO/LoRa-DeepSleep/lib/rxRing
+ *
+ * Usage:
+ *   bench                          run all benchmarks
+ *   bench save=baseline.txt        run and store the results as baseline
+ *   bench compare=baseline.txt     run and compare with a baseline, marks the regressions
+ *   tolerance=60 (%)               allowed slowdown for compare
+ *   strict=1                       exit code 1 on a regression
+ *
+ * The host time is converted into Cortex-M4 cycles with a calibration loop of known
+ * cycle count. This is a rough estimate (+-50%), it hides differences of the host
+ * and target like flash wait states, but it is independent of the host speed, so the
+ * baselines can be compared between machines. Use the WAKE_PROFILE build for real numbers.
+ * The calibration is measured again next to each benchmark and the median of MEASURE_ROUNDS
+ * estimates counts, so a change of the host clock during the run does not shift the results.
+ * The default tolerance is above the error of the estimate, a benchmark over it is measured
+ * again and only counts as a regression if it stays over it. On a shared or busy host the
+ * results still move by more than that, so compare only reports unless strict=1 is given.
+ */
+#include <chrono>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "energyModel.h"
+#include "nodePayload.h"
+#include "rxStream.h"
+#include "wakeProfile.h"
+#include "wakeTrace.h"
+
+/** Log output of the myLog macros goes into a buffer instead of the serial port */
+static int benchPrintf(const char *format, ...);
+#define PRINTF benchPrintf
+#define MYLOG_LOG_LEVEL MYLOG_LOG_LEVEL_DEBUG
+#include "myLog.h"
+
+/** Cycles of one iteration of the calibration loop on the Cortex-M4: MLA, ADD, SUBS, BNE with pipeline refill */
+#define CALIBRATION_M4_CYCLES 5.0
+/** CPU clock of the nRF52840 */
+#define M4_MHZ 64.0
+/** Minimum run time of one measurement in ns */
+#define MEASURE_NS 20000000.0
+/** Number of measurements, the fastest one counts */
+#define MEASURE_REPEAT 5
+/** Number of cycle estimates of a benchmark, each with its own calibration, the median counts */
+#define MEASURE_ROUNDS 5
+/** Measurements of a benchmark over the tolerance before it counts as a regression */
+#define CONFIRM_RUNS 3
+/** Differences below this number of cycles are noise, not a regression */
+#define NOISE_CYCLES 20.0
+
+/** A benchmark runs its hot path count times */
+typedef void (*bench_func_t)(uint32_t count);
+
+typedef struct
+{
+	const char *name;
+	bench_func_t func;
+} bench_t;
+
+/** Result of one benchmark */
+typedef struct
+{
+	const char *name;
+	/** Host time per call in ns */
+	double hostNs;
+	/** Estimated Cortex-M4 cycles per call */
+	double cycles;
+} result_t;
+
+static char logBuffer[512];
+static size_t logLength = 0;
+
+/**
+ * @brief Keep the compiler from optimizing a result away
+ */
+static inline void keep(const void *value)
+{
+	asm volatile("" : : "g"(value) : "memory");
+}
+
+static int benchPrintf(const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(&logBuffer[logLength], sizeof(logBuffer) - logLength, format, args);
+	va_end(args);
+	if (length > 0)
+	{
+		logLength = (logLength + length) % (sizeof(logBuffer) / 2);
+	}
+	return length;
+}
+
+/**
+ * @brief Dependent multiply-add chain, the reference for the cycle estimate
+ */
+static void benchCalibration(uint32_t count)
+{
+	uint32_t value = 1;
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		value = value * 1103515245 + 12345;
+		asm volatile("" : "+r"(value));
+	}
+	keep(&value);
+}
+
+static void benchPathToFileName(uint32_t count)
+{
+	// A typical PlatformIO build path
+	static const char *path = "/home/user/Documents/PlatformIO/Projects/LoRa-DeepSleep/src/lora.cpp";
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		const char *name = pathToFileNameNRF(path);
+		keep(name);
+	}
+}
+
+static void benchLogMacro(uint32_t count)
+{
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		logLength = 0;
+		myLog_d("Battery %dmV level %d", 3700, 1);
+		keep(logBuffer);
+	}
+}
+
+/**
+ * @brief Same loop as the hex dump in OnRxDone
+ */
+static void hexDump(const uint8_t *payload, uint16_t size)
+{
+	char rcvdData[256 * 4] = {0};
+
+	int index = 0;
+	for (int idx = 0; idx < (size * 3); idx += 3)
+	{
+		sprintf(&rcvdData[idx], "%02X ", payload[index++]);
+	}
+	keep(rcvdData);
+}
+
+static void benchHexDump18(uint32_t count)
+{
+	uint8_t payload[PAYLOAD_SIZE] = {7, 0, 0, 27, 35, 67, 55, 34, 12, 75, 0, 0xB0, 0x10, 0, 0x0E, 0x74, 0, 0};
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		hexDump(payload, sizeof(payload));
+	}
+}
+
+static void benchHexDump255(uint32_t count)
+{
+	uint8_t payload[255];
+	for (int idx = 0; idx < 255; idx++)
+	{
+		payload[idx] = (uint8_t)idx;
+	}
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		hexDump(payload, sizeof(payload));
+	}
+}
+
+static void benchPayloadEncode(uint32_t count)
+{
+	node_payload_t payload = {7, 0, 0, 27, 35, 67, 55, 0x220C, 0x4B00, -80, 0, 0, 3700, 0, 1};
+	uint8_t buffer[PAYLOAD_SIZE];
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		payload.battVoltage = (uint16_t)idx;
+		keep(&payload);
+		payloadEncode(&payload, buffer);
+		keep(buffer);
+	}
+}
+
+static void benchPayloadDecode(uint32_t count)
+{
+	uint8_t buffer[PAYLOAD_SIZE] = {7, 0, 0, 27, 35, 67, 55, 34, 12, 75, 0, 0xB0, 0x10, 0, 0x0E, 0x74, 0, 0};
+	node_payload_t payload;
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		keep(buffer);
+		payloadDecode(&payload, buffer, sizeof(buffer));
+		keep(&payload);
+	}
+}
+
+static void benchProfileEncode(uint32_t count)
+{
+	wake_profile_t profile;
+	profileReset(&profile);
+	for (uint32_t wake = 0; wake < 60; wake++)
+	{
+		profileAddWake(&profile, 3000 + wake * 100);
+		for (uint8_t phase = 0; phase < PROFILE_PHASES; phase++)
+		{
+			profileAddPhase(&profile, phase, 100 * phase + wake);
+		}
+	}
+	uint8_t buffer[PROFILE_TELEMETRY_SIZE];
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		keep(&profile);
+		profileEncode(&profile, buffer);
+		keep(buffer);
+	}
+}
+
+static void benchTraceRing(uint32_t count)
+{
+	static trace_ring_t ring;
+	traceRingInit(&ring);
+	trace_record_t record = {0, 0, TRACE_TX_DONE, 0, 0};
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		record.cycles = idx;
+		traceRingPut(&ring, &record);
+		traceRingGet(&ring, &record);
+		keep(&record);
+	}
+}
+
+/**
+ * @brief Binary message of the receiver role, replaces the hex dump for forwarded frames
+ */
+static void streamEncodeFrame(uint8_t size, uint32_t count)
+{
+	rx_frame_t frame = {0, -80, 7, 0, 0, size, {0}};
+	for (int idx = 0; idx < size; idx++)
+	{
+		frame.data[idx] = (uint8_t)idx;
+	}
+	uint8_t message[STREAM_ENCODED_MAX];
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		frame.sequence = (uint16_t)idx;
+		keep(&frame);
+		streamEncode(&frame, message);
+		keep(message);
+	}
+}
+
+static void benchStreamEncode18(uint32_t count)
+{
+	streamEncodeFrame(PAYLOAD_SIZE, count);
+}
+
+static void benchStreamEncode255(uint32_t count)
+{
+	streamEncodeFrame(255, count);
+}
+
+static void benchEnergyAccount(uint32_t count)
+{
+	energy_model_t model;
+	energyInit(&model);
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		energyAccount(&model, (uint8_t)(idx % ENERGY_NUM), 10);
+		keep(&model);
+	}
+}
+
+static const bench_t benches[] = {
+	{"pathToFileNameNRF", benchPathToFileName},
+	{"myLog_d", benchLogMacro},
+	{"hexDump 18B", benchHexDump18},
+	{"hexDump 255B", benchHexDump255},
+	{"streamEncode 18B", benchStreamEncode18},
+	{"streamEncode 255B", benchStreamEncode255},
+	{"payloadEncode", benchPayloadEncode},
+	{"payloadDecode", benchPayloadDecode},
+	{"profileEncode", benchProfileEncode},
+	{"traceRing put+get", benchTraceRing},
+	{"energyAccount", benchEnergyAccount},
+};
+
+#define BENCH_NUM (sizeof(benches) / sizeof(benches[0]))
+
+/**
+ * @brief Host time per call in ns, fastest of several runs of at least MEASURE_NS
+ */
+static double measure(bench_func_t func)
+{
+	uint32_t count = 16;
+	double best = 1e30;
+	for (int run = 0; run < MEASURE_REPEAT;)
+	{
+		auto start = std::chrono::steady_clock::now();
+		func(count);
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		if (ns < MEASURE_NS)
+		{
+			// Too short to measure, grow the count first
+			count *= 2;
+			continue;
+		}
+		best = ns / count < best ? ns / count : best;
+		run++;
+	}
+	return best;
+}
+
+static int compareDouble(const void *a, const void *b)
+{
+	double diff = *(const double *)a - *(const double *)b;
+	return (diff > 0) - (diff < 0);
+}
+
+/**
+ * @brief Estimated Cortex-M4 cycles per call, median of MEASURE_ROUNDS estimates.
+ * Each estimate uses a calibration measured right before the benchmark.
+ *
+ * @param func benchmark
+ * @param hostNs output, host time per call in ns of the median estimate
+ */
+static double measureCycles(bench_func_t func, double *hostNs)
+{
+	double cycles[MEASURE_ROUNDS];
+	double ns[MEASURE_ROUNDS];
+	for (int round = 0; round < MEASURE_ROUNDS; round++)
+	{
+		double calibration = measure(benchCalibration);
+		ns[round] = measure(func);
+		cycles[round] = ns[round] * CALIBRATION_M4_CYCLES / calibration;
+	}
+	qsort(cycles, MEASURE_ROUNDS, sizeof(double), compareDouble);
+	qsort(ns, MEASURE_ROUNDS, sizeof(double), compareDouble);
+	*hostNs = ns[MEASURE_ROUNDS / 2];
+	return cycles[MEASURE_ROUNDS / 2];
+}
+
+/**
+ * @brief Read "name;cycles" lines of a baseline
+ */
+static std::vector<result_t> readBaseline(const char *fileName)
+{
+	std::vector<result_t> baseline;
+	FILE *file = fopen(fileName, "r");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Cannot open %s\n", fileName);
+		exit(1);
+	}
+	char line[128];
+	while (fgets(line, sizeof(line), file))
+	{
+		char name[64];
+		double cycles;
+		if (sscanf(line, "%63[^;];%lf", name, &cycles) == 2)
+		{
+			result_t result = {strdup(name), 0.0, cycles};
+			baseline.push_back(result);
+		}
+	}
+	fclose(file);
+	return baseline;
+}
+
+int main(int argc, char **argv)
+{
+	const char *saveName = NULL;
+	const char *compareName = NULL;
+	double tolerance = 60.0;
+	int strict = 0;
+	for (int arg = 1; arg < argc; arg++)
+	{
+		if (strncmp(argv[arg], "save=", 5) == 0)
+		{
+			saveName = argv[arg] + 5;
+		}
+		else if (strncmp(argv[arg], "compare=", 8) == 0)
+		{
+			compareName = argv[arg] + 8;
+		}
+		else if (sscanf(argv[arg], "tolerance=%lf", &tolerance) == 1)
+		{
+			continue;
+		}
+		else if (sscanf(argv[arg], "strict=%d", &strict) == 1)
+		{
+			continue;
+		}
+		else
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[arg]);
+			return 1;
+		}
+	}
+
+	double calibration = measure(benchCalibration);
+	printf("Calibration %.3fns per loop = %.0f M4 cycles\n\n", calibration, CALIBRATION_M4_CYCLES);
+	printf("Benchmark              host ns   M4 cycles   M4 us");
+	if (compareName != NULL)
+	{
+		printf("   baseline   change");
+	}
+	printf("\n");
+
+	std::vector<result_t> baseline;
+	if (compareName != NULL)
+	{
+		baseline = readBaseline(compareName);
+	}
+
+	std::vector<result_t> results;
+	int regressions = 0;
+	for (size_t idx = 0; idx < BENCH_NUM; idx++)
+	{
+		result_t result = {benches[idx].name, 0.0, 0.0};
+		result.cycles = measureCycles(benches[idx].func, &result.hostNs);
+		const result_t *base = NULL;
+		for (size_t entry = 0; entry < baseline.size(); entry++)
+		{
+			if (strcmp(baseline[entry].name, result.name) == 0)
+			{
+				base = &baseline[entry];
+			}
+		}
+		double limit = 0.0;
+		if (base != NULL)
+		{
+			limit = base->cycles * (1.0 + tolerance / 100.0);
+			limit = limit > base->cycles + NOISE_CYCLES ? limit : base->cycles + NOISE_CYCLES;
+			// Measure again before calling it a regression, the lowest estimate counts
+			for (int run = 1; (run < CONFIRM_RUNS) && (result.cycles > limit); run++)
+			{
+				double hostNs;
+				double cycles = measureCycles(benches[idx].func, &hostNs);
+				if (cycles < result.cycles)
+				{
+					result.cycles = cycles;
+					result.hostNs = hostNs;
+				}
+			}
+		}
+		results.push_back(result);
+		printf("%-20s %9.1f %11.0f %7.2f", result.name, result.hostNs, result.cycles, result.cycles / M4_MHZ);
+		if (base != NULL)
+		{
+			double change = 100.0 * (result.cycles - base->cycles) / base->cycles;
+			printf(" %10.0f %+7.1f%%", base->cycles, change);
+			if (result.cycles > limit)
+			{
+				printf("  REGRESSION");
+				regressions++;
+			}
+		}
+		printf("\n");
+	}
+
+	if (saveName != NULL)
+	{
+		FILE *file = fopen(saveName, "w");
+		if (file == NULL)
+		{
+			fprintf(stderr, "Cannot write %s\n", saveName);
+			return 1;
+		}
+		fprintf(file, "# name;estimated Cortex-M4 cycles\n");
+		for (size_t idx = 0; idx < results.size(); idx++)
+		{
+			fprintf(file, "%s;%.0f\n", results[idx].name, results[idx].cycles);
+		}
+		fclose(file);
+	}
+	if (compareName != NULL)
+	{
+		printf("\n%d regressions above %.0f%%\n", regressions, tolerance);
+	}
+	return (strict && regressions) ? 1 : 0;
+}
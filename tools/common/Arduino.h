@@ -0,0 +1,19 @@
+/**
+ * @file Arduino.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Stand-in for the Arduino core header, lets the host tools build firmware libraries that include it
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef ARDUINO_HOST_H
+#define ARDUINO_HOST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#endif
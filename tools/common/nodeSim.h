@@ -0,0 +1,192 @@
+/**
+ * @file nodeSim.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host side model of one wake cycle of the LoRa-DeepSleep node
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef NODE_SIM_H
+#define NODE_SIM_H
+
+#include <math.h>
+#include <stdint.h>
+
+#include "energyModel.h"
+#include "nodePayload.h"
+
+/** Radio and timing settings of a node, same meaning as the defines in lora.cpp and main.h */
+typedef struct
+{
+	/** RF_FREQUENCY in Hz */
+	uint32_t frequency;
+	/** TX_OUTPUT_POWER in dBm */
+	int8_t txPower;
+	/** LORA_BANDWIDTH 0: 125 kHz, 1: 250 kHz, 2: 500 kHz */
+	uint8_t bandwidth;
+	/** LORA_SPREADING_FACTOR 7..12 */
+	uint8_t spreadingFactor;
+	/** LORA_CODINGRATE 1: 4/5, 2: 4/6, 3: 4/7, 4: 4/8 */
+	uint8_t codingRate;
+	/** LORA_PREAMBLE_LENGTH in symbols */
+	uint16_t preambleLength;
+	/** Size of the data package in bytes */
+	uint8_t payloadSize;
+	/** SLEEP_TIME in ms */
+	uint32_t sleepTime;
+	/** TX_ONLY mode */
+	bool txOnly;
+	/** RX duty cycle listen time in ms */
+	uint32_t rxTime;
+	/** RX duty cycle sleep time in ms */
+	uint32_t rxSleepTime;
+	/** Number of CAD symbols */
+	uint8_t cadSymbols;
+	/** Time the MCU is awake per wakeup in ms */
+	uint32_t awakeTime;
+} node_config_t;
+
+/** duty_cycle_rx_time and duty_cycle_sleep_time from lora.cpp, in steps of 15.625us */
+#define NODE_DUTY_CYCLE_RX (2 * 1000 * 64)
+#define NODE_DUTY_CYCLE_SLEEP (10 * 1000 * 64)
+
+/**
+ * @brief Convert a RX duty cycle time as it is passed to Radio.SetRxDutyCycle
+ * into ms. The SX126x takes 24 bit values in steps of 15.625us, higher bits are lost.
+ *
+ * @param value time in steps of 15.625us
+ * @return uint32_t time in ms
+ */
+static inline uint32_t nodeDutyCycleTime(uint32_t value)
+{
+	return (uint32_t)((uint64_t)(value & 0xFFFFFF) * 15625 / 1000000);
+}
+
+/**
+ * @brief RX duty cycle sleep time for a sleep factor, limited to 24 bits like rxSleepTime() in lora.cpp
+ *
+ * @param factor multiplier of the battery policy or the harvesting controller
+ * @return uint32_t time in ms
+ */
+static inline uint32_t nodeRxSleepTime(uint8_t factor)
+{
+	uint64_t value = (uint64_t)NODE_DUTY_CYCLE_SLEEP * factor;
+	return nodeDutyCycleTime(value > 0xFFFFFF ? 0xFFFFFF : (uint32_t)value);
+}
+
+/**
+ * @brief Settings as they are in lora.cpp and main.h
+ *
+ * @return node_config_t default settings
+ */
+static inline node_config_t nodeDefaultConfig(void)
+{
+	node_config_t config;
+	config.frequency = 923300000;
+	config.txPower = 22;
+	config.bandwidth = 0;
+	config.spreadingFactor = 7;
+	config.codingRate = 1;
+	config.preambleLength = 8;
+	config.payloadSize = PAYLOAD_SIZE;
+	config.sleepTime = 10 * 1000;
+	config.txOnly = false;
+	config.rxTime = nodeDutyCycleTime(NODE_DUTY_CYCLE_RX);
+	config.rxSleepTime = nodeRxSleepTime(1);
+	config.cadSymbols = 8;
+	config.awakeTime = 10;
+	return config;
+}
+
+/**
+ * @brief Bandwidth in Hz for a LORA_BANDWIDTH value
+ */
+static inline uint32_t nodeBandwidthHz(uint8_t bandwidth)
+{
+	static const uint32_t bw[] = {125000, 250000, 500000};
+	return bw[bandwidth < 3 ? bandwidth : 0];
+}
+
+/**
+ * @brief Symbol time in us
+ */
+static inline double nodeSymbolTime(const node_config_t *config)
+{
+	return (double)(1UL << config->spreadingFactor) * 1e6 / nodeBandwidthHz(config->bandwidth);
+}
+
+/**
+ * @brief LoRa time on air with explicit header and CRC, see SX1262 datasheet 6.1.4
+ *
+ * @param config node settings
+ * @param payloadSize package size in bytes
+ * @return uint32_t time on air in us
+ */
+static inline uint32_t nodeTimeOnAir(const node_config_t *config, uint8_t payloadSize)
+{
+	double tSym = nodeSymbolTime(config);
+	int sf = config->spreadingFactor;
+	int lowDataRate = (tSym > 16000.0) ? 1 : 0;
+	double num = 8.0 * payloadSize - 4.0 * sf + 28 + 16;
+	double den = 4.0 * (sf - 2 * lowDataRate);
+	double payloadSymbols = 8 + fmax(ceil(num / den) * (config->codingRate + 4), 0.0);
+	double preamble = (config->preambleLength + 4.25) * tSym;
+	return (uint32_t)(preamble + payloadSymbols * tSym);
+}
+
+/**
+ * @brief Time the channel activity detection takes in us
+ */
+static inline uint32_t nodeCadTime(const node_config_t *config)
+{
+	// CAD symbols plus about one symbol for processing
+	return (uint32_t)((config->cadSymbols + 1) * nodeSymbolTime(config));
+}
+
+/**
+ * @brief Time the radio listens in RX duty cycle mode after an uplink. The duty cycle starts
+ * again at the end of each uplink with a listen window, so a listen time longer than the
+ * send interval keeps the radio in RX the whole time.
+ *
+ * @param config node settings
+ * @param sleep time until the next wakeup in ms
+ * @return uint32_t listen time in ms
+ */
+static inline uint32_t nodeListenTime(const node_config_t *config, uint32_t sleep)
+{
+	uint32_t period = config->rxTime + config->rxSleepTime;
+	if (config->txOnly || (period == 0))
+	{
+		return 0;
+	}
+	uint32_t rest = sleep % period;
+	return (sleep / period) * config->rxTime + (rest < config->rxTime ? rest : config->rxTime);
+}
+
+/**
+ * @brief Account one wake cycle in the energy model:
+ * MCU awake, CAD, TX and sleep with or without RX duty cycle for the rest of the period
+ *
+ * @param config node settings
+ * @param model energy model to update
+ * @param period length of the cycle in ms
+ */
+static inline void nodeSimCycle(const node_config_t *config, energy_model_t *model, uint32_t period)
+{
+	uint32_t cad = (nodeCadTime(config) + 500) / 1000;
+	uint32_t tx = (nodeTimeOnAir(config, config->payloadSize) + 500) / 1000;
+	uint32_t awake = config->awakeTime + cad + tx;
+	uint32_t sleep = period > awake ? period - awake : 0;
+
+	energySetCurrent(model, ENERGY_RADIO_TX, energyTxCurrent(config->txPower));
+	energyAccount(model, ENERGY_MCU, config->awakeTime);
+	energyAccount(model, ENERGY_RADIO_CAD, cad);
+	energyAccount(model, ENERGY_RADIO_TX, tx);
+	// While the radio works the MCU sleeps
+	energyAccount(model, ENERGY_SLEEP, sleep + cad + tx);
+	energyAccount(model, ENERGY_RADIO_RX, nodeListenTime(config, sleep));
+}
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file spscQueue.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Lock-free single producer, single consumer queue for the host tools
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Bounded ring, one thread pushes, one thread pops. Head and tail sit in their
+ * own cache lines, each side caches the index of the other side and only reloads
+ * it when the queue looks full or empty.
+ * SIZE must be a power of 2.
+ */
+template <typename T, size_t SIZE>
+class SpscQueue
+{
+public:
+	SpscQueue() : head(0), tailCache(0), tail(0), headCache(0) {}
+
+	/**
+	 * @brief Producer side, copy an item into the queue
+	 *
+	 * @return false if the queue is full
+	 */
+	bool push(const T &item)
+	{
+		size_t next = head.load(std::memory_order_relaxed);
+		if (next - tailCache >= SIZE)
+		{
+			tailCache = tail.load(std::memory_order_acquire);
+			if (next - tailCache >= SIZE)
+			{
+				return false;
+			}
+		}
+		slot[next & (SIZE - 1)] = item;
+		head.store(next + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief Consumer side, oldest item without removing it
+	 *
+	 * @return T* the item, NULL if the queue is empty
+	 */
+	T *front(void)
+	{
+		size_t next = tail.load(std::memory_order_relaxed);
+		if (next == headCache)
+		{
+			headCache = head.load(std::memory_order_acquire);
+			if (next == headCache)
+			{
+				return NULL;
+			}
+		}
+		return &slot[next & (SIZE - 1)];
+	}
+
+	/**
+	 * @brief Consumer side, remove the item returned by front()
+	 */
+	void pop(void)
+	{
+		tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+private:
+	alignas(64) std::atomic<size_t> head;
+	/** Producer copy of tail */
+	size_t tailCache;
+	alignas(64) std::atomic<size_t> tail;
+	/** Consumer copy of head */
+	size_t headCache;
+	alignas(64) T slot[SIZE];
+};
+
+#endif
@@ -0,0 +1,107 @@
+/**
+ * @file traceLog.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Read the wake cycle trace from a captured log and rebuild its time line
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef TRACE_LOG_H
+#define TRACE_LOG_H
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "wakeTrace.h"
+
+/** A record with its reconstructed time */
+typedef struct
+{
+	trace_record_t record;
+	/** Time since the first record in us */
+	double time;
+} timed_record_t;
+
+/**
+ * @brief Extract the records from the "#TRACE <hex>" lines of a log
+ */
+static inline std::vector<trace_record_t> traceReadLog(FILE *file)
+{
+	std::vector<trace_record_t> records;
+	char line[512];
+	while (fgets(line, sizeof(line), file))
+	{
+		char *hex = strstr(line, "#TRACE ");
+		if (hex == NULL)
+		{
+			continue;
+		}
+		hex += 7;
+		trace_record_t record;
+		uint8_t *bytes = (uint8_t *)&record;
+		bool valid = true;
+		for (size_t idx = 0; idx < sizeof(trace_record_t); idx++)
+		{
+			unsigned value;
+			if (sscanf(hex + idx * 2, "%2x", &value) != 1)
+			{
+				valid = false;
+				break;
+			}
+			bytes[idx] = (uint8_t)value;
+		}
+		if (valid)
+		{
+			records.push_back(record);
+		}
+	}
+	return records;
+}
+
+/**
+ * @brief Combine RTC ticks and cycle counter into one time line.
+ * The cycle counter stops while the CPU sleeps, so it is only used for the
+ * fine resolution between records of one awake phase. If it disagrees with the
+ * RTC by more than two ticks the CPU slept and the RTC time is used as new anchor.
+ */
+static inline std::vector<timed_record_t> traceReconstructTime(const std::vector<trace_record_t> &records)
+{
+	std::vector<timed_record_t> timed;
+	const double tickUs = 1e6 / TRACE_TICK_HZ;
+	const double cycleUs = 1e6 / TRACE_CPU_HZ;
+	double anchorTime = 0.0;
+	uint32_t anchorCycles = 0;
+	uint32_t firstTicks = 0;
+	double last = 0.0;
+
+	for (size_t idx = 0; idx < records.size(); idx++)
+	{
+		const trace_record_t &record = records[idx];
+		if (idx == 0)
+		{
+			firstTicks = record.ticks;
+			anchorCycles = record.cycles;
+		}
+		double rtcTime = (double)(uint32_t)(record.ticks - firstTicks) * tickUs;
+		double time = anchorTime + (double)(uint32_t)(record.cycles - anchorCycles) * cycleUs;
+		if ((time - rtcTime > 2 * tickUs) || (rtcTime - time > 2 * tickUs))
+		{
+			anchorTime = rtcTime;
+			anchorCycles = record.cycles;
+			time = rtcTime;
+		}
+		if (time < last)
+		{
+			time = last;
+		}
+		last = time;
+		timed_record_t entry = {record, time};
+		timed.push_back(entry);
+	}
+	return timed;
+}
+
+#endif
@@ -0,0 +1,597 @@
+/**
+ * @file tsStore.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Append-only columnar time-series store for the node packages, queried through mmap
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Every node has its own file dev<ID>.ts in the store directory. The file starts with
+ * a ts_file_header_t and then has blocks of up to TS_BLOCK_SAMPLES samples. A block is a
+ * ts_block_header_t with count, size and min / max / sum of each column, followed by the
+ * compressed columns. The time column is stored as delta of delta, the other columns as
+ * delta, each value as zigzag varint with runs of zeros. A regular send interval costs about
+ * one byte per sample for the time, slowly changing sensor values one byte per value and
+ * constant values almost nothing.
+ *
+ * Writers append whole blocks. A block is written when it is full or when its first sample is
+ * older than TS_FLUSH_MS (tsWriterFlushOld(), a slow node would otherwise keep its samples in
+ * memory for hours), and the caller flushes all writers before it exits. A crash can only lose
+ * the samples that were not written yet and a partly written block at the end. The reader
+ * ignores that block, a writer opening the file cuts it off before it appends. Readers map the file and
+ * decode the columns straight from the mapping. Blocks outside the time range are skipped
+ * by their header, aggregates of blocks that are completely inside come from the header.
+ * The headers are in host byte order, the files are not meant to move between hosts.
+ */
+#ifndef TS_STORE_H
+#define TS_STORE_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+// Columns of a sample
+#define TS_TIME 0
+/** Temperature in 1/100 degree */
+#define TS_TEMPERATURE 1
+/** Humidity in 1/100 % */
+#define TS_HUMIDITY 2
+#define TS_LIGHT 3
+#define TS_THRESHOLD 4
+/** RSSI the node measured on its last reception */
+#define TS_NODE_RSSI 5
+#define TS_BATTERY 6
+/** Sample age in ms */
+#define TS_AGE 7
+/** RSSI and SNR of the package at the receiver */
+#define TS_RSSI 8
+#define TS_SNR 9
+#define TS_COLUMNS 10
+
+/** Samples per block */
+#define TS_BLOCK_SAMPLES 1024
+/** Longest time a sample waits in memory for its block to be written, in ms.
+ * 10 minutes are 60 samples at a 10s send interval, the block header costs ~5 bytes per sample then. */
+#define TS_FLUSH_MS 600000
+/** A zigzag varint of a 64 bit value has up to 10 bytes */
+#define TS_VARINT_MAX 10
+/** Flag in ts_block_header_t.columnSize */
+#define TS_RUNS 0x80000000
+
+#define TS_FILE_MAGIC 0x31535354 // "TSS1"
+#define TS_BLOCK_MAGIC 0x314B4C42 // "BLK1"
+
+
+/** One sample, time in ms */
+typedef struct
+{
+	int64_t value[TS_COLUMNS];
+} ts_sample_t;
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t columns;
+	uint32_t device;
+	uint32_t reserved;
+} ts_file_header_t;
+
+typedef struct
+{
+	uint32_t magic;
+	/** Size of the block including this header */
+	uint32_t size;
+	uint32_t count;
+	/** Bytes of each compressed column, the columns follow in order. TS_RUNS is set if the column has runs of zeros */
+	uint32_t columnSize[TS_COLUMNS];
+	int64_t min[TS_COLUMNS];
+	int64_t max[TS_COLUMNS];
+	int64_t sum[TS_COLUMNS];
+} ts_block_header_t;
+
+/** Writer of one node file, collects a block in memory */
+typedef struct
+{
+	FILE *file;
+	ts_sample_t sample[TS_BLOCK_SAMPLES];
+	uint32_t count;
+	/** tsClockMs() when the first sample of the block was added */
+	int64_t pendingSince;
+	uint64_t samples;
+	uint64_t bytes;
+} ts_writer_t;
+
+/** Reader of one node file */
+typedef struct
+{
+	const uint8_t *map;
+	size_t size;
+	/** Offsets of the complete blocks */
+	std::vector<size_t> block;
+} ts_reader_t;
+
+/** Result of an aggregate query */
+typedef struct
+{
+	uint64_t count;
+	int64_t min;
+	int64_t max;
+	int64_t sum;
+	/** Blocks answered from the header, blocks that had to be decoded */
+	uint32_t headerBlocks;
+	uint32_t decodedBlocks;
+} ts_aggregate_t;
+
+/**
+ * @brief Name of a column
+ */
+static inline const char *tsColumnName(uint8_t column)
+{
+	static const char *name[TS_COLUMNS] = {
+		"time", "temperature", "humidity", "light", "threshold", "node_rssi", "battery", "age", "rssi", "snr"};
+	return column < TS_COLUMNS ? name[column] : "?";
+}
+
+/**
+ * @brief File name of a node in the store directory
+ */
+static inline void tsDevicePath(const char *dir, uint8_t device, char *path, size_t size)
+{
+	snprintf(path, size, "%s/dev%u.ts", dir, device);
+}
+
+static inline uint8_t *tsPutVarint(uint8_t *out, int64_t value)
+{
+	uint64_t zigzag = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+	while (zigzag >= 0x80)
+	{
+		*out++ = (uint8_t)(zigzag | 0x80);
+		zigzag >>= 7;
+	}
+	*out++ = (uint8_t)zigzag;
+	return out;
+}
+
+static inline const uint8_t *tsGetVarint(const uint8_t *in, const uint8_t *end, int64_t *value)
+{
+	uint64_t zigzag = 0;
+	for (int shift = 0; (in < end) && (shift < 64); shift += 7)
+	{
+		uint8_t byte = *in++;
+		zigzag |= (uint64_t)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+		{
+			break;
+		}
+	}
+	*value = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+	return in;
+}
+
+/**
+ * @brief Number of zero codes of a column, unchanged values or unchanged intervals
+ */
+static inline uint32_t tsZeroCodes(const ts_sample_t *sample, uint32_t count, uint8_t column)
+{
+	uint32_t zeros = 0;
+	for (uint32_t idx = 1; idx < count; idx++)
+	{
+		int64_t delta = sample[idx].value[column] - sample[idx - 1].value[column];
+		int64_t code = (column == TS_TIME) && (idx > 1) ? delta - (sample[idx - 1].value[column] - sample[idx - 2].value[column]) : delta;
+		zeros += code == 0 ? 1 : 0;
+	}
+	return zeros;
+}
+
+/**
+ * @brief Compress one column of a block.
+ * With runs a zero code is followed by the number of further zero codes, so a constant
+ * value or a constant interval costs two bytes per block instead of one byte per sample.
+ *
+ * @param runs encode runs of zero codes
+ * @return size_t bytes written to out
+ */
+static inline size_t tsEncodeColumn(const ts_sample_t *sample, uint32_t count, uint8_t column, bool runs, uint8_t *out)
+{
+	uint8_t *pos = out;
+	int64_t last = 0;
+	int64_t lastDelta = 0;
+	uint32_t zeros = 0;
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		int64_t value = sample[idx].value[column];
+		int64_t delta = value - last;
+		int64_t code = column == TS_TIME ? delta - lastDelta : delta;
+		last = value;
+		lastDelta = delta;
+		if (runs && (code == 0))
+		{
+			zeros++;
+			continue;
+		}
+		if (zeros != 0)
+		{
+			pos = tsPutVarint(tsPutVarint(pos, 0), zeros - 1);
+			zeros = 0;
+		}
+		pos = tsPutVarint(pos, code);
+	}
+	if (zeros != 0)
+	{
+		pos = tsPutVarint(tsPutVarint(pos, 0), zeros - 1);
+	}
+	return pos - out;
+}
+
+/**
+ * @brief Decompress one column of a block
+ *
+ * @param in compressed column in the mapping
+ * @param size bytes of the compressed column
+ * @param count number of samples
+ * @param column TS_xxx
+ * @param runs the column has runs of zero codes
+ * @param value output, count values
+ */
+static inline void tsDecodeColumn(const uint8_t *in, uint32_t size, uint32_t count, uint8_t column, bool runs, int64_t *value)
+{
+	const uint8_t *end = in + size;
+	int64_t last = 0;
+	int64_t lastDelta = 0;
+	int64_t zeros = 0;
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		int64_t code = 0;
+		if (zeros > 0)
+		{
+			zeros--;
+		}
+		else
+		{
+			in = tsGetVarint(in, end, &code);
+			if (runs && (code == 0))
+			{
+				in = tsGetVarint(in, end, &zeros);
+			}
+		}
+		int64_t delta = column == TS_TIME ? lastDelta + code : code;
+		last += delta;
+		lastDelta = delta;
+		value[idx] = last;
+	}
+}
+
+/**
+ * @brief Monotonic host time in ms for the flush time limit
+ */
+static inline int64_t tsClockMs(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Check the header of the block at offset, a block that does not fit into the file was not written completely
+ */
+static inline bool tsBlockValid(const ts_block_header_t *block, size_t offset, size_t fileSize)
+{
+	return (block->magic == TS_BLOCK_MAGIC) && (block->count <= TS_BLOCK_SAMPLES) && (block->size >= sizeof(ts_block_header_t)) &&
+		   (offset + block->size <= fileSize);
+}
+
+/**
+ * @brief Open the file of a node for appending, creates it if needed.
+ * A partly written block at the end is cut off, otherwise the blocks appended after it
+ * could not be found.
+ *
+ * @return true if the file is open, false if it can not be written or is not a store file
+ */
+static inline bool tsWriterOpen(ts_writer_t *writer, const char *dir, uint8_t device)
+{
+	char path[512];
+	tsDevicePath(dir, device, path, sizeof(path));
+	writer->file = NULL;
+	writer->count = 0;
+	writer->samples = 0;
+	writer->bytes = 0;
+	int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+	struct stat info;
+	if ((fd < 0) || (fstat(fd, &info) != 0))
+	{
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		return false;
+	}
+	size_t size = (size_t)info.st_size;
+	size_t valid = 0;
+	ts_file_header_t fileHeader;
+	if (size >= sizeof(fileHeader))
+	{
+		if ((pread(fd, &fileHeader, sizeof(fileHeader), 0) != (ssize_t)sizeof(fileHeader)) || (fileHeader.magic != TS_FILE_MAGIC) ||
+			(fileHeader.columns != TS_COLUMNS))
+		{
+			close(fd);
+			return false;
+		}
+		valid = sizeof(fileHeader);
+		ts_block_header_t block;
+		while ((valid + sizeof(block) <= size) && (pread(fd, &block, sizeof(block), valid) == (ssize_t)sizeof(block)) &&
+			   tsBlockValid(&block, valid, size))
+		{
+			valid += block.size;
+		}
+	}
+	// Without a complete file header the file is started again
+	if ((valid != size) && (ftruncate(fd, valid) != 0))
+	{
+		close(fd);
+		return false;
+	}
+	writer->file = fdopen(fd, "ab");
+	if (writer->file == NULL)
+	{
+		close(fd);
+		return false;
+	}
+	if (valid == 0)
+	{
+		ts_file_header_t header = {TS_FILE_MAGIC, TS_COLUMNS, device, 0};
+		fwrite(&header, sizeof(header), 1, writer->file);
+		writer->bytes += sizeof(header);
+	}
+	return true;
+}
+
+/**
+ * @brief Compress the collected samples and append them as block
+ */
+static inline void tsWriterFlush(ts_writer_t *writer)
+{
+	if (writer->count == 0)
+	{
+		return;
+	}
+	static thread_local uint8_t data[TS_COLUMNS * TS_BLOCK_SAMPLES * TS_VARINT_MAX];
+	ts_block_header_t header;
+	header.magic = TS_BLOCK_MAGIC;
+	header.count = writer->count;
+	size_t size = 0;
+	for (uint8_t column = 0; column < TS_COLUMNS; column++)
+	{
+		// Runs only pay off for columns that mostly do not change
+		bool runs = tsZeroCodes(writer->sample, writer->count, column) * 2 > writer->count;
+		header.columnSize[column] = (uint32_t)tsEncodeColumn(writer->sample, writer->count, column, runs, &data[size]);
+		size += header.columnSize[column];
+		header.columnSize[column] |= runs ? TS_RUNS : 0;
+		header.min[column] = writer->sample[0].value[column];
+		header.max[column] = writer->sample[0].value[column];
+		header.sum[column] = 0;
+		for (uint32_t idx = 0; idx < writer->count; idx++)
+		{
+			int64_t value = writer->sample[idx].value[column];
+			header.min[column] = value < header.min[column] ? value : header.min[column];
+			header.max[column] = value > header.max[column] ? value : header.max[column];
+			header.sum[column] += value;
+		}
+	}
+	header.size = (uint32_t)(sizeof(header) + size);
+	fwrite(&header, sizeof(header), 1, writer->file);
+	fwrite(data, 1, size, writer->file);
+	// The block goes to the file at once, not with the next one through the stdio buffer
+	fflush(writer->file);
+	writer->bytes += header.size;
+	writer->count = 0;
+}
+
+/**
+ * @brief Add a sample, a full block is written to the file
+ */
+static inline void tsWriterAppend(ts_writer_t *writer, const ts_sample_t *sample)
+{
+	if (writer->count == 0)
+	{
+		writer->pendingSince = tsClockMs();
+	}
+	writer->sample[writer->count++] = *sample;
+	writer->samples++;
+	if (writer->count == TS_BLOCK_SAMPLES)
+	{
+		tsWriterFlush(writer);
+	}
+}
+
+/**
+ * @brief Write the collected samples if the first of them waits longer than TS_FLUSH_MS,
+ * call it regularly also when the node sends nothing
+ *
+ * @param writer the writer
+ * @param now tsClockMs()
+ */
+static inline void tsWriterFlushOld(ts_writer_t *writer, int64_t now)
+{
+	if ((writer->count != 0) && (now - writer->pendingSince >= TS_FLUSH_MS))
+	{
+		tsWriterFlush(writer);
+	}
+}
+
+/**
+ * @brief Write the last block and close the file
+ */
+static inline void tsWriterClose(ts_writer_t *writer)
+{
+	if (writer->file == NULL)
+	{
+		return;
+	}
+	tsWriterFlush(writer);
+	fclose(writer->file);
+	writer->file = NULL;
+}
+
+/**
+ * @brief Map the file of a node and index its blocks
+ *
+ * @return true if the file exists and has a valid header
+ */
+static inline bool tsReaderOpen(ts_reader_t *reader, const char *dir, uint8_t device)
+{
+	char path[512];
+	tsDevicePath(dir, device, path, sizeof(path));
+	reader->map = NULL;
+	reader->size = 0;
+	reader->block.clear();
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+	struct stat info;
+	if ((fstat(fd, &info) != 0) || ((size_t)info.st_size < sizeof(ts_file_header_t)))
+	{
+		close(fd);
+		return false;
+	}
+	void *map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		return false;
+	}
+	reader->map = (const uint8_t *)map;
+	reader->size = info.st_size;
+	const ts_file_header_t *header = (const ts_file_header_t *)reader->map;
+	if ((header->magic != TS_FILE_MAGIC) || (header->columns != TS_COLUMNS))
+	{
+		munmap(map, reader->size);
+		reader->map = NULL;
+		return false;
+	}
+	// The headers chain the blocks, a partly written block at the end is left out
+	size_t offset = sizeof(ts_file_header_t);
+	while (offset + sizeof(ts_block_header_t) <= reader->size)
+	{
+		const ts_block_header_t *block = (const ts_block_header_t *)(reader->map + offset);
+		if (!tsBlockValid(block, offset, reader->size))
+		{
+			break;
+		}
+		reader->block.push_back(offset);
+		offset += block->size;
+	}
+	return true;
+}
+
+static inline void tsReaderClose(ts_reader_t *reader)
+{
+	if (reader->map != NULL)
+	{
+		munmap((void *)reader->map, reader->size);
+		reader->map = NULL;
+	}
+	reader->block.clear();
+}
+
+/**
+ * @brief Decode a column of a block
+ */
+static inline void tsReadColumn(const ts_reader_t *reader, size_t block, uint8_t column, int64_t *value)
+{
+	const ts_block_header_t *header = (const ts_block_header_t *)(reader->map + reader->block[block]);
+	const uint8_t *data = (const uint8_t *)(header + 1);
+	for (uint8_t idx = 0; idx < column; idx++)
+	{
+		data += header->columnSize[idx] & ~TS_RUNS;
+	}
+	uint32_t size = header->columnSize[column];
+	tsDecodeColumn(data, size & ~TS_RUNS, header->count, column, (size & TS_RUNS) != 0, value);
+}
+
+/**
+ * @brief Call found(time, value) for every sample with from <= time < to
+ *
+ * @return uint64_t number of samples in the range
+ */
+template <typename F>
+static inline uint64_t tsScan(const ts_reader_t *reader, int64_t from, int64_t to, uint8_t column, F found)
+{
+	int64_t time[TS_BLOCK_SAMPLES];
+	int64_t value[TS_BLOCK_SAMPLES];
+	uint64_t count = 0;
+	for (size_t block = 0; block < reader->block.size(); block++)
+	{
+		const ts_block_header_t *header = (const ts_block_header_t *)(reader->map + reader->block[block]);
+		if ((header->max[TS_TIME] < from) || (header->min[TS_TIME] >= to))
+		{
+			continue;
+		}
+		tsReadColumn(reader, block, TS_TIME, time);
+		if (column != TS_TIME)
+		{
+			tsReadColumn(reader, block, column, value);
+		}
+		for (uint32_t idx = 0; idx < header->count; idx++)
+		{
+			if ((time[idx] >= from) && (time[idx] < to))
+			{
+				found(time[idx], column != TS_TIME ? value[idx] : time[idx]);
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+/**
+ * @brief Count, min, max and sum of a column for from <= time < to.
+ * Blocks completely inside the range are answered from their header.
+ */
+static inline ts_aggregate_t tsAggregate(const ts_reader_t *reader, int64_t from, int64_t to, uint8_t column)
+{
+	ts_aggregate_t result = {0, INT64_MAX, INT64_MIN, 0, 0, 0};
+	int64_t time[TS_BLOCK_SAMPLES];
+	int64_t value[TS_BLOCK_SAMPLES];
+	for (size_t block = 0; block < reader->block.size(); block++)
+	{
+		const ts_block_header_t *header = (const ts_block_header_t *)(reader->map + reader->block[block]);
+		if ((header->max[TS_TIME] < from) || (header->min[TS_TIME] >= to))
+		{
+			continue;
+		}
+		if ((header->min[TS_TIME] >= from) && (header->max[TS_TIME] < to))
+		{
+			result.count += header->count;
+			result.min = header->min[column] < result.min ? header->min[column] : result.min;
+			result.max = header->max[column] > result.max ? header->max[column] : result.max;
+			result.sum += header->sum[column];
+			result.headerBlocks++;
+			continue;
+		}
+		tsReadColumn(reader, block, TS_TIME, time);
+		tsReadColumn(reader, block, column, value);
+		for (uint32_t idx = 0; idx < header->count; idx++)
+		{
+			if ((time[idx] >= from) && (time[idx] < to))
+			{
+				result.count++;
+				result.min = value[idx] < result.min ? value[idx] : result.min;
+				result.max = value[idx] > result.max ? value[idx] : result.max;
+				result.sum += value[idx];
+			}
+		}
+		result.decodedBlocks++;
+	}
+	return result;
+}
+
+#endif
@@ -0,0 +1,531 @@
+/**
+ * @file downlink.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Send downlink commands through a receiver and simulate the downlink queue against blind sends
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build:
+ *   g++ -O2 -o downlink downlink.cpp ../../PlatformIO/LoRa-DeepSleep/lib/downlinkQueue/downlinkQueue.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/lib/nodePayload/nodePayload.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/lib/rxStream/rxStream.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/lib/energyModel/energyModel.cpp
+ *       -I../common -I../../PlatformIO/LoRa-DeepSleep/lib/downlinkQueue -I../../PlatformIO/LoRa-DeepSleep/lib/nodePayload
+ *       -I../../PlatformIO/LoRa-DeepSleep/lib/rxStream -I../../PlatformIO/LoRa-DeepSleep/lib/rxRing
+ *       -I../../PlatformIO/LoRa-DeepSleep/lib/energyModel
+ *
+ * Usage:
+ *   downlink /dev/ttyACM0 node=7 command=0102A0   queue a command for node 7 in the receiver, the receiver
+ *                                                 sends it with the other commands of the node in its next
+ *                                                 listen window (port in raw mode: stty -F /dev/ttyACM0 raw)
+ *   downlink simulate                             downlink queue against blind sends with retries
+ *     nodes=20                                    number of nodes
+ *     every=60 (s)                                mean time between two commands for a node
+ *     time=3600 (s)                               simulated time
+ *     rx=... sleep=... (ms)                       RX duty cycle of the nodes, default from lora.cpp
+ *     drift=50000 (ppb)                           largest clock drift of a node against the receiver
+ *     slow=25 (%)                                 nodes the battery or harvest policy moved to sleep factor 2 or 4
+ *     unknown=0                                   1: the nodes do not send their sleep factor (older firmware)
+ *     wait=11000 (ms)                             DOWNLINK_MAX_WAIT
+ *     retry=1000 (ms)                             time between two blind sends of the same command
+ *     seed=1                                      random seed
+ *
+ * The nodes send an uplink every SLEEP_TIME, moved by up to SEND_TOLERANCE, and listen in the RX duty cycle
+ * that starts at the end of each uplink and each received downlink. Like in the harvesting ladder a node with
+ * sleep factor 2 or 4 also sends 2 or 4 times less often, it sends its sleep factor with every uplink. A downlink is received if its preamble
+ * covers DOWNLINK_DETECT_SYMBOLS of a listen window. Collisions and the half duplex receiver are not simulated.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "downlinkQueue.h"
+#include "nodeSim.h"
+#include "rxStream.h"
+
+/** Settings of main.h */
+#define SLEEP_TIME (10 * 1000)
+#define SEND_TOLERANCE (SLEEP_TIME / 10)
+#define DOWNLINK_DETECT_SYMBOLS 4
+#define DOWNLINK_OPEN_DELAY 2
+#define CLOCK_MIN_GUARD 2
+#define DRIFT_DEFAULT_PPB 50000
+/** Size of a simulated command */
+#define COMMAND_SIZE 4
+/** Blind sends of a command before it is given up */
+#define BLIND_ATTEMPTS 20
+
+/** Simulated node, times in ms of the receiver clock */
+typedef struct
+{
+	/** Clock drift against the receiver in ppb */
+	double drift;
+	/** Start of the RX duty cycle, end of the last uplink or received downlink */
+	double anchor;
+	/** Delay from the end of a frame until the node listens */
+	double openDelay;
+	/** RX duty cycle sleep factor */
+	uint8_t factor;
+	/** End of the next uplink */
+	double nextUplink;
+	/** Next command from the host */
+	double nextCommand;
+	/** Time the commands in the queue were queued, for the latency */
+	std::vector<double> queued;
+} sim_node_t;
+
+/** Results of one strategy */
+typedef struct
+{
+	uint32_t commands;
+	uint32_t delivered;
+	uint32_t lost;
+	/** Transmissions and the ones that were received */
+	uint32_t sends;
+	uint32_t received;
+	/** Commands that arrived with the first transmission */
+	uint32_t firstAttempt;
+	double airtime;
+	double latency;
+	double preamble;
+} sim_result_t;
+
+static node_config_t radio;
+static downlink_window_t window;
+static double retryTime = 1000.0;
+/** Sleep factor in the uplinks: the one of the node or PAYLOAD_RX_UNKNOWN */
+static bool sendFactor = true;
+
+static double randomUniform(void)
+{
+	return (rand() + 0.5) / ((double)RAND_MAX + 1.0);
+}
+
+static double randomExponential(double mean)
+{
+	return -mean * log(randomUniform());
+}
+
+/**
+ * @brief Check if a node detects a preamble
+ *
+ * @param node the node
+ * @param start start of the transmission
+ * @param preamble preamble length in symbols
+ * @return true if a listen window sees DOWNLINK_DETECT_SYMBOLS of the preamble
+ */
+static bool nodeDetects(const sim_node_t *node, double start, uint16_t preamble)
+{
+	double scale = 1.0 + node->drift / 1e9;
+	double period = (window.rxTime + downlinkSleepTime(&window, node->factor)) * scale;
+	double rx = window.rxTime * scale;
+	double end = start + preamble * nodeSymbolTime(&radio) / 1000.0;
+	double detect = DOWNLINK_DETECT_SYMBOLS * nodeSymbolTime(&radio) / 1000.0;
+	double first = node->anchor + node->openDelay;
+	// Window open at or before the start of the preamble and the next one
+	double index = floor((start - first) / period);
+	index = index < 0 ? 0 : index;
+	for (int next = 0; next < 2; next++)
+	{
+		double open = first + (index + next) * period;
+		double from = start > open ? start : open;
+		double to = end < open + rx ? end : open + rx;
+		if (from + detect <= to)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Time on air of a downlink
+ *
+ * @return double time in ms
+ */
+static double airtime(uint8_t size, uint16_t preamble)
+{
+	node_config_t config = radio;
+	config.preambleLength = preamble;
+	return nodeTimeOnAir(&config, size) / 1000.0;
+}
+
+/**
+ * @brief Command arrival and uplink schedule of the nodes, the same for both strategies
+ */
+static std::vector<sim_node_t> simNodes(uint32_t count, double driftPpb, double slow, double every, uint32_t seed)
+{
+	srand(seed);
+	std::vector<sim_node_t> nodes(count);
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		sim_node_t &node = nodes[idx];
+		// The first nodes run with the sleep factors of the battery or harvest policy
+		node.factor = idx < count * slow / 2 ? 4 : idx < count * slow ? 2 : 1;
+		node.drift = (2.0 * randomUniform() - 1.0) * driftPpb;
+		// The nodes are in their RX duty cycle already
+		node.anchor = -randomUniform() * (window.rxTime + downlinkSleepTime(&window, node.factor));
+		node.openDelay = randomUniform() * DOWNLINK_OPEN_DELAY;
+		node.nextUplink = randomUniform() * SLEEP_TIME * node.factor;
+		node.nextCommand = randomExponential(every);
+	}
+	return nodes;
+}
+
+/**
+ * @brief Next uplink of a node
+ */
+static void nodeUplink(sim_node_t *node)
+{
+	node->anchor = node->nextUplink;
+	node->nextUplink += (SLEEP_TIME + randomUniform() * SEND_TOLERANCE) * node->factor * (1.0 + node->drift / 1e9);
+}
+
+/**
+ * @brief The receiver sends every command at once and repeats it every retryTime
+ * until the node got it, like a sender without knowledge of the listen windows
+ */
+static sim_result_t simBlind(std::vector<sim_node_t> nodes, double every, double duration, uint32_t seed)
+{
+	sim_result_t result = {};
+	srand(seed + 1);
+	// Pending command: node, next send time, attempts
+	struct pending_t
+	{
+		uint32_t node;
+		double queued;
+		double next;
+		uint32_t attempts;
+	};
+	std::vector<pending_t> pending;
+	double now = 0;
+	while (now < duration)
+	{
+		// Next event: uplink, new command or retry
+		double next = duration;
+		for (const sim_node_t &node : nodes)
+		{
+			next = node.nextUplink < next ? node.nextUplink : next;
+			next = node.nextCommand < next ? node.nextCommand : next;
+		}
+		for (const pending_t &item : pending)
+		{
+			next = item.next < next ? item.next : next;
+		}
+		now = next;
+		for (uint32_t idx = 0; idx < nodes.size(); idx++)
+		{
+			sim_node_t *node = &nodes[idx];
+			if (node->nextUplink <= now)
+			{
+				nodeUplink(node);
+			}
+			if (node->nextCommand <= now)
+			{
+				pending.push_back({idx, now, now, 0});
+				node->nextCommand += randomExponential(every);
+				result.commands++;
+			}
+		}
+		for (uint32_t idx = 0; idx < pending.size();)
+		{
+			pending_t *item = &pending[idx];
+			if (item->next > now)
+			{
+				idx++;
+				continue;
+			}
+			sim_node_t *node = &nodes[item->node];
+			double length = airtime(DOWNLINK_BATCH_HEADER + 1 + COMMAND_SIZE, radio.preambleLength);
+			result.sends++;
+			result.airtime += length;
+			result.preamble += radio.preambleLength;
+			item->attempts++;
+			if (nodeDetects(node, now, radio.preambleLength))
+			{
+				node->anchor = now + length;
+				result.received++;
+				result.delivered++;
+				result.firstAttempt += item->attempts == 1 ? 1 : 0;
+				result.latency += now - item->queued;
+				pending.erase(pending.begin() + idx);
+				continue;
+			}
+			if (item->attempts >= BLIND_ATTEMPTS)
+			{
+				result.lost++;
+				pending.erase(pending.begin() + idx);
+				continue;
+			}
+			item->next = now + retryTime;
+			idx++;
+		}
+	}
+	return result;
+}
+
+/**
+ * @brief The receiver queues the commands with the downlink queue of the firmware
+ * and sends one batch per node when downlinkPlan() says so
+ */
+static sim_result_t simQueue(std::vector<sim_node_t> nodes, double every, double duration, uint32_t seed)
+{
+	sim_result_t result = {};
+	srand(seed + 1);
+	downlink_queue_t queue;
+	downlinkInit(&queue, &window);
+	uint8_t command[COMMAND_SIZE] = {0x01, 0x02, 0x03, 0x04};
+	uint8_t batch[DOWNLINK_BATCH_MAX];
+	double now = 0;
+	while (now < duration)
+	{
+		double next = duration;
+		for (const sim_node_t &node : nodes)
+		{
+			next = node.nextUplink < next ? node.nextUplink : next;
+			next = node.nextCommand < next ? node.nextCommand : next;
+		}
+		downlink_plan_t plan;
+		if (downlinkPlan(&queue, (uint32_t)ceil(now), &plan) && (plan.time < next))
+		{
+			next = plan.time;
+		}
+		now = next > now ? next : now;
+		for (uint32_t idx = 0; idx < nodes.size(); idx++)
+		{
+			sim_node_t *node = &nodes[idx];
+			if (node->nextUplink <= now)
+			{
+				double end = node->nextUplink;
+				nodeUplink(node);
+				// The time requests are not simulated, only the commands
+				downlinkUplink(&queue, (uint8_t)idx, (uint32_t)end, false, sendFactor ? node->factor : PAYLOAD_RX_UNKNOWN);
+			}
+			if (node->nextCommand <= now)
+			{
+				if (downlinkAdd(&queue, (uint8_t)idx, command, COMMAND_SIZE))
+				{
+					node->queued.push_back(now);
+				}
+				else
+				{
+					result.lost++;
+				}
+				node->nextCommand += randomExponential(every);
+				result.commands++;
+			}
+		}
+		if (!downlinkPlan(&queue, (uint32_t)ceil(now), &plan) || (plan.time > (uint32_t)ceil(now)))
+		{
+			continue;
+		}
+		sim_node_t *node = &nodes[queue.node[plan.node].deviceId];
+		uint8_t size = downlinkBuild(&queue, &plan, batch);
+		double length = airtime(size, plan.preamble);
+		result.sends++;
+		result.airtime += length;
+		result.preamble += plan.preamble;
+		if (nodeDetects(node, plan.time, plan.preamble))
+		{
+			node->anchor = plan.time + length;
+			result.received++;
+			result.delivered += node->queued.size();
+			result.firstAttempt += node->queued.size();
+			for (double queued : node->queued)
+			{
+				result.latency += plan.time - queued;
+			}
+		}
+		else
+		{
+			result.lost += node->queued.size();
+		}
+		node->queued.clear();
+	}
+	return result;
+}
+
+static void printResult(const char *name, const sim_result_t *result)
+{
+	printf("%-8s %6lu commands %6lu delivered %5.1f%% first attempt %4lu lost, %6lu sends %5.1f%% received, "
+		   "%6.1fms airtime per command, preamble %6.1f symbols, latency %6.0fms\n",
+		   name, (unsigned long)result->commands, (unsigned long)result->delivered,
+		   result->commands ? 100.0 * result->firstAttempt / result->commands : 0.0, (unsigned long)result->lost,
+		   (unsigned long)result->sends, result->sends ? 100.0 * result->received / result->sends : 0.0,
+		   result->delivered ? result->airtime / result->delivered : 0.0,
+		   result->sends ? result->preamble / result->sends : 0.0,
+		   result->delivered ? result->latency / result->delivered : 0.0);
+}
+
+/**
+ * @brief Write one downlink command to the receiver
+ */
+static int sendCommand(int argc, char **argv)
+{
+	int node = -1;
+	uint8_t command[RX_FRAME_MAX];
+	int size = 0;
+	for (int arg = 2; arg < argc; arg++)
+	{
+		char key[32];
+		char value[2 * RX_FRAME_MAX + 1];
+		if (sscanf(argv[arg], "%31[^=]=%510s", key, value) != 2)
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[arg]);
+			return 1;
+		}
+		if (strcmp(key, "node") == 0)
+		{
+			node = atoi(value);
+		}
+		else if (strcmp(key, "command") == 0)
+		{
+			size = 0;
+			for (const char *hex = value; (hex[0] != 0) && (hex[1] != 0) && (size < RX_FRAME_MAX); hex += 2)
+			{
+				unsigned int byte;
+				if (sscanf(hex, "%2x", &byte) != 1)
+				{
+					fprintf(stderr, "Invalid command %s\n", value);
+					return 1;
+				}
+				command[size++] = (uint8_t)byte;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "Unknown key %s\n", key);
+			return 1;
+		}
+	}
+	if ((node < 0) || (node > 255) || (size == 0) || (size + 1 > DOWNLINK_COMMANDS_MAX))
+	{
+		fprintf(stderr, "Need node=0..255 and command=<hex>, at most %d bytes\n", DOWNLINK_COMMANDS_MAX - 1);
+		return 1;
+	}
+	FILE *output = strcmp(argv[1], "-") == 0 ? stdout : fopen(argv[1], "wb");
+	if (output == NULL)
+	{
+		fprintf(stderr, "Cannot open %s\n", argv[1]);
+		return 1;
+	}
+	uint8_t message[STREAM_ENCODED_MAX];
+	uint16_t length = streamEncodeDownlink((uint8_t)node, command, (uint8_t)size, message);
+	fwrite(message, 1, length, output);
+	if (output != stdout)
+	{
+		fclose(output);
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: downlink <device> node=<id> command=<hex> | downlink simulate [key=value ...]\n");
+		return 1;
+	}
+	if (strcmp(argv[1], "simulate") != 0)
+	{
+		return sendCommand(argc, argv);
+	}
+
+	radio = nodeDefaultConfig();
+	uint32_t nodeCount = 20;
+	double every = 60e3;
+	double duration = 3600e3;
+	double drift = DRIFT_DEFAULT_PPB;
+	uint32_t seed = 1;
+	double slow = 0.25;
+	window.rxTime = radio.rxTime;
+	window.sleepTime = radio.rxSleepTime;
+	window.maxWait = SLEEP_TIME + SEND_TOLERANCE;
+	for (int arg = 2; arg < argc; arg++)
+	{
+		char key[32];
+		double value;
+		if (sscanf(argv[arg], "%31[^=]=%lf", key, &value) != 2)
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[arg]);
+			return 1;
+		}
+		if (strcmp(key, "nodes") == 0)
+		{
+			nodeCount = (uint32_t)value;
+		}
+		else if (strcmp(key, "every") == 0)
+		{
+			every = value * 1000.0;
+		}
+		else if (strcmp(key, "time") == 0)
+		{
+			duration = value * 1000.0;
+		}
+		else if (strcmp(key, "rx") == 0)
+		{
+			window.rxTime = (uint32_t)value;
+		}
+		else if (strcmp(key, "sleep") == 0)
+		{
+			window.sleepTime = (uint32_t)value;
+		}
+		else if (strcmp(key, "drift") == 0)
+		{
+			drift = value;
+		}
+		else if (strcmp(key, "slow") == 0)
+		{
+			slow = value / 100.0;
+		}
+		else if (strcmp(key, "unknown") == 0)
+		{
+			sendFactor = value == 0;
+		}
+		else if (strcmp(key, "wait") == 0)
+		{
+			window.maxWait = (uint32_t)value;
+		}
+		else if (strcmp(key, "retry") == 0)
+		{
+			retryTime = value;
+		}
+		else if (strcmp(key, "seed") == 0)
+		{
+			seed = (uint32_t)value;
+		}
+		else
+		{
+			fprintf(stderr, "Unknown key %s\n", key);
+			return 1;
+		}
+	}
+	if ((nodeCount == 0) || (nodeCount > 256) || (every <= 0) || (window.rxTime == 0) || (retryTime <= 0) || (slow < 0) || (slow > 1))
+	{
+		fprintf(stderr, "Invalid settings\n");
+		return 1;
+	}
+
+	// Same as getDownlinkWindow() in lora.cpp
+	window.openDelay = DOWNLINK_OPEN_DELAY;
+	window.symbolTime = (uint32_t)nodeSymbolTime(&radio);
+	window.detectTime = (DOWNLINK_DETECT_SYMBOLS * window.symbolTime + 999) / 1000;
+	window.drift = 2 * DRIFT_DEFAULT_PPB;
+	window.minGuard = CLOCK_MIN_GUARD;
+	window.preambleLength = radio.preambleLength;
+
+	printf("%lu nodes, uplink every %us, a command every %.0fs per node, RX duty cycle %lums / %lums, %.0f%% with sleep factor 2 or 4%s, "
+		   "drift up to %.0fppb\n\n",
+		   (unsigned long)nodeCount, SLEEP_TIME / 1000, every / 1000.0, (unsigned long)window.rxTime,
+		   (unsigned long)window.sleepTime, slow * 100.0, sendFactor ? "" : " (not sent)", drift);
+	std::vector<sim_node_t> nodes = simNodes(nodeCount, drift, slow, every, seed);
+	sim_result_t blind = simBlind(nodes, every, duration, seed);
+	sim_result_t queued = simQueue(nodes, every, duration, seed);
+	printResult("blind", &blind);
+	printResult("queue", &queued);
+	return 0;
+}
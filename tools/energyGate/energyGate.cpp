@@ -0,0 +1,300 @@
+/**
+ * @file energyGate.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Run the firmware for a simulated day with fixed traffic and compare the energy figures with a baseline
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build (the release firmware, add the -D options of the build to check):
+ *   g++ -O2 -DMYLOG_LOG_LEVEL=0 -o energyGate energyGate.cpp ../replay/host/host.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/src/[a-z]*.cpp $(find ../../PlatformIO/LoRa-DeepSleep/lib -name "*.cpp")
+ *       -I../replay/host -I../common -I../../PlatformIO/LoRa-DeepSleep/src
+ *       $(find ../../PlatformIO/LoRa-DeepSleep/lib -mindepth 1 -type d -printf "-I%p ")
+ *
+ * Usage:
+ *   energyGate                          run the day and print the figures
+ *   energyGate compare=baseline.txt     fail (exit code 1) if a figure got worse by more than tolerance=5 (%)
+ *   energyGate save=baseline.txt        store the figures as new baseline
+ *
+ * Traffic of the day: 4 neighbours send a package every 10s on the same channel, 5% of the CADs
+ * find the channel busy. The node hears a neighbour if the radio listens in RX duty cycle mode when
+ * the package starts, with the probability of the listen ratio. The battery stays at 4000mV.
+ * After the day a regression check gives the node a package RX_BEFORE_TIMER_US before its wakeup
+ * timer fires, the timer wakeup must not get lost and the node has to keep sending.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "main.h"
+#include "nodeSim.h"
+
+// Entry point of the firmware
+void setup(void);
+
+/** Length of the simulated day in us */
+#define DAY_US (86400ULL * 1000000ULL)
+/** Neighbour traffic */
+#define NEIGHBOURS 4
+#define NEIGHBOUR_PERIOD_US 10000000ULL
+/** Probability of a busy channel in 1/1000 */
+#define CAD_BUSY_PERMILLE 50
+/** Time from the package of the regression check to the timer wakeup, within the time the loop task is awake */
+#define RX_BEFORE_TIMER_US 5000ULL
+/** Time the node has to keep sending after it */
+#define CHECK_US (3600ULL * 1000000ULL)
+/** Battery voltage of the day */
+#define BATTERY_MV 4000
+/** Raw ADC value for the battery voltage, see battery.cpp */
+#define BATTERY_RAW ((uint16_t)(BATTERY_MV / (1.73 * 0.73242188)))
+
+/** Figures that are compared with the baseline, all smaller is better */
+#define FIGURE_CURRENT 0
+#define FIGURE_AWAKE 1
+#define FIGURE_AIRTIME 2
+#define FIGURE_NUM 3
+
+static const char *figureName[FIGURE_NUM] = {"average current uA", "awake per wake ms", "airtime per sample ms"};
+
+/** Pseudo random numbers, the same on every run */
+static uint32_t randomState = 12345;
+
+static uint32_t nextRandom(uint32_t range)
+{
+	randomState = randomState * 1103515245 + 12345;
+	return (randomState >> 8) % range;
+}
+
+/** Radio settings of the firmware */
+static node_config_t config;
+
+static uint32_t simCadTime(void)
+{
+	return nodeCadTime(&config);
+}
+
+static bool simCadBusy(void)
+{
+	return nextRandom(1000) < CAD_BUSY_PERMILLE;
+}
+
+static uint32_t simTxTime(uint8_t size)
+{
+	return nodeTimeOnAir(&config, size);
+}
+
+static const host_radio_sim_t radioSim = {simCadTime, simCadBusy, simTxTime};
+
+/**
+ * @brief Run the day
+ *
+ * @param figures output
+ */
+static void simulateDay(double *figures)
+{
+	uint64_t neighbour[NEIGHBOURS];
+	uint32_t heard = 0;
+	config = nodeDefaultConfig();
+	uint32_t listenRatio = 1000 * config.rxTime / (config.rxTime + config.rxSleepTime);
+
+	hostInit(NULL);
+	hostRadioSim = &radioSim;
+	hostAdcValue = BATTERY_RAW;
+	setup();
+	uint64_t start = hostTime;
+	uint32_t startTakes = hostTakes;
+	for (uint8_t idx = 0; idx < NEIGHBOURS; idx++)
+	{
+		neighbour[idx] = start + NEIGHBOUR_PERIOD_US * (idx + 1) / (NEIGHBOURS + 1);
+	}
+
+	while (hostTime < start + DAY_US)
+	{
+		uint8_t sender = 0;
+		for (uint8_t idx = 0; idx < NEIGHBOURS; idx++)
+		{
+			if (neighbour[idx] < neighbour[sender])
+			{
+				sender = idx;
+			}
+		}
+		uint64_t next = hostNextTimer();
+		if (neighbour[sender] < next)
+		{
+			hostAdvance(neighbour[sender]);
+			neighbour[sender] += NEIGHBOUR_PERIOD_US;
+			if ((hostRadioState == HOST_RADIO_RX_DUTY_CYCLE) && (nextRandom(1000) < listenRatio))
+			{
+				uint8_t payload[PAYLOAD_SIZE] = {0};
+				heard++;
+				hostRadioEvents->RxDone(payload, sizeof(payload), -90, 8);
+			}
+		}
+		else
+		{
+			// Fires the timer or finishes the CAD or TX
+			hostAdvance(next);
+		}
+		hostRunLoop();
+	}
+
+	uint32_t wakes = hostTakes - startTakes;
+	figures[FIGURE_CURRENT] = (double)energyTotalCharge(&energy) / (millis() - start / 1000);
+	figures[FIGURE_AWAKE] = wakes ? (double)energy.time[ENERGY_MCU] / wakes : 0.0;
+	figures[FIGURE_AIRTIME] = hostRadioCalls.send ? (double)energy.time[ENERGY_RADIO_TX] / hostRadioCalls.send : 0.0;
+	printf("Simulated day: %u wakes, %u packages sent, %u received, %u CAD\n", wakes, hostRadioCalls.send, heard, hostRadioCalls.cad);
+}
+
+/**
+ * @brief A package that wakes up the loop task just before the wakeup timer fires
+ *
+ * @return true if the node still sends packages afterwards
+ */
+static bool checkRxBeforeTimer(void)
+{
+	hostInit(NULL);
+	hostRadioSim = &radioSim;
+	hostAdcValue = BATTERY_RAW;
+	setup();
+	uint64_t start = hostTime;
+	hostAdvance(hostNextTimer() - RX_BEFORE_TIMER_US);
+	hostRunLoop();
+	uint8_t payload[PAYLOAD_SIZE] = {0};
+	hostRadioEvents->RxDone(payload, sizeof(payload), -90, 8);
+	hostRunLoop();
+
+	uint32_t sent = hostRadioCalls.send;
+	while (hostTime < start + CHECK_US)
+	{
+		uint64_t next = hostNextTimer();
+		if (next == UINT64_MAX)
+		{
+			break;
+		}
+		hostAdvance(next);
+		hostRunLoop();
+	}
+	sent = hostRadioCalls.send - sent;
+	printf("Package %llums before the timer wakeup: %u packages sent in the next hour\n",
+		   (unsigned long long)(RX_BEFORE_TIMER_US / 1000), sent);
+	return sent >= CHECK_US / 1000 / (SLEEP_TIME) / 2;
+}
+
+/**
+ * @brief Read "name;value" lines of a baseline
+ *
+ * @return true if all figures are in the file
+ */
+static bool readBaseline(const char *fileName, double *baseline)
+{
+	FILE *file = fopen(fileName, "r");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Cannot open %s\n", fileName);
+		return false;
+	}
+	uint8_t found = 0;
+	char line[128];
+	while (fgets(line, sizeof(line), file))
+	{
+		char name[64];
+		double value;
+		if (sscanf(line, "%63[^;];%lf", name, &value) != 2)
+		{
+			continue;
+		}
+		for (uint8_t figure = 0; figure < FIGURE_NUM; figure++)
+		{
+			if (strcmp(name, figureName[figure]) == 0)
+			{
+				baseline[figure] = value;
+				found |= 1 << figure;
+			}
+		}
+	}
+	fclose(file);
+	return found == (1 << FIGURE_NUM) - 1;
+}
+
+int main(int argc, char **argv)
+{
+	const char *saveName = NULL;
+	const char *compareName = NULL;
+	double tolerance = 5.0;
+	for (int arg = 1; arg < argc; arg++)
+	{
+		if (strncmp(argv[arg], "save=", 5) == 0)
+		{
+			saveName = argv[arg] + 5;
+		}
+		else if (strncmp(argv[arg], "compare=", 8) == 0)
+		{
+			compareName = argv[arg] + 8;
+		}
+		else if (sscanf(argv[arg], "tolerance=%lf", &tolerance) == 1)
+		{
+			continue;
+		}
+		else
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[arg]);
+			return 1;
+		}
+	}
+
+	double baseline[FIGURE_NUM];
+	if ((compareName != NULL) && !readBaseline(compareName, baseline))
+	{
+		fprintf(stderr, "Baseline %s is incomplete\n", compareName);
+		return 1;
+	}
+
+	double figures[FIGURE_NUM];
+	simulateDay(figures);
+
+	int regressions = 0;
+	for (uint8_t figure = 0; figure < FIGURE_NUM; figure++)
+	{
+		printf("%-22s %10.2f", figureName[figure], figures[figure]);
+		if (compareName != NULL)
+		{
+			double change = baseline[figure] > 0.0 ? 100.0 * (figures[figure] - baseline[figure]) / baseline[figure] : 0.0;
+			printf("  baseline %10.2f %+6.1f%%", baseline[figure], change);
+			if (change > tolerance)
+			{
+				printf("  REGRESSION");
+				regressions++;
+			}
+		}
+		printf("\n");
+	}
+
+	if (saveName != NULL)
+	{
+		FILE *file = fopen(saveName, "w");
+		if (file == NULL)
+		{
+			fprintf(stderr, "Cannot write %s\n", saveName);
+			return 1;
+		}
+		fprintf(file, "# figure;value of the simulated day\n");
+		for (uint8_t figure = 0; figure < FIGURE_NUM; figure++)
+		{
+			fprintf(file, "%s;%.2f\n", figureName[figure], figures[figure]);
+		}
+		fclose(file);
+	}
+	if (compareName != NULL)
+	{
+		printf("%d regressions above %.0f%%\n", regressions, tolerance);
+	}
+	if (!checkRxBeforeTimer())
+	{
+		printf("REGRESSION: the node stopped sending\n");
+		regressions++;
+	}
+	return regressions ? 1 : 0;
+}
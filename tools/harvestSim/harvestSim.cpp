@@ -0,0 +1,255 @@
+/**
+ * @file harvestSim.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host simulation of the harvesting controller driven by an irradiance trace
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build:
+ *   g++ -O2 -o harvestSim harvestSim.cpp ../../PlatformIO/LoRa-DeepSleep/lib/energyModel/energyModel.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/lib/harvestControl/harvestControl.cpp
+ *       -I../common -I../../PlatformIO/LoRa-DeepSleep/lib/energyModel -I../../PlatformIO/LoRa-DeepSleep/lib/harvestControl
+ *       -I../../PlatformIO/LoRa-DeepSleep/lib/nodePayload
+ *
+ * Usage:
+ *   harvestSim [trace.csv]
+ *   The trace has one "seconds,W/m2" line per sample. Without trace three synthetic days are used.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "energyModel.h"
+#include "harvestControl.h"
+#include "nodeSim.h"
+
+// Same values as HARVEST_xxx in main.h
+#define CAPACITANCE 10000 // mF
+#define TARGET_MV 4000
+#define MIN_MV 3000
+
+// Solar panel and storage
+#define PANEL_AREA 0.0025	   // m2, 50 x 50 mm
+#define PANEL_EFFICIENCY 0.15  // cell efficiency
+#define CHARGER_EFFICIENCY 0.8 // charger efficiency
+#define STORAGE_MAX_MV 5000	   // supercapacitor rating
+#define STORAGE_LEAKAGE 5	   // uA
+#define BROWNOUT_MV 2700	   // node stops below this
+#define RESTART_MV 3100		   // node starts again above this
+#define START_MV 3800
+
+/** One irradiance sample */
+typedef struct
+{
+	uint32_t time; // s
+	double irradiance; // W/m2
+} sample_t;
+
+/** Result of one simulation run */
+typedef struct
+{
+	uint32_t packets;
+	uint32_t brownoutTime; // s
+	uint16_t minVoltage;
+	uint16_t maxVoltage;
+	uint64_t stepSum;
+	uint32_t cycles;
+} result_t;
+
+/**
+ * @brief Three days, sunny, cloudy and sunny with passing clouds
+ */
+static std::vector<sample_t> syntheticTrace(void)
+{
+	std::vector<sample_t> trace;
+	const double peak[3] = {800.0, 150.0, 600.0};
+	for (uint32_t t = 0; t < 3 * 86400; t += 60)
+	{
+		uint32_t day = t / 86400;
+		double hour = (t % 86400) / 3600.0;
+		double value = 0.0;
+		if ((hour > 6.0) && (hour < 18.0))
+		{
+			value = peak[day] * sin((hour - 6.0) / 12.0 * M_PI);
+			if ((day == 2) && ((t / 1800) % 3 == 0))
+			{
+				value *= 0.3;
+			}
+		}
+		sample_t sample = {t, value};
+		trace.push_back(sample);
+	}
+	return trace;
+}
+
+/**
+ * @brief Read "seconds,W/m2" lines
+ */
+static std::vector<sample_t> readTrace(const char *fileName)
+{
+	std::vector<sample_t> trace;
+	FILE *file = fopen(fileName, "r");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Cannot open %s\n", fileName);
+		exit(1);
+	}
+	char line[128];
+	while (fgets(line, sizeof(line), file))
+	{
+		sample_t sample;
+		if (sscanf(line, "%u,%lf", &sample.time, &sample.irradiance) == 2)
+		{
+			trace.push_back(sample);
+		}
+	}
+	fclose(file);
+	return trace;
+}
+
+/**
+ * @brief Irradiance at a time, the trace is held between samples
+ */
+static double irradianceAt(const std::vector<sample_t> &trace, size_t *idx, uint32_t time)
+{
+	while ((*idx + 1 < trace.size()) && (trace[*idx + 1].time <= time))
+	{
+		(*idx)++;
+	}
+	return trace[*idx].irradiance;
+}
+
+/**
+ * @brief Run the node on the trace
+ *
+ * @param trace irradiance trace
+ * @param controlled true to use the harvesting controller, false to keep step 0
+ * @param csv optional output of the storage voltage and step over time
+ */
+static result_t simulate(const std::vector<sample_t> &trace, bool controlled, FILE *csv)
+{
+	result_t result = {0, 0, 0xFFFF, 0, 0, 0};
+	harvest_ctrl_t ctrl;
+	harvestInit(&ctrl, CAPACITANCE, TARGET_MV, MIN_MV);
+	energy_model_t model;
+	energyInit(&model);
+	node_config_t config = nodeDefaultConfig();
+
+	double voltage = START_MV;
+	bool running = true;
+	size_t idx = 0;
+	uint32_t end = trace.back().time;
+	uint32_t time = 0;
+	uint32_t lastLog = 0;
+
+	while (time < end)
+	{
+		const harvest_step_t *step = &harvestLadder[ctrl.step];
+		uint32_t period = config.sleepTime * step->sleepMultiplier;
+		config.txPower = step->txPower;
+		config.txOnly = (step->rxSleepFactor == 0);
+		config.rxSleepTime = nodeRxSleepTime(step->rxSleepFactor);
+
+		// Harvested current into the storage at the present voltage in uA
+		double power = irradianceAt(trace, &idx, time) * PANEL_AREA * PANEL_EFFICIENCY * CHARGER_EFFICIENCY;
+		double harvest = power / (voltage / 1000.0) * 1e6;
+
+		double consumed = 0.0;
+		if (running)
+		{
+			uint64_t before = energyTotalCharge(&model);
+			nodeSimCycle(&config, &model, period);
+			consumed = (double)(energyTotalCharge(&model) - before) / period; // uA
+			result.packets++;
+		}
+		else
+		{
+			result.brownoutTime += period / 1000;
+		}
+
+		// mF * mV = uC, uA * ms = nC
+		voltage += (harvest - consumed - STORAGE_LEAKAGE) * period / 1000.0 / CAPACITANCE;
+		if (voltage > STORAGE_MAX_MV)
+		{
+			voltage = STORAGE_MAX_MV;
+		}
+		if (voltage < 0)
+		{
+			voltage = 0;
+		}
+		if (running && (voltage < BROWNOUT_MV))
+		{
+			running = false;
+		}
+		else if (!running && (voltage > RESTART_MV))
+		{
+			running = true;
+			harvestInit(&ctrl, CAPACITANCE, TARGET_MV, MIN_MV);
+		}
+
+		if (running && controlled)
+		{
+			harvestUpdate(&ctrl, (uint16_t)voltage, energyTotalCharge(&model), period);
+		}
+
+		if ((uint16_t)voltage < result.minVoltage)
+		{
+			result.minVoltage = (uint16_t)voltage;
+		}
+		if ((uint16_t)voltage > result.maxVoltage)
+		{
+			result.maxVoltage = (uint16_t)voltage;
+		}
+		result.stepSum += ctrl.step;
+		result.cycles++;
+
+		if ((csv != NULL) && (time - lastLog >= 600))
+		{
+			fprintf(csv, "%u,%.0f,%.0f,%d,%d\n", time, irradianceAt(trace, &idx, time), voltage, ctrl.step, running ? 1 : 0);
+			lastLog = time;
+		}
+		time += period / 1000;
+	}
+	return result;
+}
+
+/**
+ * @brief Print one result line
+ */
+static void printResult(const char *name, const result_t *result, uint32_t duration)
+{
+	printf("%-14s packets %7u  brownout %6us (%4.1f%%)  storage %4u..%4umV  average step %.2f\n",
+		   name, result->packets, result->brownoutTime, 100.0 * result->brownoutTime / duration,
+		   result->minVoltage, result->maxVoltage, (double)result->stepSum / result->cycles);
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<sample_t> trace = (argc > 1) ? readTrace(argv[1]) : syntheticTrace();
+	if (trace.size() < 2)
+	{
+		fprintf(stderr, "Trace needs at least two samples\n");
+		return 1;
+	}
+	uint32_t duration = trace.back().time;
+
+	FILE *csv = fopen("harvestSim.csv", "w");
+	if (csv != NULL)
+	{
+		fprintf(csv, "time,irradiance,storage_mv,step,running\n");
+	}
+	result_t fixed = simulate(trace, false, NULL);
+	result_t controlled = simulate(trace, true, csv);
+	if (csv != NULL)
+	{
+		fclose(csv);
+	}
+
+	printf("Trace %u samples, %.1f days\n", (unsigned)trace.size(), duration / 86400.0);
+	printResult("fixed", &fixed, duration);
+	printResult("controlled", &controlled, duration);
+	return 0;
+}
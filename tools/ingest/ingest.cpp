@@ -0,0 +1,696 @@
+/**
+ * @file ingest.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Multi-threaded ingest of receiver streams: parse, decode, deduplicate and store the node packages
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build:
+ *   g++ -O2 -pthread -o ingest ingest.cpp ../../PlatformIO/LoRa-DeepSleep/lib/rxStream/rxStream.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/lib/nodePayload/nodePayload.cpp
+ *       -I../common -I../../PlatformIO/LoRa-DeepSleep/lib/rxStream -I../../PlatformIO/LoRa-DeepSleep/lib/rxRing
+ *       -I../../PlatformIO/LoRa-DeepSleep/lib/nodePayload
+ *
+ * Usage:
+ *   ingest /dev/ttyACM0 /dev/ttyACM1   one reader thread per receiver stream (device in raw mode, file or - for stdin)
+ *                                      captured files are timed by the frame time stamps, devices and pipes when read
+ *   ingest generate=1000000            synthetic streams in memory, measures the throughput
+ *   nodes=200 receivers=3              nodes and receivers of the synthetic streams, every receiver hears every package
+ *   workers=N                          worker threads, default number of cores
+ *   out=ingest                         store the packages, worker N writes ingestN.csv
+ *   store=dir                          store the packages in the time-series store (tools/common/tsStore.h)
+ *
+ * A reader thread parses its stream and hands the frames to the workers through one lock-free
+ * queue per reader and worker. The frames are distributed by device ID, so all packages of a node
+ * end up in the same worker and deduplication and storage need no locks. A package heard by several
+ * receivers is stored once: a worker keeps the hashes and arrival times of the last DEDUP_DEPTH
+ * packages of each node. A copy arrives within DEDUP_WINDOW_MS, the same content sent again in a
+ * later send interval (e.g. unchanged sensor values) is a new package.
+ * Frames that are not node packages (e.g. time references) are counted and skipped.
+ * The time of a sample is the time the reader got the frame minus the sample age. The reader
+ * uses read() on the device, which returns as soon as the receiver wrote a batch, so the time is
+ * that of the batch and not of a full buffer. A captured file is read at once, its frames and
+ * the synthetic streams get the time of the first frame plus their receiver time stamps.
+ * Idle workers sleep on a condition variable, a reader wakes them up when it queues a frame.
+ * A worker writes the store block of a node at the latest TS_FLUSH_MS after its first sample.
+ * SIGINT and SIGTERM stop the readers, the workers process the queued frames and all files
+ * are written and closed as at the end of the streams.
+ */
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <errno.h>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "nodePayload.h"
+#include "rxStream.h"
+#include "spscQueue.h"
+#include "tsStore.h"
+
+/** Frames in each reader to worker queue */
+#define QUEUE_SIZE 1024
+/** Longest sleep of an idle worker in ms, it checks the end of the readers after it */
+#define WORKER_SLEEP_MS 100
+/** Rounds over empty queues a worker yields before it sleeps, under load the next frame is close */
+#define WORKER_SPIN 64
+/** Time in ms between the checks of a worker for store blocks that wait too long */
+#define FLUSH_CHECK_MS 1000
+/** Frames a busy worker processes between the checks of the time */
+#define FLUSH_CHECK_FRAMES 4096
+/** Longest wait of a reader for data from a device in ms, it checks for a stop request after it */
+#define READ_TIMEOUT_MS 200
+/** Packages per node that are remembered for deduplication */
+#define DEDUP_DEPTH 64
+/** Copies of a package arrive within this time in ms: airtime up to SF12 plus the receiver and USB latency */
+#define DEDUP_WINDOW_MS 5000
+/** Node devices IDs are one byte */
+#define DEVICE_NUM 256
+/** Frames per second a receiver can get at SF7 / 125kHz with 18 byte packages, see tools/rxBench */
+#define LINE_RATE 19.4
+
+/** A frame on its way from a reader to a worker */
+typedef struct
+{
+	rx_frame_t frame;
+	/** Index of the stream */
+	uint8_t receiver;
+	/** Time the reader got the frame in ms since 1970 */
+	int64_t arrival;
+} ingest_item_t;
+
+typedef SpscQueue<ingest_item_t, QUEUE_SIZE> ingest_queue_t;
+
+/** Packages seen of one node */
+typedef struct
+{
+	uint32_t hash[DEDUP_DEPTH];
+	/** Arrival time of the package in ms */
+	int64_t time[DEDUP_DEPTH];
+	uint8_t next;
+	uint8_t count;
+} dedup_t;
+
+/** State and statistics of a worker, each in its own cache lines */
+typedef struct alignas(64)
+{
+	uint64_t frames;
+	uint64_t notData;
+	uint64_t duplicates;
+	uint64_t stored;
+	FILE *out;
+	/** Time-series store writers of the nodes of this worker, opened with the first package */
+	ts_writer_t *store[DEVICE_NUM];
+	dedup_t dedup[DEVICE_NUM];
+} worker_t;
+
+/** Sleep of an idle worker */
+typedef struct
+{
+	std::mutex mutex;
+	std::condition_variable wake;
+	/** The worker found its queues empty and waits, readers have to notify it */
+	std::atomic<bool> sleeping;
+} worker_wait_t;
+
+/** A stream, either a file or a buffer in memory */
+typedef struct
+{
+	/** File descriptor, -1 for a buffer in memory */
+	int fd;
+	/** Device or pipe, the frames arrive while they are received */
+	bool live;
+	std::vector<uint8_t> memory;
+	uint64_t bytes;
+	uint64_t frames;
+	uint64_t errors;
+	/** Times the reader had to wait for a full queue */
+	uint64_t waits;
+} input_t;
+
+static std::vector<input_t> inputs;
+static std::vector<std::unique_ptr<ingest_queue_t> > queues;
+static std::vector<worker_t> workerState;
+static std::vector<std::unique_ptr<worker_wait_t> > workerWait;
+static unsigned workerCount;
+static const char *storeDir = NULL;
+/** Start time of the synthetic streams, 2026-01-01 in ms since 1970 */
+#define GENERATE_START 1767225600000LL
+/** Send interval of the nodes in the synthetic streams in ms, SLEEP_TIME of the firmware */
+#define GENERATE_INTERVAL 10000
+/** Time between two packages in the synthetic streams in ms, airtime of 18 bytes at SF7 */
+#define GENERATE_SPACING 52
+static std::atomic<unsigned> readersLeft(0);
+/** Arrival time of the last frame of each synthetic stream. Live receivers hear a package at the
+ * same time, the synthetic readers keep within DEDUP_WINDOW_MS / 2 of each other to do the same. */
+static std::unique_ptr<std::atomic<int64_t>[]> readerTime;
+/** Set by SIGINT or SIGTERM, the readers stop */
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onStop(int)
+{
+	stopRequested = 1;
+}
+
+/**
+ * @brief FNV-1a hash of a package
+ */
+static uint32_t packageHash(const uint8_t *data, uint8_t size)
+{
+	uint32_t hash = 2166136261u;
+	for (uint8_t idx = 0; idx < size; idx++)
+	{
+		hash = (hash ^ data[idx]) * 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * @brief Check if the package was seen within DEDUP_WINDOW_MS and remember it
+ *
+ * @param dedup packages seen of the node
+ * @param hash hash of the package
+ * @param time arrival time of the package in ms
+ * @return true if it is a copy from another receiver
+ */
+static bool isDuplicate(dedup_t *dedup, uint32_t hash, int64_t time)
+{
+	for (uint8_t idx = 0; idx < dedup->count; idx++)
+	{
+		int64_t apart = time - dedup->time[idx];
+		if ((dedup->hash[idx] == hash) && (apart <= DEDUP_WINDOW_MS) && (apart >= -DEDUP_WINDOW_MS))
+		{
+			return true;
+		}
+	}
+	dedup->hash[dedup->next] = hash;
+	dedup->time[dedup->next] = time;
+	dedup->next = (dedup->next + 1) % DEDUP_DEPTH;
+	if (dedup->count < DEDUP_DEPTH)
+	{
+		dedup->count++;
+	}
+	return false;
+}
+
+/**
+ * @brief Wake up a worker if it sleeps. The worker sets sleeping before it checks its queues
+ * the last time, so either it sees the new frame or the reader sees it sleeping.
+ */
+static void wakeWorker(unsigned index)
+{
+	worker_wait_t *wait = workerWait[index].get();
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (wait->sleeping.load(std::memory_order_relaxed))
+	{
+		// Taking the mutex makes sure the worker is waiting and not between its check and the wait
+		std::lock_guard<std::mutex> lock(wait->mutex);
+		wait->wake.notify_one();
+	}
+}
+
+/**
+ * @brief Reader thread: parse the stream and distribute the frames by device ID
+ */
+static void reader(unsigned receiver)
+{
+	input_t *input = &inputs[receiver];
+	stream_parser_t parser;
+	streamParserInit(&parser);
+	ingest_item_t item;
+	item.receiver = (uint8_t)receiver;
+
+	uint8_t buffer[4096];
+	size_t offset = 0;
+	/** Receiver time of the last frame in us without the wrap of the 32 bit frame time, from the first frame */
+	uint64_t frameTime = 0;
+	bool firstFrame = true;
+	/** Time of the first frame of a file or a synthetic stream in ms since 1970 */
+	int64_t start = input->fd < 0 ? GENERATE_START : std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	uint32_t startTime = 0;
+	while (!stopRequested)
+	{
+		const uint8_t *data;
+		size_t length;
+		if (input->fd >= 0)
+		{
+			// A device can stay quiet for a long time, read() would not return for the stop request
+			struct pollfd ready = {input->fd, POLLIN, 0};
+			if (input->live && (poll(&ready, 1, READ_TIMEOUT_MS) <= 0))
+			{
+				continue;
+			}
+			ssize_t count = read(input->fd, buffer, sizeof(buffer));
+			if ((count < 0) && (errno == EINTR))
+			{
+				continue;
+			}
+			length = count > 0 ? (size_t)count : 0;
+			data = buffer;
+			item.arrival = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		}
+		else
+		{
+			length = input->memory.size() - offset < 65536 ? input->memory.size() - offset : 65536;
+			data = &input->memory[offset];
+			offset += length;
+		}
+		if (length == 0)
+		{
+			break;
+		}
+		input->bytes += length;
+
+		for (size_t idx = 0; idx < length; idx++)
+		{
+			if (!streamParse(&parser, data[idx], &item.frame))
+			{
+				continue;
+			}
+			if (!input->live)
+			{
+				if (firstFrame)
+				{
+					startTime = input->fd < 0 ? 0 : item.frame.time;
+					firstFrame = false;
+				}
+				frameTime += (uint32_t)(item.frame.time - startTime - (uint32_t)frameTime);
+				item.arrival = start + (int64_t)(frameTime / 1000);
+			}
+			if (input->fd < 0)
+			{
+				readerTime[receiver].store(item.arrival, std::memory_order_relaxed);
+				for (size_t other = 0; other < inputs.size(); other++)
+				{
+					while (readerTime[other].load(std::memory_order_relaxed) < item.arrival - DEDUP_WINDOW_MS / 2)
+					{
+						std::this_thread::yield();
+					}
+				}
+			}
+			unsigned worker = item.frame.size != 0 ? item.frame.data[0] % workerCount : 0;
+			ingest_queue_t *queue = queues[receiver * workerCount + worker].get();
+			while (!queue->push(item))
+			{
+				input->waits++;
+				std::this_thread::yield();
+			}
+			wakeWorker(worker);
+		}
+	}
+	input->frames = parser.frames;
+	input->errors = parser.errors + parser.overruns;
+	if (input->fd < 0)
+	{
+		readerTime[receiver].store(INT64_MAX, std::memory_order_relaxed);
+	}
+	readersLeft--;
+	for (unsigned index = 0; index < workerCount; index++)
+	{
+		wakeWorker(index);
+	}
+}
+
+/**
+ * @brief Decode, deduplicate and store one frame
+ */
+static void process(worker_t *state, const ingest_item_t *item)
+{
+	const rx_frame_t *frame = &item->frame;
+	state->frames++;
+
+	node_payload_t payload;
+	if (!payloadDecode(&payload, frame->data, frame->size))
+	{
+		state->notData++;
+		return;
+	}
+	// Only the node package counts, the appended profiler statistics are not part of the hash
+	if (isDuplicate(&state->dedup[payload.deviceId], packageHash(frame->data, PAYLOAD_SIZE), item->arrival))
+	{
+		state->duplicates++;
+		return;
+	}
+	state->stored++;
+	if (state->out != NULL)
+	{
+		fprintf(state->out, "%u,%u,%lu,%d,%d,%u,%u.%02u,%u.%02u,%u,%u,%d,%u,%u\n", item->receiver, frame->sequence,
+				(unsigned long)frame->time, frame->rssi, frame->snr, payload.deviceId, payload.temperature,
+				payload.temperatureFraction, payload.humidity, payload.humidityFraction, payload.light,
+				payload.lightThreshold, payload.rssi, payload.battVoltage, payload.sampleAge * PAYLOAD_AGE_UNIT_MS);
+	}
+	if (storeDir != NULL)
+	{
+		ts_writer_t *writer = state->store[payload.deviceId];
+		if (writer == NULL)
+		{
+			writer = new ts_writer_t;
+			if (!tsWriterOpen(writer, storeDir, payload.deviceId))
+			{
+				fprintf(stderr, "Cannot write to %s\n", storeDir);
+				exit(1);
+			}
+			state->store[payload.deviceId] = writer;
+		}
+		ts_sample_t sample;
+		sample.value[TS_TIME] = item->arrival - payload.sampleAge * PAYLOAD_AGE_UNIT_MS;
+		sample.value[TS_TEMPERATURE] = payload.temperature * 100 + payload.temperatureFraction;
+		sample.value[TS_HUMIDITY] = payload.humidity * 100 + payload.humidityFraction;
+		sample.value[TS_LIGHT] = payload.light;
+		sample.value[TS_THRESHOLD] = payload.lightThreshold;
+		sample.value[TS_NODE_RSSI] = payload.rssi;
+		sample.value[TS_BATTERY] = payload.battVoltage;
+		sample.value[TS_AGE] = payload.sampleAge * PAYLOAD_AGE_UNIT_MS;
+		sample.value[TS_RSSI] = frame->rssi;
+		sample.value[TS_SNR] = frame->snr;
+		tsWriterAppend(writer, &sample);
+	}
+}
+
+/**
+ * @brief Write the store blocks whose first sample waits longer than TS_FLUSH_MS, at most every FLUSH_CHECK_MS
+ */
+static void flushOldBlocks(worker_t *state, int64_t *nextCheck)
+{
+	int64_t now = tsClockMs();
+	if (now < *nextCheck)
+	{
+		return;
+	}
+	*nextCheck = now + FLUSH_CHECK_MS;
+	for (unsigned device = 0; device < DEVICE_NUM; device++)
+	{
+		if (state->store[device] != NULL)
+		{
+			tsWriterFlushOld(state->store[device], now);
+		}
+	}
+}
+
+/**
+ * @brief Worker thread: take frames from the queues of all readers
+ */
+static bool queuesEmpty(unsigned index)
+{
+	for (size_t receiver = 0; receiver < inputs.size(); receiver++)
+	{
+		if (queues[receiver * workerCount + index]->front() != NULL)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void worker(unsigned index)
+{
+	worker_t *state = &workerState[index];
+	worker_wait_t *wait = workerWait[index].get();
+	uint32_t idleRounds = 0;
+	uint32_t busyRounds = 0;
+	int64_t nextCheck = 0;
+	while (true)
+	{
+		bool idle = true;
+		for (size_t receiver = 0; receiver < inputs.size(); receiver++)
+		{
+			ingest_queue_t *queue = queues[receiver * workerCount + index].get();
+			ingest_item_t *item = queue->front();
+			if (item != NULL)
+			{
+				process(state, item);
+				queue->pop();
+				idle = false;
+			}
+		}
+		if (idle)
+		{
+			// The queues are empty, once all readers are done they stay empty
+			bool done = readersLeft == 0;
+			if (done && queuesEmpty(index))
+			{
+				break;
+			}
+			if (++idleRounds < WORKER_SPIN)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			idleRounds = 0;
+			std::unique_lock<std::mutex> lock(wait->mutex);
+			wait->sleeping.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (queuesEmpty(index) && (readersLeft != 0))
+			{
+				wait->wake.wait_for(lock, std::chrono::milliseconds(WORKER_SLEEP_MS));
+			}
+			wait->sleeping.store(false, std::memory_order_relaxed);
+			flushOldBlocks(state, &nextCheck);
+		}
+		else
+		{
+			idleRounds = 0;
+			if (++busyRounds == FLUSH_CHECK_FRAMES)
+			{
+				busyRounds = 0;
+				flushOldBlocks(state, &nextCheck);
+			}
+		}
+	}
+}
+
+/**
+ * @brief Streams of receivers that all hear the same nodes. Each node sends every
+ * GENERATE_INTERVAL (longer if the nodes do not fit into it back to back). The sensor
+ * values change slowly, so a node often sends the same content as in an earlier interval.
+ */
+static void generate(uint32_t packages, uint32_t nodes, uint32_t receivers)
+{
+	inputs.resize(receivers);
+	for (uint32_t receiver = 0; receiver < receivers; receiver++)
+	{
+		inputs[receiver].fd = -1;
+	}
+	uint8_t message[STREAM_ENCODED_MAX];
+	node_payload_t payload = {0, 0, 0, 27, 35, 67, 55, 0x220C, 0x4B00, -80, 0, 0, 3700, 0, 1};
+	uint64_t interval = nodes * GENERATE_SPACING > GENERATE_INTERVAL ? nodes * GENERATE_SPACING : GENERATE_INTERVAL;
+	for (uint32_t count = 0; count < packages; count++)
+	{
+		uint32_t round = count / nodes;
+		payload.deviceId = (uint8_t)(count % nodes);
+		payload.temperature = (uint8_t)(20 + round / 4 % 3);
+		payload.humidityFraction = (uint8_t)(round / 8 % 2);
+		payload.battVoltage = (uint16_t)(3700 - round / 64 % 10);
+
+		rx_frame_t frame;
+		frame.size = payloadEncode(&payload, frame.data);
+		frame.time = (uint32_t)((round * interval + (count % nodes) * GENERATE_SPACING) * 1000);
+		frame.channel = 0;
+		for (uint32_t receiver = 0; receiver < receivers; receiver++)
+		{
+			frame.sequence = (uint16_t)count;
+			frame.rssi = (int16_t)(-60 - (int)((count + receiver * 7) % 60));
+			frame.snr = (int8_t)(10 - (int)((count + receiver) % 20));
+			uint16_t length = streamEncode(&frame, message);
+			inputs[receiver].memory.insert(inputs[receiver].memory.end(), message, message + length);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t packages = 0;
+	uint32_t nodes = 200;
+	uint32_t receivers = 3;
+	const char *out = NULL;
+	workerCount = std::thread::hardware_concurrency();
+	std::vector<const char *> names;
+
+	for (int arg = 1; arg < argc; arg++)
+	{
+		char key[32];
+		char text[200];
+		if (sscanf(argv[arg], "%31[^=]=%199s", key, text) != 2)
+		{
+			names.push_back(argv[arg]);
+			continue;
+		}
+		if (strcmp(key, "generate") == 0)
+		{
+			packages = (uint32_t)atol(text);
+		}
+		else if (strcmp(key, "nodes") == 0)
+		{
+			nodes = (uint32_t)atol(text);
+		}
+		else if (strcmp(key, "receivers") == 0)
+		{
+			receivers = (uint32_t)atol(text);
+		}
+		else if (strcmp(key, "workers") == 0)
+		{
+			workerCount = (unsigned)atol(text);
+		}
+		else if (strcmp(key, "out") == 0)
+		{
+			out = argv[arg] + strlen("out=");
+		}
+		else if (strcmp(key, "store") == 0)
+		{
+			storeDir = argv[arg] + strlen("store=");
+		}
+		else
+		{
+			fprintf(stderr, "Unknown key %s\n", key);
+			return 1;
+		}
+	}
+	if (workerCount == 0)
+	{
+		workerCount = 1;
+	}
+	if ((nodes == 0) || (nodes > DEVICE_NUM) || (receivers == 0) || (receivers > 255) || (names.size() > 255))
+	{
+		fprintf(stderr, "Invalid settings\n");
+		return 1;
+	}
+
+	if (packages != 0)
+	{
+		generate(packages, nodes, receivers);
+	}
+	else if (names.empty())
+	{
+		fprintf(stderr, "Usage: ingest <stream> [<stream> ...] [workers=N] [out=prefix] or ingest generate=N\n");
+		return 1;
+	}
+	else
+	{
+		inputs.resize(names.size());
+		for (size_t idx = 0; idx < names.size(); idx++)
+		{
+			inputs[idx].fd = strcmp(names[idx], "-") == 0 ? STDIN_FILENO : open(names[idx], O_RDONLY);
+			struct stat info;
+			if ((inputs[idx].fd < 0) || (fstat(inputs[idx].fd, &info) != 0))
+			{
+				fprintf(stderr, "Cannot open %s\n", names[idx]);
+				return 1;
+			}
+			inputs[idx].live = !S_ISREG(info.st_mode);
+		}
+	}
+
+	workerState.resize(workerCount);
+	for (unsigned index = 0; index < workerCount; index++)
+	{
+		workerWait.push_back(std::unique_ptr<worker_wait_t>(new worker_wait_t()));
+		memset(&workerState[index], 0, sizeof(worker_t));
+		if (out != NULL)
+		{
+			char name[256];
+			snprintf(name, sizeof(name), "%s%u.csv", out, index);
+			workerState[index].out = fopen(name, "w");
+			if (workerState[index].out == NULL)
+			{
+				fprintf(stderr, "Cannot write %s\n", name);
+				return 1;
+			}
+			fprintf(workerState[index].out, "receiver,sequence,time_us,rssi,snr,device,temperature,humidity,light,threshold,node_rssi,battery_mv,age_ms\n");
+		}
+	}
+	for (size_t idx = 0; idx < inputs.size() * workerCount; idx++)
+	{
+		queues.push_back(std::unique_ptr<ingest_queue_t>(new ingest_queue_t()));
+	}
+
+	readerTime.reset(new std::atomic<int64_t>[inputs.size()]);
+	for (size_t idx = 0; idx < inputs.size(); idx++)
+	{
+		readerTime[idx] = GENERATE_START;
+	}
+
+	// No SA_RESTART, a blocked read() or poll() returns with EINTR
+	struct sigaction stop;
+	memset(&stop, 0, sizeof(stop));
+	stop.sa_handler = onStop;
+	sigemptyset(&stop.sa_mask);
+	sigaction(SIGINT, &stop, NULL);
+	sigaction(SIGTERM, &stop, NULL);
+
+	auto start = std::chrono::steady_clock::now();
+	readersLeft = (unsigned)inputs.size();
+	std::vector<std::thread> threads;
+	for (unsigned index = 0; index < workerCount; index++)
+	{
+		threads.push_back(std::thread(worker, index));
+	}
+	for (unsigned receiver = 0; receiver < inputs.size(); receiver++)
+	{
+		threads.push_back(std::thread(reader, receiver));
+	}
+	for (size_t idx = 0; idx < threads.size(); idx++)
+	{
+		threads[idx].join();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	uint64_t bytes = 0, frames = 0, errors = 0, waits = 0;
+	for (size_t idx = 0; idx < inputs.size(); idx++)
+	{
+		bytes += inputs[idx].bytes;
+		frames += inputs[idx].frames;
+		errors += inputs[idx].errors;
+		waits += inputs[idx].waits;
+		if ((inputs[idx].fd >= 0) && (inputs[idx].fd != STDIN_FILENO))
+		{
+			close(inputs[idx].fd);
+		}
+	}
+	uint64_t notData = 0, duplicates = 0, stored = 0;
+	for (unsigned index = 0; index < workerCount; index++)
+	{
+		notData += workerState[index].notData;
+		duplicates += workerState[index].duplicates;
+		stored += workerState[index].stored;
+		if (workerState[index].out != NULL)
+		{
+			fclose(workerState[index].out);
+		}
+		for (unsigned device = 0; device < DEVICE_NUM; device++)
+		{
+			if (workerState[index].store[device] != NULL)
+			{
+				tsWriterClose(workerState[index].store[device]);
+				delete workerState[index].store[device];
+			}
+		}
+	}
+
+	if (stopRequested)
+	{
+		printf("Stopped, all queued frames are stored\n");
+	}
+	printf("%u streams, %u workers, %.3fs\n", (unsigned)inputs.size(), workerCount, seconds);
+	printf("%llu bytes, %llu frames, %llu broken messages, %llu waits for a full queue\n", (unsigned long long)bytes,
+		   (unsigned long long)frames, (unsigned long long)errors, (unsigned long long)waits);
+	printf("%llu stored, %llu duplicates, %llu not node packages\n", (unsigned long long)stored,
+		   (unsigned long long)duplicates, (unsigned long long)notData);
+	if (seconds > 0)
+	{
+		printf("%.0f frames/s, %.1f MB/s, enough for %.0f receivers at SF7 line rate (%.1f frames/s)\n", frames / seconds,
+			   bytes / seconds / 1e6, frames / seconds / LINE_RATE, LINE_RATE);
+	}
+	return 0;
+}
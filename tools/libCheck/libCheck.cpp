@@ -0,0 +1,236 @@
+/**
+ * @file libCheck.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Checks of the firmware libraries on the host
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build:
+ *   g++ -O2 -o libCheck libCheck.cpp ../../PlatformIO/LoRa-DeepSleep/lib/batteryPolicy/batteryPolicy.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/lib/jobScheduler/jobScheduler.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/lib/clockDrift/clockDrift.cpp
+ *       -I../../PlatformIO/LoRa-DeepSleep/lib/batteryPolicy -I../../PlatformIO/LoRa-DeepSleep/lib/jobScheduler
+ *       -I../../PlatformIO/LoRa-DeepSleep/lib/clockDrift
+ *
+ * Usage:
+ *   libCheck                       run all checks, exit code 1 if one fails
+ *
+ * Each failed check prints the library, the case and the expected and the real result.
+ */
+#include <stdio.h>
+
+#include "batteryPolicy.h"
+#include "clockDrift.h"
+#include "jobScheduler.h"
+
+/** Number of failed checks */
+static int failed = 0;
+
+static void expect(const char *name, const char *what, long expected, long result)
+{
+	if (expected != result)
+	{
+		printf("FAIL %s: %s, expected %ld, got %ld\n", name, what, expected, result);
+		failed++;
+	}
+}
+
+/**
+ * @brief Battery levels: down at once, up only with BATT_HYSTERESIS_MV above the limit of the new level,
+ * also when the voltage jumps over several levels (e.g. charger connected)
+ */
+static void checkBatteryPolicy(void)
+{
+	char what[64];
+	for (uint8_t last = 0; last < BATT_LEVEL_NUM; last++)
+	{
+		for (uint16_t voltage = 2800; voltage <= 4300; voltage++)
+		{
+			// Level without hysteresis
+			uint8_t plain = 0;
+			while ((plain < BATT_LEVEL_NUM - 1) && (voltage < battPolicy[plain].minVoltage))
+			{
+				plain++;
+			}
+			uint8_t expected = plain;
+			if (plain < last)
+			{
+				// Highest level up to the last one whose limit plus hysteresis is reached
+				expected = last;
+				for (uint8_t level = last; level-- > plain;)
+				{
+					if (voltage >= battPolicy[level].minVoltage + BATT_HYSTERESIS_MV)
+					{
+						expected = level;
+					}
+					else
+					{
+						break;
+					}
+				}
+			}
+			snprintf(what, sizeof(what), "level %d at %dmV", last, voltage);
+			expect("batteryPolicy", what, expected, battLevel(voltage, last));
+		}
+	}
+
+	// The cases that went wrong before: from LOW straight to FULL without hysteresis
+	expect("batteryPolicy", "LOW at 3720mV", BATT_LEVEL_OK, battLevel(3720, BATT_LEVEL_LOW));
+	expect("batteryPolicy", "CRITICAL at 3749mV", BATT_LEVEL_OK, battLevel(3749, BATT_LEVEL_CRITICAL));
+	expect("batteryPolicy", "CRITICAL at 3750mV", BATT_LEVEL_FULL, battLevel(3750, BATT_LEVEL_CRITICAL));
+	expect("batteryPolicy", "CRITICAL at 3349mV", BATT_LEVEL_CRITICAL, battLevel(3349, BATT_LEVEL_CRITICAL));
+	expect("batteryPolicy", "FULL at 3100mV", BATT_LEVEL_CRITICAL, battLevel(3100, BATT_LEVEL_FULL));
+}
+
+/** Jobs of the scheduler check */
+#define SIM_JOBS 3
+
+/** Simulated time in ms */
+static uint32_t simNow = 0;
+/** Period, tolerance and next due time of each job as the check expects them */
+static uint32_t simPeriod[SIM_JOBS];
+static uint32_t simTolerance[SIM_JOBS];
+static uint32_t simDue[SIM_JOBS];
+/** Runs of each job and runs outside of the window of the job */
+static uint32_t simRuns[SIM_JOBS];
+static uint32_t simLate[SIM_JOBS];
+
+static void simRun(uint8_t idx)
+{
+	if ((int32_t)(simNow - simDue[idx]) < 0 || (simNow - simDue[idx] > simTolerance[idx]))
+	{
+		printf("FAIL jobScheduler: job %d due at %lu ran at %lu\n", idx, (unsigned long)simDue[idx], (unsigned long)simNow);
+		simLate[idx]++;
+	}
+	simDue[idx] += simPeriod[idx];
+	simRuns[idx]++;
+}
+
+static void simJob0(void) { simRun(0); }
+static void simJob1(void) { simRun(1); }
+static void simJob2(void) { simRun(2); }
+
+static const job_run_t simJob[SIM_JOBS] = {simJob0, simJob1, simJob2};
+
+/**
+ * @brief Run jobs like runJobs() in main.cpp: wake up at jobNextWake() until end
+ *
+ * @param name name of the case
+ * @param jobs number of jobs
+ * @param setup period, tolerance and start time of each job
+ * @param end last wakeup in ms
+ * @param wakeups expected number of wakeups
+ * @param runs expected number of job runs
+ */
+static void checkJobs(const char *name, uint8_t jobs, const uint32_t setup[][3], uint32_t end, uint32_t wakeups, uint32_t runs)
+{
+	job_scheduler_t sched;
+	jobInit(&sched);
+	for (uint8_t idx = 0; idx < jobs; idx++)
+	{
+		simPeriod[idx] = setup[idx][0];
+		simTolerance[idx] = setup[idx][1];
+		simDue[idx] = setup[idx][2] + setup[idx][0];
+		simRuns[idx] = 0;
+		simLate[idx] = 0;
+		jobAdd(&sched, simJob[idx], setup[idx][0], setup[idx][1], setup[idx][2]);
+	}
+	uint32_t loops = 0;
+	while ((int32_t)(jobNextWake(&sched) - end) <= 0)
+	{
+		simNow = jobNextWake(&sched);
+		expect("jobScheduler", name, 1, jobRunDue(&sched, simNow) != 0);
+		loops++;
+	}
+	char what[64];
+	uint32_t total = 0;
+	for (uint8_t idx = 0; idx < jobs; idx++)
+	{
+		snprintf(what, sizeof(what), "%s, runs of job %d outside its window", name, idx);
+		expect("jobScheduler", what, 0, simLate[idx]);
+		total += simRuns[idx];
+	}
+	snprintf(what, sizeof(what), "%s, wakeups", name);
+	expect("jobScheduler", what, wakeups, sched.wakeups);
+	expect("jobScheduler", what, wakeups, loops);
+	snprintf(what, sizeof(what), "%s, job runs", name);
+	expect("jobScheduler", what, runs, total);
+	expect("jobScheduler", what, runs, sched.runs);
+	snprintf(what, sizeof(what), "%s, wakeups saved", name);
+	expect("jobScheduler", what, runs - wakeups, jobWakeupsSaved(&sched));
+}
+
+/**
+ * @brief Job scheduler: overlapping jobs share a wakeup, each runs inside its window
+ */
+static void checkJobScheduler(void)
+{
+	// Periods that are multiples of each other: all runs fall on the 1s wakeups
+	static const uint32_t multiple[][3] = {{1000, 100, 0}, {2000, 500, 0}, {4000, 0, 0}};
+	checkJobs("multiple periods", 3, multiple, 8000, 8, 14);
+
+	// Second job 200ms later, inside the tolerance of the first: both run at x.2s
+	static const uint32_t shifted[][3] = {{1000, 300, 0}, {1000, 300, 200}};
+	checkJobs("shifted", 2, shifted, 10000, 9, 18);
+
+	// Windows do not overlap, no coalescing
+	static const uint32_t apart[][3] = {{1000, 100, 0}, {1000, 100, 500}};
+	checkJobs("apart", 2, apart, 10000, 19, 19);
+
+	// No tolerance, the jobs only share a wakeup when they are due at the same time
+	static const uint32_t exact[][3] = {{1000, 0, 0}, {1500, 0, 0}};
+	checkJobs("exact", 2, exact, 6000, 8, 10);
+
+	// Different periods and tolerances drifting against each other, 60 + 46 + 16 runs
+	static const uint32_t mixed[][3] = {{1000, 250, 0}, {1300, 400, 0}, {3700, 1000, 100}};
+	checkJobs("mixed", 3, mixed, 60000, 74, 122);
+
+	// A job that was not served in time runs once and continues with the next period
+	job_scheduler_t sched;
+	jobInit(&sched);
+	simPeriod[0] = 1000;
+	simTolerance[0] = 5000;
+	simDue[0] = 1000;
+	simRuns[0] = 0;
+	jobAdd(&sched, simJob0, 1000, 5000, 0);
+	simNow = 3500;
+	expect("jobScheduler", "late job, jobs ran", 1, jobRunDue(&sched, simNow));
+	expect("jobScheduler", "late job, next wakeup", 4000, jobNextWake(&sched));
+}
+
+/**
+ * @brief Clock drift: which references are used for the network time
+ */
+static void checkClockDrift(void)
+{
+	clock_drift_t clock;
+	driftInit(&clock, 1000);
+	// Network time 500000ms ahead, local clock 20ppm fast
+	expect("clockDrift", "first reference", DRIFT_ACCEPTED, driftUpdate(&clock, 2000, 502000));
+	expect("clockDrift", "reference after 10s", DRIFT_ACCEPTED, driftUpdate(&clock, 12000, 512000));
+	expect("clockDrift", "reference 5s off after 10s", DRIFT_REJECTED, driftUpdate(&clock, 12000, 517000));
+	expect("clockDrift", "reference from the past", DRIFT_REJECTED, driftUpdate(&clock, 12000, 492000));
+	expect("clockDrift", "reference after 100s", DRIFT_MEASURED, driftUpdate(&clock, 102002, 602000));
+	expect("clockDrift", "drift after 100s", 20000, clock.drift);
+	expect("clockDrift", "reference 50s off after 100s", DRIFT_REJECTED, driftUpdate(&clock, 202004, 752000));
+	// The rejected reference starts the next measurement, a clock that continues from it is accepted
+	expect("clockDrift", "reference after the rejected one", DRIFT_ACCEPTED, driftUpdate(&clock, 212004, 762000));
+	expect("clockDrift", "measurement after the rejected one", DRIFT_MEASURED, driftUpdate(&clock, 302006, 852000));
+	expect("clockDrift", "measurements", 2, clock.measurements);
+}
+
+int main(void)
+{
+	checkBatteryPolicy();
+	checkJobScheduler();
+	checkClockDrift();
+	if (failed != 0)
+	{
+		printf("%d checks failed\n", failed);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,342 @@
+/**
+ * @file lifetime.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Predict the battery lifetime of the node for a radio configuration
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build:
+ *   g++ -O2 -o lifetime lifetime.cpp ../../PlatformIO/LoRa-DeepSleep/lib/energyModel/energyModel.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/lib/batteryPolicy/batteryPolicy.cpp
+ *       -I../common -I../../PlatformIO/LoRa-DeepSleep/lib/energyModel -I../../PlatformIO/LoRa-DeepSleep/lib/batteryPolicy
+ *       -I../../PlatformIO/LoRa-DeepSleep/lib/nodePayload
+ *
+ * Usage:
+ *   lifetime [key=value ...]
+ *   Radio:   freq=923300000 power=22 bw=0 sf=7 cr=1 preamble=8 payload=18
+ *   Timing:  sleep=10000 txonly=0 rx=2 rxsleep=10 (ms) cad=8 awake=10 (ms) neighbours=0
+ *   Battery: capacity=2000 (mAh) selfdischarge=3 (%/month) temp=20 (C) usable=85 (%) policy=0
+ *   lifetime validate   compares the model with the measurements in the README
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batteryPolicy.h"
+#include "energyModel.h"
+#include "nodeSim.h"
+
+/** Battery settings */
+typedef struct
+{
+	/** Capacity in mAh */
+	double capacity;
+	/** Self discharge in % per month at 20C */
+	double selfDischarge;
+	/** Temperature in C */
+	double temperature;
+	/** Part of the capacity that can be used before the cut-off voltage in % */
+	double usable;
+	/** Apply the battery policy of the firmware while discharging */
+	bool policy;
+} battery_t;
+
+/** Neighbour nodes sending on the same channel, heard in RX duty cycle mode */
+static uint32_t neighbours = 0;
+
+/**
+ * @brief Capacity left at a temperature, LiPo loses about 1% per degree below 20C
+ */
+static double temperatureDerating(double temperature)
+{
+	double factor = 1.0;
+	if (temperature < 20.0)
+	{
+		factor -= (20.0 - temperature) * 0.01;
+	}
+	return factor < 0.3 ? 0.3 : factor;
+}
+
+/**
+ * @brief Self discharge as equivalent current in uA, doubles every 10C above 20C
+ */
+static double selfDischargeCurrent(const battery_t *battery)
+{
+	double perMonth = battery->capacity * 1000.0 * battery->selfDischarge / 100.0;
+	return perMonth / 730.0 * pow(2.0, (battery->temperature - 20.0) / 10.0);
+}
+
+/**
+ * @brief Open circuit voltage of a LiPo cell for a state of charge
+ *
+ * @param soc state of charge 0..1
+ * @return uint16_t voltage in mV
+ */
+static uint16_t lipoVoltage(double soc)
+{
+	static const double socTable[] = {0.0, 0.05, 0.1, 0.2, 0.4, 0.6, 0.8, 1.0};
+	static const double mvTable[] = {3000, 3300, 3500, 3620, 3730, 3830, 3980, 4200};
+	for (int idx = 1; idx < 8; idx++)
+	{
+		if (soc <= socTable[idx])
+		{
+			return (uint16_t)(mvTable[idx - 1] + (mvTable[idx] - mvTable[idx - 1]) * (soc - socTable[idx - 1]) / (socTable[idx] - socTable[idx - 1]));
+		}
+	}
+	return 4200;
+}
+
+/**
+ * @brief Account one hour of operation: wake cycles plus packets of neighbours heard in RX mode
+ */
+static void simulateHour(const node_config_t *config, energy_model_t *model)
+{
+	const uint32_t hour = 3600 * 1000;
+	for (uint32_t time = 0; time < hour; time += config->sleepTime)
+	{
+		nodeSimCycle(config, model, config->sleepTime);
+	}
+	if (!config->txOnly && (neighbours != 0))
+	{
+		// A detected preamble keeps the radio in RX for the whole package and wakes the MCU
+		uint32_t packets = neighbours * (hour / config->sleepTime);
+		uint32_t rxRatio = (uint32_t)(1000ULL * nodeListenTime(config, config->sleepTime) / config->sleepTime);
+		uint32_t heard = packets * rxRatio / 1000;
+		uint32_t airtime = (nodeTimeOnAir(config, config->payloadSize) + 500) / 1000;
+		energyAccount(model, ENERGY_RADIO_RX, heard * airtime);
+		energyAccount(model, ENERGY_MCU, heard * config->awakeTime);
+	}
+}
+
+/**
+ * @brief Average current of a configuration in uA
+ */
+static double averageCurrent(const node_config_t *config, energy_model_t *model)
+{
+	energyInit(model);
+	simulateHour(config, model);
+	return (double)energyTotalCharge(model) / (3600.0 * 1000.0);
+}
+
+/**
+ * @brief Print the breakdown where the charge goes
+ */
+static void printBreakdown(const energy_model_t *model, double hours)
+{
+	uint64_t total = energyTotalCharge(model);
+	printf("Consumer    average uA    share\n");
+	for (uint8_t consumer = 0; consumer < ENERGY_NUM; consumer++)
+	{
+		if (model->charge[consumer] == 0)
+		{
+			continue;
+		}
+		printf("%-10s %11.1f  %6.1f%%\n", energyName(consumer),
+			   model->charge[consumer] / (hours * 3600.0 * 1000.0),
+			   100.0 * model->charge[consumer] / total);
+	}
+}
+
+/**
+ * @brief Discharge the battery hour by hour. With policy the settings follow the battery level like in the firmware.
+ *
+ * @return double lifetime in hours
+ */
+static double predict(node_config_t config, const battery_t *battery, energy_model_t *total)
+{
+	double usable = battery->capacity * 1000.0 * temperatureDerating(battery->temperature) * battery->usable / 100.0; // uAh
+	double used = 0.0;
+	double selfDischarge = selfDischargeCurrent(battery);
+	uint32_t baseSleep = config.sleepTime;
+	bool baseTxOnly = config.txOnly;
+	int8_t basePower = config.txPower;
+	uint8_t level = BATT_LEVEL_FULL;
+	double hours = 0.0;
+	energy_model_t hour;
+
+	energyInit(total);
+	while (used < usable)
+	{
+		if (battery->policy)
+		{
+			double soc = 1.0 - used / (battery->capacity * 1000.0 * temperatureDerating(battery->temperature));
+			level = battLevel(lipoVoltage(soc), level);
+			config.sleepTime = baseSleep * battPolicy[level].sleepMultiplier;
+			config.txPower = battPolicy[level].txPower < basePower ? battPolicy[level].txPower : basePower;
+			config.txOnly = baseTxOnly || !battPolicy[level].rxDutyCycle;
+		}
+		energyInit(&hour);
+		simulateHour(&config, &hour);
+		for (uint8_t consumer = 0; consumer < ENERGY_NUM; consumer++)
+		{
+			total->time[consumer] += hour.time[consumer];
+			total->charge[consumer] += hour.charge[consumer];
+		}
+		used += energyTotalCharge(&hour) / 3600000.0 + selfDischarge;
+		hours += 1.0;
+		if (hours > 20.0 * 8760.0)
+		{
+			break;
+		}
+	}
+	return hours;
+}
+
+/** duty_cycle_rx_time and duty_cycle_sleep_time in lora.cpp when the README currents were measured */
+#define MEASURED_DUTY_CYCLE_RX (2 * 1024 * 1000 * 15.625)
+#define MEASURED_DUTY_CYCLE_SLEEP (10 * 1024 * 1000 * 15.625)
+/** Allowed difference between model and measurement in % */
+#define VALIDATE_TOLERANCE 20.0
+
+/**
+ * @brief Compare the model with the currents measured in the README.
+ * The RX measurement was taken with the old duty cycle times, which lost their upper bits
+ * in the 24 bit registers of the SX126x, so the model gets the same truncated times.
+ *
+ * @return int 0 if the model is inside VALIDATE_TOLERANCE of the measurement, 1 if not
+ */
+static int validate(void)
+{
+	energy_model_t model;
+	node_config_t config = nodeDefaultConfig();
+
+	config.txOnly = true;
+	averageCurrent(&config, &model);
+	printf("TX only, sleep current: %luuA, measured value used as model input\n", (unsigned long)model.current[ENERGY_SLEEP]);
+	printf("TX only, average incl. TX: model %.0fuA\n", averageCurrent(&config, &model));
+
+	config.txOnly = false;
+	config.rxTime = nodeDutyCycleTime((uint32_t)MEASURED_DUTY_CYCLE_RX);
+	config.rxSleepTime = nodeDutyCycleTime((uint32_t)MEASURED_DUTY_CYCLE_SLEEP);
+	neighbours = 4;
+	double rx = averageCurrent(&config, &model);
+	double error = 100.0 * (rx - 6000.0) / 6000.0;
+	printf("RX duty cycle %lums / %lums, 4 neighbours: measured 6000uA, model %.0fuA (%+.0f%%)\n",
+		   (unsigned long)config.rxTime, (unsigned long)config.rxSleepTime, rx, error);
+	printBreakdown(&model, 1.0);
+	if (fabs(error) > VALIDATE_TOLERANCE)
+	{
+		printf("Model is more than %.0f%% off the measurement\n", VALIDATE_TOLERANCE);
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	node_config_t config = nodeDefaultConfig();
+	battery_t battery = {2000.0, 3.0, 20.0, 85.0, false};
+
+	for (int arg = 1; arg < argc; arg++)
+	{
+		if (strcmp(argv[arg], "validate") == 0)
+		{
+			return validate();
+		}
+		char key[32];
+		double value;
+		if (sscanf(argv[arg], "%31[^=]=%lf", key, &value) != 2)
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[arg]);
+			return 1;
+		}
+		if (strcmp(key, "freq") == 0)
+		{
+			config.frequency = (uint32_t)value;
+		}
+		else if (strcmp(key, "power") == 0)
+		{
+			config.txPower = (int8_t)value;
+		}
+		else if (strcmp(key, "bw") == 0)
+		{
+			config.bandwidth = (uint8_t)value;
+		}
+		else if (strcmp(key, "sf") == 0)
+		{
+			config.spreadingFactor = (uint8_t)value;
+		}
+		else if (strcmp(key, "cr") == 0)
+		{
+			config.codingRate = (uint8_t)value;
+		}
+		else if (strcmp(key, "preamble") == 0)
+		{
+			config.preambleLength = (uint16_t)value;
+		}
+		else if (strcmp(key, "payload") == 0)
+		{
+			config.payloadSize = (uint8_t)value;
+		}
+		else if (strcmp(key, "sleep") == 0)
+		{
+			config.sleepTime = (uint32_t)value;
+		}
+		else if (strcmp(key, "txonly") == 0)
+		{
+			config.txOnly = value != 0;
+		}
+		else if (strcmp(key, "rx") == 0)
+		{
+			config.rxTime = (uint32_t)value;
+		}
+		else if (strcmp(key, "rxsleep") == 0)
+		{
+			config.rxSleepTime = (uint32_t)value;
+		}
+		else if (strcmp(key, "cad") == 0)
+		{
+			config.cadSymbols = (uint8_t)value;
+		}
+		else if (strcmp(key, "awake") == 0)
+		{
+			config.awakeTime = (uint32_t)value;
+		}
+		else if (strcmp(key, "neighbours") == 0)
+		{
+			neighbours = (uint32_t)value;
+		}
+		else if (strcmp(key, "capacity") == 0)
+		{
+			battery.capacity = value;
+		}
+		else if (strcmp(key, "selfdischarge") == 0)
+		{
+			battery.selfDischarge = value;
+		}
+		else if (strcmp(key, "temp") == 0)
+		{
+			battery.temperature = value;
+		}
+		else if (strcmp(key, "usable") == 0)
+		{
+			battery.usable = value;
+		}
+		else if (strcmp(key, "policy") == 0)
+		{
+			battery.policy = value != 0;
+		}
+		else
+		{
+			fprintf(stderr, "Unknown key %s\n", key);
+			return 1;
+		}
+	}
+
+	energy_model_t model;
+	double hours = predict(config, &battery, &model);
+
+	printf("SF%d BW%lukHz CR4/%d preamble %d payload %dB %ddBm, send every %lus, %s\n",
+		   config.spreadingFactor, (unsigned long)(nodeBandwidthHz(config.bandwidth) / 1000), config.codingRate + 4,
+		   config.preambleLength, config.payloadSize, config.txPower, (unsigned long)(config.sleepTime / 1000),
+		   config.txOnly ? "TX only" : "RX duty cycle");
+	printf("Time on air %luus, CAD %luus\n", (unsigned long)nodeTimeOnAir(&config, config.payloadSize), (unsigned long)nodeCadTime(&config));
+	printf("Battery %.0fmAh at %.0fC, self discharge %.1fuA%s\n", battery.capacity, battery.temperature,
+		   selfDischargeCurrent(&battery), battery.policy ? ", battery policy on" : "");
+	printf("Average current %.1fuA\n", (double)energyTotalCharge(&model) / (hours * 3600.0 * 1000.0));
+	printf("Predicted lifetime %.0f days (%.1f years)\n\n", hours / 24.0, hours / 8760.0);
+	printBreakdown(&model, hours);
+	return 0;
+}
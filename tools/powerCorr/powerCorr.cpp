@@ -0,0 +1,550 @@
+/**
+ * @file powerCorr.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Align a current capture of a power analyser with the wake cycle trace and attribute the charge to the firmware phases
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build:
+ *   g++ -O2 -o powerCorr powerCorr.cpp ../../PlatformIO/LoRa-DeepSleep/lib/energyModel/energyModel.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/lib/wakeTrace/wakeTrace.cpp
+ *       -I../common -I../../PlatformIO/LoRa-DeepSleep/lib/energyModel -I../../PlatformIO/LoRa-DeepSleep/lib/wakeTrace
+ *       -I../../PlatformIO/LoRa-DeepSleep/lib/wakeProfile
+ *
+ * Usage:
+ *   powerCorr current.csv log.txt [key=value ...]
+ *   current.csv has one "time,current" line per sample, header lines are skipped.
+ *   log.txt is the log of a firmware built with -DWAKE_TRACE, captured at the same time.
+ *   With -DWAKE_PROFILE as well the trace has the profiler phases and the charge is attributed to them,
+ *   otherwise to the spans between the trace points of the loop task.
+ *   time=s|ms|us unit of the time column (s), current=A|mA|uA unit of the current column (A)
+ *   threshold=50 (mA) current that marks a TX, power=22 (dBm) TX power for the model column
+ *   offset=<us> skip the automatic alignment, capture time = trace time + offset
+ *   The current with the state of each sample is written to powerCorr.csv.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "energyModel.h"
+#include "traceLog.h"
+#include "wakeProfile.h"
+#include "wakeTrace.h"
+
+// Firmware states a sample is attributed to, the radio states win over the profiler phases,
+// the phases over the spans of the loop task
+#define STATE_UNTRACED 0
+#define STATE_SLEEP 1
+#define STATE_DISPATCH 2
+#define STATE_LOOP 3
+#define STATE_SEND 4
+#define STATE_SENSOR 5
+#define STATE_ENCODE 6
+#define STATE_CAD_SETUP 7
+#define STATE_TX_SETUP 8
+#define STATE_CALLBACK 9
+#define STATE_LOG 10
+#define STATE_CAD 11
+#define STATE_TX 12
+#define STATE_NUM 13
+
+static const char *stateName[STATE_NUM] = {"untraced", "sleep", "dispatch", "loop", "send", "sensor", "encode",
+										   "CAD setup", "TX setup", "callback", "log", "CAD", "TX"};
+
+/** State of each PROFILE_xxx phase */
+static const uint8_t phaseState[PROFILE_PHASES] = {STATE_DISPATCH, STATE_SENSOR, STATE_ENCODE, STATE_CAD_SETUP,
+												   STATE_TX_SETUP, STATE_CALLBACK, STATE_LOG};
+
+/** A TX spike in the capture is matched with a TX start of the trace if they are this close after alignment */
+#define MATCH_WINDOW_US 20000.0
+
+/** One sample of the capture */
+typedef struct
+{
+	/** Time in us */
+	double time;
+	/** Current in uA */
+	double current;
+} sample_t;
+
+/** Time slice of the trace with one state */
+typedef struct
+{
+	double start;
+	double end;
+	uint8_t state;
+} slice_t;
+
+/** Alignment of the trace to the capture: capture time = offset + scale * trace time */
+typedef struct
+{
+	double offset;
+	double scale;
+	uint32_t matched;
+	/** RMS of the remaining error of the matched spikes in us */
+	double residual;
+} alignment_t;
+
+/**
+ * @brief Scale factor of a unit name
+ */
+static double unitFactor(const char *unit, const char *base, double baseFactor)
+{
+	if (strcmp(unit, base) == 0)
+	{
+		return baseFactor;
+	}
+	if ((unit[0] == 'm') && (strcmp(unit + 1, base) == 0))
+	{
+		return baseFactor / 1e3;
+	}
+	if ((unit[0] == 'u') && (strcmp(unit + 1, base) == 0))
+	{
+		return baseFactor / 1e6;
+	}
+	if ((unit[0] == 'n') && (strcmp(unit + 1, base) == 0))
+	{
+		return baseFactor / 1e9;
+	}
+	fprintf(stderr, "Unknown unit %s\n", unit);
+	exit(1);
+}
+
+/**
+ * @brief Read the "time,current" lines of the capture, converted to us and uA
+ */
+static std::vector<sample_t> readCapture(const char *fileName, double timeFactor, double currentFactor)
+{
+	std::vector<sample_t> samples;
+	FILE *file = fopen(fileName, "r");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Cannot open %s\n", fileName);
+		exit(1);
+	}
+	char line[256];
+	while (fgets(line, sizeof(line), file))
+	{
+		double time;
+		double current;
+		if (sscanf(line, "%lf%*[,; \t]%lf", &time, &current) == 2)
+		{
+			sample_t sample = {time * timeFactor, current * currentFactor};
+			samples.push_back(sample);
+		}
+	}
+	fclose(file);
+	return samples;
+}
+
+/**
+ * @brief Start times of the TX spikes, rising edges through the threshold
+ */
+static std::vector<double> findSpikes(const std::vector<sample_t> &samples, double threshold)
+{
+	std::vector<double> spikes;
+	for (size_t idx = 1; idx < samples.size(); idx++)
+	{
+		if ((samples[idx - 1].current < threshold) && (samples[idx].current >= threshold))
+		{
+			spikes.push_back(samples[idx].time);
+		}
+	}
+	return spikes;
+}
+
+/**
+ * @brief Nearest spike to a time, spikes are sorted
+ */
+static double nearestSpike(const std::vector<double> &spikes, double time)
+{
+	size_t low = 0;
+	size_t high = spikes.size();
+	while (low < high)
+	{
+		size_t mid = (low + high) / 2;
+		if (spikes[mid] < time)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	double best = 1e30;
+	if (low < spikes.size())
+	{
+		best = spikes[low];
+	}
+	if ((low > 0) && (time - spikes[low - 1] < best - time))
+	{
+		best = spikes[low - 1];
+	}
+	return best;
+}
+
+/**
+ * @brief Fit the alignment from the matched pairs of TX start and spike
+ */
+static alignment_t fitAlignment(const std::vector<double> &txStarts, const std::vector<double> &spikes, double offset, double scale)
+{
+	alignment_t fit = {offset, scale, 0, 0.0};
+	double sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumXY = 0.0;
+	std::vector<double> x;
+	std::vector<double> y;
+	for (size_t idx = 0; idx < txStarts.size(); idx++)
+	{
+		double predicted = offset + scale * txStarts[idx];
+		double spike = nearestSpike(spikes, predicted);
+		if (fabs(spike - predicted) < MATCH_WINDOW_US)
+		{
+			x.push_back(txStarts[idx]);
+			y.push_back(spike);
+			sumX += txStarts[idx];
+			sumY += spike;
+			sumXX += txStarts[idx] * txStarts[idx];
+			sumXY += txStarts[idx] * spike;
+		}
+	}
+	fit.matched = x.size();
+	if (fit.matched == 0)
+	{
+		return fit;
+	}
+	double n = fit.matched;
+	double denominator = n * sumXX - sumX * sumX;
+	// The clock of the node and the analyser differ a bit, fit the scale only if the spikes span some time
+	if ((fit.matched >= 3) && (denominator > 1e-9 * n * sumXX))
+	{
+		fit.scale = (n * sumXY - sumX * sumY) / denominator;
+		if (fabs(fit.scale - 1.0) > 0.01)
+		{
+			fit.scale = 1.0;
+		}
+	}
+	fit.offset = (sumY - fit.scale * sumX) / n;
+	double error = 0.0;
+	for (size_t idx = 0; idx < x.size(); idx++)
+	{
+		double delta = y[idx] - (fit.offset + fit.scale * x[idx]);
+		error += delta * delta;
+	}
+	fit.residual = sqrt(error / n);
+	return fit;
+}
+
+/**
+ * @brief Find the alignment that matches the most TX starts with a spike.
+ * Every pair of one of the first TX starts and a spike is tried as anchor.
+ */
+static alignment_t align(const std::vector<double> &txStarts, const std::vector<double> &spikes)
+{
+	alignment_t best = {0.0, 1.0, 0, 0.0};
+	size_t anchors = txStarts.size() < 8 ? txStarts.size() : 8;
+	for (size_t tx = 0; tx < anchors; tx++)
+	{
+		for (size_t spike = 0; spike < spikes.size(); spike++)
+		{
+			alignment_t fit = fitAlignment(txStarts, spikes, spikes[spike] - txStarts[tx], 1.0);
+			if ((fit.matched > best.matched) || ((fit.matched == best.matched) && (fit.residual < best.residual)))
+			{
+				best = fit;
+			}
+		}
+	}
+	// Refine with the fitted clock scale
+	if (best.matched != 0)
+	{
+		best = fitAlignment(txStarts, spikes, best.offset, best.scale);
+	}
+	return best;
+}
+
+/**
+ * @brief Cut the trace into slices with one state each.
+ * The running profiler phase is the innermost one, a phase only ends if it is the running one, like in the profiler.
+ */
+static std::vector<slice_t> traceSlices(const std::vector<timed_record_t> &timed)
+{
+	std::vector<slice_t> slices;
+	std::vector<uint8_t> phases;
+	bool dispatch = false;
+	bool loop = false;
+	bool send = false;
+	bool cad = false;
+	bool tx = false;
+
+	for (size_t idx = 0; idx + 1 < timed.size(); idx++)
+	{
+		switch (timed[idx].record.event)
+		{
+		case TRACE_TIMER_WAKEUP:
+			dispatch = true;
+			break;
+		case TRACE_LOOP_WAKE:
+			dispatch = false;
+			loop = true;
+			break;
+		case TRACE_LOOP_SLEEP:
+			loop = false;
+			send = false;
+			break;
+		case TRACE_SEND_START:
+			send = true;
+			break;
+		case TRACE_CAD_START:
+			send = false;
+			cad = true;
+			break;
+		case TRACE_PHASE_ENTER:
+			if (timed[idx].record.arg < PROFILE_PHASES)
+			{
+				phases.push_back(timed[idx].record.arg);
+			}
+			break;
+		case TRACE_PHASE_EXIT:
+			if (!phases.empty() && (phases.back() == timed[idx].record.arg))
+			{
+				phases.pop_back();
+			}
+			break;
+		case TRACE_CAD_DONE:
+			cad = false;
+			break;
+		case TRACE_TX_START:
+			tx = true;
+			break;
+		case TRACE_TX_DONE:
+		case TRACE_TX_TIMEOUT:
+			tx = false;
+			break;
+		default:
+			break;
+		}
+		slice_t slice = {timed[idx].time, timed[idx + 1].time, STATE_SLEEP};
+		if (tx)
+		{
+			slice.state = STATE_TX;
+		}
+		else if (cad)
+		{
+			slice.state = STATE_CAD;
+		}
+		else if (!phases.empty())
+		{
+			slice.state = phaseState[phases.back()];
+		}
+		else if (send)
+		{
+			slice.state = STATE_SEND;
+		}
+		else if (loop)
+		{
+			slice.state = STATE_LOOP;
+		}
+		else if (dispatch)
+		{
+			slice.state = STATE_DISPATCH;
+		}
+		if (slice.end > slice.start)
+		{
+			slices.push_back(slice);
+		}
+	}
+	return slices;
+}
+
+/**
+ * @brief Current the energy model expects in a state in uA, 0 if the state has no single consumer
+ */
+static double modelCurrent(uint8_t state, const energy_model_t *model, int8_t txPower)
+{
+	switch (state)
+	{
+	case STATE_SLEEP:
+		return model->current[ENERGY_SLEEP];
+	case STATE_DISPATCH:
+	case STATE_LOOP:
+	case STATE_SEND:
+	case STATE_SENSOR:
+	case STATE_ENCODE:
+	case STATE_CAD_SETUP:
+	case STATE_TX_SETUP:
+	case STATE_CALLBACK:
+	case STATE_LOG:
+		return model->current[ENERGY_SLEEP] + model->current[ENERGY_MCU];
+	case STATE_CAD:
+		return model->current[ENERGY_SLEEP] + model->current[ENERGY_RADIO_CAD];
+	case STATE_TX:
+		return model->current[ENERGY_SLEEP] + energyTxCurrent(txPower);
+	default:
+		return 0.0;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "Usage: powerCorr current.csv log.txt [time=s] [current=A] [threshold=50] [power=22] [offset=us]\n");
+		return 1;
+	}
+	double timeFactor = 1e6;
+	double currentFactor = 1e6;
+	double threshold = 50000.0;
+	int8_t txPower = 22;
+	bool fixedOffset = false;
+	double offset = 0.0;
+
+	for (int arg = 3; arg < argc; arg++)
+	{
+		char key[32];
+		char value[32];
+		if (sscanf(argv[arg], "%31[^=]=%31s", key, value) != 2)
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[arg]);
+			return 1;
+		}
+		if (strcmp(key, "time") == 0)
+		{
+			timeFactor = unitFactor(value, "s", 1e6);
+		}
+		else if (strcmp(key, "current") == 0)
+		{
+			currentFactor = unitFactor(value, "A", 1e6);
+		}
+		else if (strcmp(key, "threshold") == 0)
+		{
+			threshold = atof(value) * 1000.0;
+		}
+		else if (strcmp(key, "power") == 0)
+		{
+			txPower = (int8_t)atoi(value);
+		}
+		else if (strcmp(key, "offset") == 0)
+		{
+			fixedOffset = true;
+			offset = atof(value);
+		}
+		else
+		{
+			fprintf(stderr, "Unknown key %s\n", key);
+			return 1;
+		}
+	}
+
+	std::vector<sample_t> samples = readCapture(argv[1], timeFactor, currentFactor);
+	FILE *log = fopen(argv[2], "r");
+	if (log == NULL)
+	{
+		fprintf(stderr, "Cannot open %s\n", argv[2]);
+		return 1;
+	}
+	std::vector<timed_record_t> timed = traceReconstructTime(traceReadLog(log));
+	fclose(log);
+	if ((samples.size() < 2) || (timed.size() < 2))
+	{
+		fprintf(stderr, "Capture has %u samples, trace %u records, need at least 2 of each\n", (unsigned)samples.size(), (unsigned)timed.size());
+		return 1;
+	}
+
+	std::vector<double> txStarts;
+	for (size_t idx = 0; idx < timed.size(); idx++)
+	{
+		if (timed[idx].record.event == TRACE_TX_START)
+		{
+			txStarts.push_back(timed[idx].time);
+		}
+	}
+	std::vector<double> spikes = findSpikes(samples, threshold);
+
+	alignment_t alignment = {offset, 1.0, 0, 0.0};
+	if (fixedOffset)
+	{
+		alignment = fitAlignment(txStarts, spikes, offset, 1.0);
+		alignment.offset = offset;
+		alignment.scale = 1.0;
+	}
+	else
+	{
+		alignment = align(txStarts, spikes);
+		if (alignment.matched == 0)
+		{
+			fprintf(stderr, "No TX spike above %.0fmA matches a TX start of the trace (%u spikes, %u TX starts), try threshold= or offset=\n",
+					threshold / 1000.0, (unsigned)spikes.size(), (unsigned)txStarts.size());
+			return 1;
+		}
+	}
+	printf("Capture %u samples, %.3fs, %u TX spikes; trace %u records, %u TX starts\n",
+		   (unsigned)samples.size(), (samples.back().time - samples.front().time) / 1e6, (unsigned)spikes.size(),
+		   (unsigned)timed.size(), (unsigned)txStarts.size());
+	printf("Alignment: offset %.0fus, clock scale %.6f, %u TX matched, residual %.0fus\n\n",
+		   alignment.offset, alignment.scale, alignment.matched, alignment.residual);
+
+	// Walk the samples and the slices together, each sample holds until the next one
+	std::vector<slice_t> slices = traceSlices(timed);
+	double charge[STATE_NUM] = {0};
+	double time[STATE_NUM] = {0};
+	FILE *csv = fopen("powerCorr.csv", "w");
+	if (csv != NULL)
+	{
+		fprintf(csv, "time_us,trace_us,current_ua,state\n");
+	}
+	size_t slice = 0;
+	for (size_t idx = 0; idx + 1 < samples.size(); idx++)
+	{
+		double traceTime = (samples[idx].time - alignment.offset) / alignment.scale;
+		while ((slice < slices.size()) && (slices[slice].end <= traceTime))
+		{
+			slice++;
+		}
+		uint8_t state = STATE_UNTRACED;
+		if ((slice < slices.size()) && (slices[slice].start <= traceTime))
+		{
+			state = slices[slice].state;
+		}
+		double duration = samples[idx + 1].time - samples[idx].time;
+		time[state] += duration;
+		charge[state] += samples[idx].current * duration;
+		if (csv != NULL)
+		{
+			fprintf(csv, "%.1f,%.1f,%.1f,%s\n", samples[idx].time, traceTime, samples[idx].current, stateName[state]);
+		}
+	}
+	if (csv != NULL)
+	{
+		fclose(csv);
+	}
+
+	energy_model_t model;
+	energyInit(&model);
+	double totalCharge = 0.0;
+	double totalTime = 0.0;
+	for (uint8_t state = STATE_SLEEP; state < STATE_NUM; state++)
+	{
+		totalCharge += charge[state];
+		totalTime += time[state];
+	}
+	printf("State        time ms   charge uC    share   average uA    model uA\n");
+	for (uint8_t state = STATE_SLEEP; state < STATE_NUM; state++)
+	{
+		if (time[state] == 0.0)
+		{
+			continue;
+		}
+		printf("%-10s %9.1f %11.1f   %5.1f%%  %11.0f %11.0f\n", stateName[state], time[state] / 1000.0, charge[state] / 1e6,
+			   totalCharge > 0.0 ? 100.0 * charge[state] / totalCharge : 0.0, charge[state] / time[state], modelCurrent(state, &model, txPower));
+	}
+	printf("%-10s %9.1f %11.1f           %11.0f\n", "traced", totalTime / 1000.0, totalCharge / 1e6, totalTime > 0.0 ? totalCharge / totalTime : 0.0);
+	if (time[STATE_UNTRACED] > 0.0)
+	{
+		printf("%-10s %9.1f %11.1f           %11.0f\n", stateName[STATE_UNTRACED], time[STATE_UNTRACED] / 1000.0,
+			   charge[STATE_UNTRACED] / 1e6, charge[STATE_UNTRACED] / time[STATE_UNTRACED]);
+	}
+	return 0;
+}
@@ -0,0 +1,166 @@
+/**
+ * @file Arduino.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host version of the Arduino core, FreeRTOS and nRF52 registers used by the firmware, running in virtual time
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef ARDUINO_REPLAY_H
+#define ARDUINO_REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Log output of the firmware goes into the replay log
+int hostPrintf(const char *format, ...);
+#define PRINTF hostPrintf
+
+// WisBlock RAK4631 pins
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define RISING 3
+#define LED_BUILTIN 35
+#define LED_CONN 36
+#define LED_GREEN 35
+#define LED_BLUE 36
+#define WB_A0 5
+#define PIN_VBAT WB_A0
+#define AR_INTERNAL_3_0 3
+
+uint32_t millis(void);
+uint32_t micros(void);
+void delay(uint32_t ms);
+void pinMode(uint32_t pin, uint32_t mode);
+void digitalWrite(uint32_t pin, uint32_t value);
+int digitalRead(uint32_t pin);
+void attachInterrupt(uint32_t pin, void (*callback)(void), uint32_t mode);
+void detachInterrupt(uint32_t pin);
+uint32_t analogRead(uint32_t pin);
+void analogReference(uint8_t reference);
+void analogReadResolution(uint8_t bits);
+void analogOversampling(uint32_t samples);
+
+class Uart
+{
+public:
+	void begin(uint32_t baud);
+	void end(void);
+	void flush(void);
+	operator bool(void);
+};
+extern Uart Serial;
+
+// FreeRTOS
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+typedef struct host_semaphore_s *SemaphoreHandle_t;
+typedef struct host_task_s *TaskHandle_t;
+typedef struct host_timer_s *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t timer);
+
+/** Mutex */
+struct host_semaphore_s
+{
+	bool given;
+};
+typedef struct host_semaphore_s StaticSemaphore_t;
+
+/** The loop task, the only task that waits for notifications */
+struct host_task_s
+{
+	uint32_t notifiedValue;
+	bool notified;
+};
+
+typedef enum
+{
+	eSetBits
+} eNotifyAction;
+
+/** Software timer, fired by the replay in virtual time */
+struct host_timer_s
+{
+	TimerCallbackFunction_t callback;
+	/** Period in ticks */
+	TickType_t period;
+	bool autoReload;
+	bool active;
+	/** Virtual time of the next expiry in us */
+	uint64_t due;
+};
+typedef struct host_timer_s StaticTimer_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define configTICK_RATE_HZ 1024
+#define pdMS_TO_TICKS(ms) ((TickType_t)((uint64_t)(ms) * configTICK_RATE_HZ / 1000))
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t timeout);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t *value, TickType_t timeout);
+TickType_t xTaskGetTickCount(void);
+TickType_t xTaskGetTickCountFromISR(void);
+TimerHandle_t xTimerCreateStatic(const char *name, TickType_t period, UBaseType_t autoReload, void *timerID,
+								TimerCallbackFunction_t callback, StaticTimer_t *buffer);
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t block);
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t block);
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t block);
+void taskENTER_CRITICAL(void);
+void taskEXIT_CRITICAL(void);
+
+
+// nRF52 and Cortex-M4 registers
+typedef struct
+{
+	volatile uint32_t USBREGSTATUS;
+} NRF_POWER_Type;
+typedef struct
+{
+	volatile uint32_t ENABLE;
+} NRF_USBD_Type;
+typedef struct
+{
+	volatile uint32_t TASKS_HFCLKSTOP;
+	volatile uint32_t HFCLKSTAT;
+} NRF_CLOCK_Type;
+typedef struct
+{
+	volatile uint32_t CTRL;
+	/** Counts 64 cycles per virtual us */
+	volatile uint32_t CYCCNT;
+} DWT_Type;
+typedef struct
+{
+	volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+extern NRF_POWER_Type *NRF_POWER;
+extern NRF_USBD_Type *NRF_USBD;
+extern NRF_CLOCK_Type *NRF_CLOCK;
+extern DWT_Type *DWT;
+extern CoreDebug_Type *CoreDebug;
+
+#define POWER_USBREGSTATUS_VBUSDETECT_Msk 1
+#define CLOCK_HFCLKSTAT_SRC_Msk 1
+#define DWT_CTRL_CYCCNTENA_Msk 1
+#define CoreDebug_DEMCR_TRCENA_Msk (1 << 24)
+
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+void __disable_irq(void);
+
+#endif
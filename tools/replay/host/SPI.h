@@ -0,0 +1,22 @@
+/**
+ * @file SPI.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host version of the SPI library, power up and down only
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef SPI_REPLAY_H
+#define SPI_REPLAY_H
+
+class SPIClass
+{
+public:
+	void begin(void) {}
+	void end(void) {}
+};
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * @file SX126x-RAK4630.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host version of the SX126x-Arduino radio API, records the calls and the radio state
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef SX126X_REPLAY_H
+#define SX126X_REPLAY_H
+
+#include <stdint.h>
+
+typedef enum
+{
+	MODEM_FSK = 0,
+	MODEM_LORA,
+} RadioModems_t;
+
+#define LORA_CAD_01_SYMBOL 0
+#define LORA_CAD_02_SYMBOL 1
+#define LORA_CAD_04_SYMBOL 2
+#define LORA_CAD_08_SYMBOL 3
+#define LORA_CAD_16_SYMBOL 4
+#define LORA_CAD_ONLY 0
+#define LORA_CAD_RX 1
+
+typedef struct
+{
+	void (*TxDone)(void);
+	void (*TxTimeout)(void);
+	void (*RxDone)(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr);
+	void (*RxTimeout)(void);
+	void (*RxError)(void);
+	void (*FhssChangeChannel)(uint8_t currentChannel);
+	void (*CadDone)(bool channelActivityDetected);
+} RadioEvents_t;
+
+struct Radio_s
+{
+	void (*Init)(RadioEvents_t *events);
+	void (*Standby)(void);
+	void (*Sleep)(void);
+	void (*SetChannel)(uint32_t freq);
+	void (*SetTxConfig)(RadioModems_t modem, int8_t power, uint32_t fdev, uint32_t bandwidth, uint32_t datarate,
+						uint8_t coderate, uint16_t preambleLen, bool fixLen, bool crcOn, bool freqHopOn,
+						uint8_t hopPeriod, bool iqInverted, uint32_t timeout);
+	void (*SetRxConfig)(RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+						uint32_t bandwidthAfc, uint16_t preambleLen, uint16_t symbTimeout, bool fixLen,
+						uint8_t payloadLen, bool crcOn, bool freqHopOn, uint8_t hopPeriod, bool iqInverted, bool rxContinuous);
+	void (*SetRxDutyCycle)(uint32_t rxTime, uint32_t sleepTime);
+	void (*SetCadParams)(uint8_t cadSymbolNum, uint8_t cadDetPeak, uint8_t cadDetMin, uint8_t cadExitMode, uint32_t cadTimeout);
+	void (*StartCad)(void);
+	void (*Send)(uint8_t *buffer, uint8_t size);
+	void (*Rx)(uint32_t timeout);
+	uint32_t (*TimeOnAir)(RadioModems_t modem, uint8_t pktLen);
+};
+
+extern const struct Radio_s Radio;
+
+uint32_t lora_rak4630_init(void);
+
+#endif
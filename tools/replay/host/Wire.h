@@ -0,0 +1,22 @@
+/**
+ * @file Wire.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host version of the Wire library, power up and down only
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef WIRE_REPLAY_H
+#define WIRE_REPLAY_H
+
+class TwoWire
+{
+public:
+	void begin(void) {}
+	void end(void) {}
+};
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,487 @@
+/**
+ * @file host.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Host version of the Arduino core, FreeRTOS and the radio. Time only moves when the replay
+ * or a delay() moves it, so a replay gives the same result on every run.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "host.h"
+
+#include <stdarg.h>
+
+#include "SPI.h"
+#include "Wire.h"
+
+#define HOST_TIMER_NUM 8
+
+/** Loop task of the firmware */
+void loop(void);
+
+uint64_t hostTime = 0;
+uint16_t hostAdcValue = 0;
+uint32_t hostTakes = 0;
+TimerCallbackFunction_t hostReplayedTimer = NULL;
+
+uint8_t hostRadioState = HOST_RADIO_SLEEP;
+RadioEvents_t *hostRadioEvents = NULL;
+host_radio_calls_t hostRadioCalls;
+uint8_t hostRadioSendSize = 0;
+const host_radio_sim_t *hostRadioSim = NULL;
+
+/** Pending CAD or TX end of the simulated radio, UINT64_MAX if none */
+static uint64_t hostRadioDue = UINT64_MAX;
+static bool hostRadioCadBusy = false;
+
+static FILE *hostLog = NULL;
+static struct host_task_s hostLoopTask;
+static TimerHandle_t hostTimers[HOST_TIMER_NUM];
+static uint8_t hostTimerNum = 0;
+
+Uart Serial;
+SPIClass SPI;
+TwoWire Wire;
+
+static NRF_POWER_Type hostPower;
+static NRF_USBD_Type hostUsbd;
+static NRF_CLOCK_Type hostClock;
+static DWT_Type hostDwt;
+static CoreDebug_Type hostCoreDebug;
+NRF_POWER_Type *NRF_POWER = &hostPower;
+NRF_USBD_Type *NRF_USBD = &hostUsbd;
+NRF_CLOCK_Type *NRF_CLOCK = &hostClock;
+DWT_Type *DWT = &hostDwt;
+CoreDebug_Type *CoreDebug = &hostCoreDebug;
+
+/**
+ * @brief Reset the host environment
+ *
+ * @param log file for the log output of the firmware, can be NULL
+ */
+void hostInit(FILE *log)
+{
+	hostLog = log;
+	hostTime = 0;
+	hostTakes = 0;
+	hostTimerNum = 0;
+	hostLoopTask.notifiedValue = 0;
+	hostLoopTask.notified = false;
+	hostRadioState = HOST_RADIO_SLEEP;
+	hostRadioEvents = NULL;
+	hostRadioDue = UINT64_MAX;
+	memset(&hostRadioCalls, 0, sizeof(hostRadioCalls));
+}
+
+/**
+ * @brief Timer period in virtual time
+ */
+static uint64_t hostTicksToUs(TickType_t ticks)
+{
+	return (uint64_t)ticks * 1000000 / configTICK_RATE_HZ;
+}
+
+/**
+ * @brief Move the virtual time, the timers that expire on the way are fired
+ *
+ * @param until virtual time in us
+ */
+void hostAdvance(uint64_t until)
+{
+	while (true)
+	{
+		TimerHandle_t next = NULL;
+		for (uint8_t idx = 0; idx < hostTimerNum; idx++)
+		{
+			TimerHandle_t timer = hostTimers[idx];
+			if (timer->active && (timer->callback != hostReplayedTimer) && (timer->due <= until) && ((next == NULL) || (timer->due < next->due)))
+			{
+				next = timer;
+			}
+		}
+		uint64_t due = next != NULL ? next->due : UINT64_MAX;
+		bool radio = (hostRadioDue <= until) && (hostRadioDue < due);
+		if (radio)
+		{
+			due = hostRadioDue;
+		}
+		if (due == UINT64_MAX)
+		{
+			break;
+		}
+		if (due > hostTime)
+		{
+			DWT->CYCCNT += (uint32_t)((due - hostTime) * 64);
+			hostTime = due;
+		}
+		if (radio)
+		{
+			// The radio callbacks run in their own task, they can interrupt a delay() of the loop task
+			hostRadioDue = UINT64_MAX;
+			if (hostRadioState == HOST_RADIO_CAD)
+			{
+				hostRadioEvents->CadDone(hostRadioCadBusy);
+			}
+			else if (hostRadioState == HOST_RADIO_TX)
+			{
+				hostRadioEvents->TxDone();
+			}
+			continue;
+		}
+		next->due += hostTicksToUs(next->period);
+		next->active = next->autoReload;
+		next->callback(next);
+	}
+	if (until > hostTime)
+	{
+		DWT->CYCCNT += (uint32_t)((until - hostTime) * 64);
+		hostTime = until;
+	}
+}
+
+/**
+ * @brief Virtual time of the next timer or simulated radio event that hostAdvance() fires
+ *
+ * @return uint64_t time in us, UINT64_MAX if no timer runs
+ */
+uint64_t hostNextTimer(void)
+{
+	uint64_t next = UINT64_MAX;
+	for (uint8_t idx = 0; idx < hostTimerNum; idx++)
+	{
+		TimerHandle_t timer = hostTimers[idx];
+		if (timer->active && (timer->callback != hostReplayedTimer) && (timer->due < next))
+		{
+			next = timer->due;
+		}
+	}
+	return hostRadioDue < next ? hostRadioDue : next;
+}
+
+/**
+ * @brief Run the loop task until it waits for the next event
+ */
+void hostRunLoop(void)
+{
+	uint32_t takes;
+	do
+	{
+		takes = hostTakes;
+		loop();
+	} while (hostTakes != takes);
+}
+
+/**
+ * @brief Fire the timer with a callback now, used for the recorded timer wakeups
+ *
+ * @return true if the timer was running
+ */
+bool hostFireTimer(TimerCallbackFunction_t callback)
+{
+	for (uint8_t idx = 0; idx < hostTimerNum; idx++)
+	{
+		TimerHandle_t timer = hostTimers[idx];
+		if (timer->callback == callback)
+		{
+			bool active = timer->active;
+			timer->due = hostTime + hostTicksToUs(timer->period);
+			timer->active = timer->autoReload && active;
+			callback(timer);
+			return active;
+		}
+	}
+	return false;
+}
+
+const char *hostRadioStateName(uint8_t state)
+{
+	static const char *name[] = {"sleep", "standby", "RX duty cycle", "RX", "CAD", "TX"};
+	return state <= HOST_RADIO_TX ? name[state] : "?";
+}
+
+int hostPrintf(const char *format, ...)
+{
+	if (hostLog == NULL)
+	{
+		return 0;
+	}
+	va_list args;
+	va_start(args, format);
+	int length = vfprintf(hostLog, format, args);
+	va_end(args);
+	return length;
+}
+
+// Arduino core
+
+uint32_t millis(void)
+{
+	return (uint32_t)(hostTime / 1000);
+}
+
+uint32_t micros(void)
+{
+	return (uint32_t)hostTime;
+}
+
+void delay(uint32_t ms)
+{
+	hostAdvance(hostTime + (uint64_t)ms * 1000);
+}
+
+void pinMode(uint32_t, uint32_t) {}
+void digitalWrite(uint32_t, uint32_t) {}
+void attachInterrupt(uint32_t, void (*)(void), uint32_t) {}
+void detachInterrupt(uint32_t) {}
+int digitalRead(uint32_t) { return LOW; }
+uint32_t analogRead(uint32_t) { return hostAdcValue; }
+void analogReference(uint8_t) {}
+void analogReadResolution(uint8_t) {}
+void analogOversampling(uint32_t) {}
+
+void Uart::begin(uint32_t) {}
+void Uart::end(void) {}
+void Uart::flush(void) {}
+Uart::operator bool(void) { return true; }
+
+// FreeRTOS
+
+/**
+ * @brief A mutex is created available
+ */
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+	buffer->given = true;
+	return buffer;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+	if (semaphore->given)
+	{
+		return pdFALSE;
+	}
+	semaphore->given = true;
+	return pdTRUE;
+}
+
+/**
+ * @brief Nothing else runs while the firmware waits, so a timeout just moves the virtual time.
+ * Waiting forever returns at once, the replay gives the next event.
+ */
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t timeout)
+{
+	if (!semaphore->given && (timeout != portMAX_DELAY))
+	{
+		delay((uint32_t)((uint64_t)timeout * 1000 / configTICK_RATE_HZ));
+	}
+	if (!semaphore->given)
+	{
+		return pdFALSE;
+	}
+	semaphore->given = false;
+	return pdTRUE;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+	return &hostLoopTask;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction)
+{
+	task->notifiedValue |= value;
+	task->notified = true;
+	return pdTRUE;
+}
+
+/**
+ * @brief Wait of the loop task, like xSemaphoreTake() a timeout moves the virtual time
+ * and waiting forever returns at once
+ */
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t *value, TickType_t timeout)
+{
+	if (!hostLoopTask.notified)
+	{
+		hostLoopTask.notifiedValue &= ~clearOnEntry;
+		if (timeout != portMAX_DELAY)
+		{
+			delay((uint32_t)((uint64_t)timeout * 1000 / configTICK_RATE_HZ));
+		}
+	}
+	if (!hostLoopTask.notified)
+	{
+		return pdFALSE;
+	}
+	if (value != NULL)
+	{
+		*value = hostLoopTask.notifiedValue;
+	}
+	hostLoopTask.notifiedValue &= ~clearOnExit;
+	hostLoopTask.notified = false;
+	hostTakes++;
+	return pdTRUE;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	return (TickType_t)(hostTime * configTICK_RATE_HZ / 1000000);
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+	return xTaskGetTickCount();
+}
+
+void taskENTER_CRITICAL(void) {}
+void taskEXIT_CRITICAL(void) {}
+
+TimerHandle_t xTimerCreateStatic(const char *, TickType_t period, UBaseType_t autoReload, void *,
+								TimerCallbackFunction_t callback, StaticTimer_t *buffer)
+{
+	buffer->callback = callback;
+	buffer->period = period;
+	buffer->autoReload = autoReload != pdFALSE;
+	buffer->active = false;
+	buffer->due = 0;
+	if (hostTimerNum < HOST_TIMER_NUM)
+	{
+		hostTimers[hostTimerNum++] = buffer;
+	}
+	return buffer;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t)
+{
+	timer->active = true;
+	timer->due = hostTime + hostTicksToUs(timer->period);
+	return pdTRUE;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t)
+{
+	timer->active = false;
+	return pdTRUE;
+}
+
+/**
+ * @brief Like on the node this also starts the timer
+ */
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t block)
+{
+	timer->period = period;
+	return xTimerStart(timer, block);
+}
+
+// Cortex-M4
+
+static uint32_t hostPrimask = 0;
+
+uint32_t __get_PRIMASK(void)
+{
+	return hostPrimask;
+}
+
+void __set_PRIMASK(uint32_t primask)
+{
+	hostPrimask = primask;
+}
+
+void __disable_irq(void)
+{
+	hostPrimask = 1;
+}
+
+// Radio
+
+static void radioInit(RadioEvents_t *events)
+{
+	hostRadioEvents = events;
+}
+
+static void radioStandby(void)
+{
+	hostRadioDue = UINT64_MAX;
+	hostRadioState = HOST_RADIO_STANDBY;
+}
+
+static void radioSleep(void)
+{
+	hostRadioCalls.sleep++;
+	hostRadioDue = UINT64_MAX;
+	hostRadioState = HOST_RADIO_SLEEP;
+}
+
+static void radioSetChannel(uint32_t) {}
+
+static void radioSetTxConfig(RadioModems_t, int8_t, uint32_t, uint32_t, uint32_t,
+							 uint8_t, uint16_t, bool, bool, bool,
+							 uint8_t, bool, uint32_t)
+{
+	hostRadioCalls.txConfig++;
+}
+
+static void radioSetRxConfig(RadioModems_t, uint32_t, uint32_t, uint8_t,
+							 uint32_t, uint16_t, uint16_t, bool,
+							 uint8_t, bool, bool, uint8_t, bool, bool)
+{
+}
+
+static void radioSetRxDutyCycle(uint32_t, uint32_t)
+{
+	hostRadioCalls.rxDutyCycle++;
+	hostRadioDue = UINT64_MAX;
+	hostRadioState = HOST_RADIO_RX_DUTY_CYCLE;
+}
+
+static void radioSetCadParams(uint8_t, uint8_t, uint8_t, uint8_t, uint32_t) {}
+
+static void radioStartCad(void)
+{
+	hostRadioCalls.cad++;
+	hostRadioState = HOST_RADIO_CAD;
+	if (hostRadioSim != NULL)
+	{
+		hostRadioDue = hostTime + hostRadioSim->cadTime();
+		hostRadioCadBusy = hostRadioSim->cadBusy();
+	}
+}
+
+static void radioSend(uint8_t *, uint8_t size)
+{
+	hostRadioCalls.send++;
+	hostRadioSendSize = size;
+	hostRadioState = HOST_RADIO_TX;
+	if (hostRadioSim != NULL)
+	{
+		hostRadioDue = hostTime + hostRadioSim->txTime(size);
+	}
+}
+
+static void radioRx(uint32_t)
+{
+	hostRadioCalls.rx++;
+	hostRadioDue = UINT64_MAX;
+	hostRadioState = HOST_RADIO_RX;
+}
+
+/**
+ * @brief Time on air in ms from the simulated radio, 0 without
+ */
+static uint32_t radioTimeOnAir(RadioModems_t, uint8_t pktLen)
+{
+	return hostRadioSim != NULL ? hostRadioSim->txTime(pktLen) / 1000 : 0;
+}
+
+const struct Radio_s Radio = {
+	radioInit, radioStandby, radioSleep, radioSetChannel, radioSetTxConfig, radioSetRxConfig,
+	radioSetRxDutyCycle, radioSetCadParams, radioStartCad, radioSend, radioRx, radioTimeOnAir};
+
+void RadioOnDioIrq(void) {}
+
+uint32_t lora_rak4630_init(void)
+{
+	return 0;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file host.h
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Control of the host environment the firmware runs in during a replay
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HOST_H
+#define HOST_H
+
+#include "Arduino.h"
+#include "SX126x-RAK4630.h"
+
+// State of the radio after the last call of the firmware
+#define HOST_RADIO_SLEEP 0
+#define HOST_RADIO_STANDBY 1
+#define HOST_RADIO_RX_DUTY_CYCLE 2
+#define HOST_RADIO_RX 3
+#define HOST_RADIO_CAD 4
+#define HOST_RADIO_TX 5
+
+/** Number of radio calls of the firmware */
+typedef struct
+{
+	uint32_t sleep;
+	uint32_t rxDutyCycle;
+	uint32_t rx;
+	uint32_t cad;
+	uint32_t send;
+	uint32_t txConfig;
+} host_radio_calls_t;
+
+/** Simulated radio. If set, the host radio finishes CAD and TX by itself after the given times */
+typedef struct
+{
+	/** CAD duration in us */
+	uint32_t (*cadTime)(void);
+	/** CAD result */
+	bool (*cadBusy)(void);
+	/** Time on air of a package in us */
+	uint32_t (*txTime)(uint8_t size);
+} host_radio_sim_t;
+
+/** Virtual time in us */
+extern uint64_t hostTime;
+/** Value analogRead() returns */
+extern uint16_t hostAdcValue;
+/** Number of times the loop task got a notification */
+extern uint32_t hostTakes;
+/** Timer that is not fired by the virtual time but by the replay */
+extern TimerCallbackFunction_t hostReplayedTimer;
+
+extern uint8_t hostRadioState;
+extern RadioEvents_t *hostRadioEvents;
+extern host_radio_calls_t hostRadioCalls;
+/** Size of the last package given to Radio.Send() */
+extern uint8_t hostRadioSendSize;
+extern const host_radio_sim_t *hostRadioSim;
+
+void hostInit(FILE *log);
+void hostAdvance(uint64_t until);
+uint64_t hostNextTimer(void);
+void hostRunLoop(void);
+bool hostFireTimer(TimerCallbackFunction_t callback);
+const char *hostRadioStateName(uint8_t state);
+
+#endif
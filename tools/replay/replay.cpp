@@ -0,0 +1,396 @@
+/**
+ * @file replay.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Replay the timer wakeups and radio events of a recorded wake cycle trace through the firmware in virtual time
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build (use the same -D options as the firmware that recorded the trace):
+ *   g++ -O2 -DWAKE_TRACE -DMYLOG_LOG_LEVEL=4 -o replay replay.cpp host/host.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/src/[a-z]*.cpp $(find ../../PlatformIO/LoRa-DeepSleep/lib -name "*.cpp")
+ *       -Ihost -I../common -I../../PlatformIO/LoRa-DeepSleep/src
+ *       $(find ../../PlatformIO/LoRa-DeepSleep/lib -mindepth 1 -type d -printf "-I%p ")
+ *
+ * Usage:
+ *   replay log.txt [log=replay.log]
+ *   log.txt is the log of a firmware built with -DWAKE_TRACE. The timer wakeups, radio callbacks
+ *   and battery readings of the trace are fed into setup() / loop() and the radio callbacks of the
+ *   firmware, all other trace points are compared with the ones the firmware writes during the replay.
+ *   Received packages are rebuilt from the kind recorded in their TRACE_RX_FRAME point.
+ *   The firmware log of the replay, with its own trace, is written to replay.log.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "host.h"
+#include "main.h"
+#include "traceLog.h"
+
+// Entry point of the firmware
+void setup(void);
+/** Timer callback of the firmware that sends the packages */
+void periodicWakeup(TimerHandle_t unused);
+
+/** Number of injected events and of events that did not fit the state of the firmware */
+static uint32_t injected[TRACE_EVENT_NUM];
+static uint32_t divergent[TRACE_EVENT_NUM];
+
+/**
+ * @brief True for the trace points that come from outside the firmware
+ */
+static bool isInput(uint8_t event)
+{
+	switch (event)
+	{
+	case TRACE_TIMER_WAKEUP:
+	case TRACE_CAD_DONE:
+	case TRACE_TX_DONE:
+	case TRACE_TX_TIMEOUT:
+	case TRACE_RX_DONE:
+	case TRACE_RX_TIMEOUT:
+	case TRACE_RX_ERROR:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ * @brief Check that the radio is in a state where the event can happen
+ */
+static bool radioExpects(uint8_t event)
+{
+	switch (event)
+	{
+	case TRACE_CAD_DONE:
+		return hostRadioState == HOST_RADIO_CAD;
+	case TRACE_TX_DONE:
+	case TRACE_TX_TIMEOUT:
+		return hostRadioState == HOST_RADIO_TX;
+	case TRACE_RX_DONE:
+	case TRACE_RX_TIMEOUT:
+	case TRACE_RX_ERROR:
+		return (hostRadioState == HOST_RADIO_RX_DUTY_CYCLE) || (hostRadioState == HOST_RADIO_RX);
+	default:
+		return true;
+	}
+}
+
+/**
+ * @brief Build a package the firmware handles like the recorded one. The content is not recorded,
+ * only what the node did with it (TRACE_RX_FRAME). The commands of a batch become one command with
+ * the same number of bytes for the loop task. A time reference carries the time of the replay,
+ * as if the sender had no drift against the node.
+ *
+ * @param frame TRACE_RX_FRAME record of the package, NULL if the trace has none
+ * @param payload output, 256 bytes
+ */
+static void rebuildPayload(const trace_record_t *frame, uint8_t *payload)
+{
+	memset(payload, 0, 256);
+	if (frame == NULL)
+	{
+		return;
+	}
+	uint8_t loopBytes = (uint8_t)(frame->data & 0xFF);
+	uint8_t timeFrame = (uint8_t)(frame->data >> 8);
+	switch (frame->arg)
+	{
+	case TRACE_FRAME_TIME:
+		timeFrameEncode(timeFrame, millis(), payload);
+		break;
+	case TRACE_FRAME_BATCH:
+	{
+		uint8_t size = batchStart(DEVICE_ID, payload);
+		if (timeFrame != 0)
+		{
+			uint8_t reference[TIME_FRAME_SIZE];
+			timeFrameEncode(timeFrame, millis(), reference);
+			size = batchAdd(payload, size, reference, TIME_FRAME_SIZE);
+		}
+		if (loopBytes > 1)
+		{
+			uint8_t command[256] = {0};
+			batchAdd(payload, size, command, loopBytes - 1);
+		}
+		break;
+	}
+	case TRACE_FRAME_OTHER_BATCH:
+		batchStart(DEVICE_ID + 1, payload);
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * @brief Feed one recorded event into the firmware
+ */
+static void inject(const trace_record_t *record, uint8_t *payload)
+{
+	injected[record->event]++;
+	bool expected = radioExpects(record->event);
+	switch (record->event)
+	{
+	case TRACE_TIMER_WAKEUP:
+		expected = hostFireTimer(periodicWakeup);
+		break;
+	case TRACE_CAD_DONE:
+		hostRadioEvents->CadDone(record->arg != 0);
+		break;
+	case TRACE_TX_DONE:
+		hostRadioEvents->TxDone();
+		break;
+	case TRACE_TX_TIMEOUT:
+		hostRadioEvents->TxTimeout();
+		break;
+	case TRACE_RX_DONE:
+		hostRadioEvents->RxDone(payload, record->data & 0xFF, -(int16_t)(record->data >> 8), (int8_t)record->arg);
+		break;
+	case TRACE_RX_TIMEOUT:
+		hostRadioEvents->RxTimeout();
+		break;
+	case TRACE_RX_ERROR:
+		hostRadioEvents->RxError();
+		break;
+	}
+	if (!expected)
+	{
+		divergent[record->event]++;
+	}
+	hostRunLoop();
+}
+
+/**
+ * @brief True for the trace points of the loop task. The radio callbacks run in their own task and
+ * can preempt the loop task on the node, but not in the replay, so both are compared separately.
+ */
+static bool isLoopTask(uint8_t event)
+{
+	switch (event)
+	{
+	case TRACE_TIMER_WAKEUP:
+	case TRACE_LOOP_WAKE:
+	case TRACE_LOOP_SLEEP:
+	case TRACE_SEND_START:
+	case TRACE_CAD_START:
+	case TRACE_BATTERY:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ * @brief True for the profiler phase points. They are written by the timer, radio and loop task
+ * and their order depends on the preemption on the node, so they are not compared.
+ */
+static bool isPhase(uint8_t event)
+{
+	return (event == TRACE_PHASE_ENTER) || (event == TRACE_PHASE_EXIT);
+}
+
+/**
+ * @brief Compare the recorded and replayed trace points of one task
+ *
+ * @return true if they match
+ */
+static bool compareStream(const char *name, const std::vector<trace_record_t> &recorded, const std::vector<trace_record_t> &replayed)
+{
+	size_t compared = recorded.size() < replayed.size() ? recorded.size() : replayed.size();
+	for (size_t idx = 0; idx < compared; idx++)
+	{
+		const trace_record_t *a = &recorded[idx];
+		const trace_record_t *b = &replayed[idx];
+		if ((a->event != b->event) || (a->arg != b->arg) || (a->data != b->data))
+		{
+			printf("%s trace differs at point %u: recorded %s arg %u data %u, replayed %s arg %u data %u\n", name, (unsigned)idx,
+				   traceEventName(a->event), a->arg, a->data, traceEventName(b->event), b->arg, b->data);
+			return false;
+		}
+	}
+	printf("%s trace matches the recording in all %u points\n", name, (unsigned)compared);
+	return true;
+}
+
+/**
+ * @brief Records from the first timer wakeup on, so a log that starts in the middle of a cycle works
+ */
+static std::vector<timed_record_t> fromFirstWakeup(const std::vector<timed_record_t> &timed)
+{
+	size_t first = 0;
+	while ((first < timed.size()) && (timed[first].record.event != TRACE_TIMER_WAKEUP))
+	{
+		first++;
+	}
+	return std::vector<timed_record_t>(timed.begin() + first, timed.end());
+}
+
+/**
+ * @brief FNV-1a hash, a fingerprint of the replay result
+ */
+static uint32_t fnv(uint32_t hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+	for (size_t idx = 0; idx < size; idx++)
+	{
+		hash = (hash ^ bytes[idx]) * 16777619;
+	}
+	return hash;
+}
+
+int main(int argc, char **argv)
+{
+	const char *logName = "replay.log";
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: replay log.txt [log=replay.log]\n");
+		return 1;
+	}
+	for (int arg = 2; arg < argc; arg++)
+	{
+		if (strncmp(argv[arg], "log=", 4) == 0)
+		{
+			logName = argv[arg] + 4;
+		}
+		else
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[arg]);
+			return 1;
+		}
+	}
+
+	FILE *file = fopen(argv[1], "r");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Cannot open %s\n", argv[1]);
+		return 1;
+	}
+	std::vector<timed_record_t> recorded = fromFirstWakeup(traceReconstructTime(traceReadLog(file)));
+	fclose(file);
+	if (recorded.empty())
+	{
+		fprintf(stderr, "No timer wakeup in the trace of %s\n", argv[1]);
+		return 1;
+	}
+
+	FILE *log = fopen(logName, "w");
+	if (log == NULL)
+	{
+		fprintf(stderr, "Cannot write %s\n", logName);
+		return 1;
+	}
+	hostInit(log);
+	hostReplayedTimer = periodicWakeup;
+	for (size_t idx = 0; idx < recorded.size(); idx++)
+	{
+		if (recorded[idx].record.event == TRACE_BATTERY)
+		{
+			hostAdcValue = recorded[idx].record.data;
+			break;
+		}
+	}
+	setup();
+
+	// The first timer wakeup happens at the first job wakeup, one period after the end of setup()
+	uint8_t payload[256];
+	uint64_t base = hostTime + (uint64_t)(int32_t)(jobNextWake(&jobs) - clockNow()) * 1000;
+	uint32_t late = 0;
+	for (size_t idx = 0; idx < recorded.size(); idx++)
+	{
+		const trace_record_t *record = &recorded[idx].record;
+		if (record->event == TRACE_TIMER_WAKEUP)
+		{
+			// The battery reading of this wake cycle
+			for (size_t next = idx + 1; (next < recorded.size()) && (recorded[next].record.event != TRACE_TIMER_WAKEUP); next++)
+			{
+				if (recorded[next].record.event == TRACE_BATTERY)
+				{
+					hostAdcValue = recorded[next].record.data;
+					break;
+				}
+			}
+		}
+		if (!isInput(record->event))
+		{
+			continue;
+		}
+		uint64_t time = base + (uint64_t)recorded[idx].time;
+		if (time < hostTime)
+		{
+			// The firmware took longer in virtual time (delays) than on the node
+			late++;
+		}
+		hostAdvance(time);
+		if (record->event == TRACE_RX_DONE)
+		{
+			// What the node did with the package follows the RX done trace point
+			const trace_record_t *frame = NULL;
+			for (size_t next = idx + 1; (next < recorded.size()) && !isInput(recorded[next].record.event); next++)
+			{
+				if (recorded[next].record.event == TRACE_RX_FRAME)
+				{
+					frame = &recorded[next].record;
+					break;
+				}
+			}
+			rebuildPayload(frame, payload);
+		}
+		inject(record, payload);
+	}
+	fclose(log);
+
+	// Compare the trace of the replay with the recording
+	log = fopen(logName, "r");
+	std::vector<timed_record_t> replayed = fromFirstWakeup(traceReconstructTime(traceReadLog(log)));
+	fclose(log);
+	std::vector<trace_record_t> recordedStream[2];
+	std::vector<trace_record_t> replayedStream[2];
+	for (size_t idx = 0; idx < recorded.size(); idx++)
+	{
+		if (!isPhase(recorded[idx].record.event))
+		{
+			recordedStream[isLoopTask(recorded[idx].record.event)].push_back(recorded[idx].record);
+		}
+	}
+	for (size_t idx = 0; idx < replayed.size(); idx++)
+	{
+		if (!isPhase(replayed[idx].record.event))
+		{
+			replayedStream[isLoopTask(replayed[idx].record.event)].push_back(replayed[idx].record);
+		}
+	}
+
+	printf("Replayed %.1fs, %u recorded trace points, %u replayed\n", hostTime / 1e6, (unsigned)recorded.size(), (unsigned)replayed.size());
+	printf("Event        injected  unexpected\n");
+	for (uint8_t event = 0; event < TRACE_EVENT_NUM; event++)
+	{
+		if (injected[event] != 0)
+		{
+			printf("%-12s %8u %11u\n", traceEventName(event), injected[event], divergent[event]);
+		}
+	}
+	printf("Radio calls: sleep %u, RX duty cycle %u, CAD %u, send %u, TX config %u; radio now %s\n",
+		   hostRadioCalls.sleep, hostRadioCalls.rxDutyCycle, hostRadioCalls.cad, hostRadioCalls.send,
+		   hostRadioCalls.txConfig, hostRadioStateName(hostRadioState));
+	if (late != 0)
+	{
+		printf("%u events arrived while the firmware was still busy in virtual time\n", late);
+	}
+	printf("Energy model: average %luuA over %lums\n", (unsigned long)energyAverageCurrent(&energy, millis()), (unsigned long)millis());
+
+	uint32_t hash = fnv(2166136261u, energy.charge, sizeof(energy.charge));
+	for (size_t idx = 0; idx < replayed.size(); idx++)
+	{
+		hash = fnv(hash, &replayed[idx].record, sizeof(trace_record_t));
+	}
+	printf("Fingerprint %08X\n", hash);
+
+	bool matches = compareStream("loop task", recordedStream[1], replayedStream[1]);
+	matches = compareStream("radio", recordedStream[0], replayedStream[0]) && matches;
+	return matches ? 0 : 1;
+}
@@ -0,0 +1,382 @@
+/**
+ * @file rxBench.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Maximum sustained frame rate of the receiver role before frames are dropped
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build:
+ *   g++ -O2 -o rxBench rxBench.cpp ../../PlatformIO/LoRa-DeepSleep/lib/rxRing/rxRing.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/lib/rxStream/rxStream.cpp
+ *       ../../PlatformIO/LoRa-DeepSleep/lib/energyModel/energyModel.cpp
+ *       -I../common -I../../PlatformIO/LoRa-DeepSleep/lib/rxRing -I../../PlatformIO/LoRa-DeepSleep/lib/rxStream
+ *       -I../../PlatformIO/LoRa-DeepSleep/lib/energyModel -I../../PlatformIO/LoRa-DeepSleep/lib/nodePayload
+ *
+ * Usage:
+ *   rxBench                        SF7 125kHz, payload sizes 1 to 255
+ *   sf=7 bw=0 cr=1 preamble=8      radio settings, same values as in lora.cpp
+ *   size=18                        only this payload size
+ *   slots=16                       ring slots (RX_RING_SLOTS)
+ *   usb=500 (kB/s)                 USB CDC throughput
+ *   spi=8 (MHz)                    SPI clock for reading the payload from the SX1262
+ *   irq=100 (us)                   DIO1 interrupt to callback latency (WAKE_PROFILE build shows the real one)
+ *   stall=0 (ms) every=1000 (ms)   the host stops reading the USB stream for stall ms every every ms
+ *   time=60 (s)                    simulated time per rate
+ *
+ * The CPU time of the callback (ring reserve, copy, commit) and of the stream encoding
+ * is measured with the firmware code and converted to Cortex-M4 cycles like tools/bench.
+ * The frames then arrive back to back at a fixed rate, the radio path and the receiver
+ * task are simulated with these times and the largest rate without a dropped frame is searched.
+ * A single SX1262 receives one frame at a time, so the rate can not be higher than 1 / time on air.
+ */
+#include <chrono>
+#include <deque>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nodeSim.h"
+#include "rxRing.h"
+#include "rxStream.h"
+
+/** Cycles of one iteration of the calibration loop on the Cortex-M4, see tools/bench */
+#define CALIBRATION_M4_CYCLES 5.0
+/** CPU clock of the nRF52840 */
+#define M4_MHZ 64.0
+/** Minimum run time of one measurement in ns */
+#define MEASURE_NS 20000000.0
+/** Number of measurements, the fastest one counts */
+#define MEASURE_REPEAT 5
+/** SPI command and status bytes around the payload read */
+#define SPI_OVERHEAD_BYTES 3
+
+typedef void (*bench_func_t)(uint32_t count);
+
+/** Settings of the simulation */
+typedef struct
+{
+	uint32_t slots;
+	double usbBytesPerUs;
+	double spiMHz;
+	double irqUs;
+	double stallUs;
+	double everyUs;
+	double timeUs;
+} bench_config_t;
+
+/** Times per frame in us */
+typedef struct
+{
+	/** Radio task: IRQ latency, SPI read, callback */
+	double radio;
+	/** Receiver task until the slot is released */
+	double encode;
+	/** Receiver task writing the message to USB */
+	double usb;
+} frame_cost_t;
+
+static rx_ring_t ring;
+static uint8_t payload[RX_FRAME_MAX];
+static uint8_t message[STREAM_ENCODED_MAX];
+static uint8_t benchSize = 18;
+
+/**
+ * @brief Keep the compiler from optimizing a result away
+ */
+static inline void keep(const void *value)
+{
+	asm volatile("" : : "g"(value) : "memory");
+}
+
+static void benchCalibration(uint32_t count)
+{
+	uint32_t value = 1;
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		value = value * 1103515245 + 12345;
+		asm volatile("" : "+r"(value));
+	}
+	keep(&value);
+}
+
+/**
+ * @brief Same work as receiverFrame() in the radio callback
+ */
+static void benchCallback(uint32_t count)
+{
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		rx_frame_t *frame = rxRingReserve(&ring);
+		frame->time = idx;
+		frame->rssi = -80;
+		frame->snr = 7;
+		frame->channel = 0;
+		frame->size = benchSize;
+		memcpy(frame->data, payload, benchSize);
+		rxRingCommit(&ring);
+		keep(frame);
+		// Keep the ring from filling up, the consumer side is measured separately
+		rxRingRelease(&ring);
+	}
+}
+
+/**
+ * @brief Same work as the receiver task before Serial.write()
+ */
+static void benchEncode(uint32_t count)
+{
+	rx_frame_t *frame = rxRingReserve(&ring);
+	frame->size = benchSize;
+	memcpy(frame->data, payload, benchSize);
+	rxRingCommit(&ring);
+	for (uint32_t idx = 0; idx < count; idx++)
+	{
+		const rx_frame_t *next = rxRingPeek(&ring);
+		uint16_t size = streamEncode(next, message);
+		keep(message);
+		keep(&size);
+	}
+	rxRingRelease(&ring);
+}
+
+static double measure(bench_func_t func)
+{
+	uint32_t count = 16;
+	double best = 1e30;
+	for (int run = 0; run < MEASURE_REPEAT;)
+	{
+		auto start = std::chrono::steady_clock::now();
+		func(count);
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		if (ns < MEASURE_NS)
+		{
+			count *= 2;
+			continue;
+		}
+		best = ns / count < best ? ns / count : best;
+		run++;
+	}
+	return best;
+}
+
+/**
+ * @brief Simulate frames arriving every interval us
+ *
+ * @param config simulation settings
+ * @param cost times per frame
+ * @param interval time between the ends of two frames in us
+ * @param peak returns the highest number of slots in use
+ * @return uint32_t number of dropped frames
+ */
+static uint32_t simulate(const bench_config_t *config, const frame_cost_t *cost, double interval, uint32_t *peak)
+{
+	// Release times of the frames waiting in the ring
+	std::deque<double> waiting;
+	double radioFree = 0;
+	double receiverFree = 0;
+	uint32_t dropped = 0;
+	*peak = 0;
+	for (double end = interval; end < config->timeUs; end += interval)
+	{
+		// Radio task: wakes up after the DIO1 interrupt, reads the payload and fills a slot
+		double start = end + config->irqUs > radioFree ? end + config->irqUs : radioFree;
+		double commit = start + cost->radio - config->irqUs;
+		radioFree = commit;
+
+		while (!waiting.empty() && waiting.front() <= commit)
+		{
+			waiting.pop_front();
+		}
+		if (waiting.size() >= config->slots)
+		{
+			dropped++;
+			continue;
+		}
+
+		// Receiver task: encodes the record, frees the slot and writes to USB
+		double begin = commit > receiverFree ? commit : receiverFree;
+		double release = begin + cost->encode;
+		double done = release + cost->usb;
+		if (config->stallUs > 0)
+		{
+			// The USB write waits while the host does not read
+			double phase = fmod(done, config->everyUs);
+			if (phase < config->stallUs)
+			{
+				done += config->stallUs - phase;
+			}
+		}
+		receiverFree = done;
+		waiting.push_back(release);
+		if (waiting.size() > *peak)
+		{
+			*peak = waiting.size();
+		}
+	}
+	return dropped;
+}
+
+/**
+ * @brief Benchmark one payload size and print a line of the table
+ */
+static void benchPayload(const node_config_t *radio, const bench_config_t *config, double usPerCycle, uint8_t size)
+{
+	benchSize = size;
+	double calibration = measure(benchCalibration);
+	double callbackCycles = measure(benchCallback) / calibration * CALIBRATION_M4_CYCLES;
+	double encodeCycles = measure(benchEncode) / calibration * CALIBRATION_M4_CYCLES;
+
+	frame_cost_t cost;
+	double spi = (size + SPI_OVERHEAD_BYTES) * 8.0 / config->spiMHz;
+	cost.radio = config->irqUs + spi + callbackCycles * usPerCycle;
+	cost.encode = encodeCycles * usPerCycle;
+	rx_frame_t frame;
+	frame.size = size;
+	memcpy(frame.data, payload, size);
+	cost.usb = streamEncode(&frame, message) / config->usbBytesPerUs;
+
+	double airtime = nodeTimeOnAir(radio, size);
+	double airFps = 1e6 / airtime;
+	double radioFps = 1e6 / cost.radio;
+	double receiverFps = 1e6 / (cost.encode + cost.usb);
+
+	// Largest rate without drops, the radio can not receive faster than one frame per time on air
+	uint32_t peak = 0;
+	double low = 0;
+	double high = airFps;
+	if (simulate(config, &cost, 1e6 / high, &peak) == 0)
+	{
+		low = high;
+	}
+	else
+	{
+		for (int step = 0; step < 30; step++)
+		{
+			double rate = (low + high) / 2;
+			if (simulate(config, &cost, 1e6 / rate, &peak) == 0)
+			{
+				low = rate;
+			}
+			else
+			{
+				high = rate;
+			}
+		}
+	}
+	if (low > 0)
+	{
+		simulate(config, &cost, 1e6 / low, &peak);
+	}
+	printf("%4d %9.2f %8.1f %9.0f %9.0f %8.0f %8.0f %9.1f %6lu\n", size, airtime / 1000.0, airFps,
+		   callbackCycles, encodeCycles, radioFps, receiverFps, low, (unsigned long)peak);
+}
+
+int main(int argc, char **argv)
+{
+	node_config_t radio = nodeDefaultConfig();
+	bench_config_t config = {RX_RING_SLOTS, 0.5, 8.0, 100.0, 0.0, 1e6, 60e6};
+	int size = -1;
+
+	for (int arg = 1; arg < argc; arg++)
+	{
+		char key[32];
+		double value;
+		if (sscanf(argv[arg], "%31[^=]=%lf", key, &value) != 2)
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[arg]);
+			return 1;
+		}
+		if (strcmp(key, "sf") == 0)
+		{
+			radio.spreadingFactor = (uint8_t)value;
+		}
+		else if (strcmp(key, "bw") == 0)
+		{
+			radio.bandwidth = (uint8_t)value;
+		}
+		else if (strcmp(key, "cr") == 0)
+		{
+			radio.codingRate = (uint8_t)value;
+		}
+		else if (strcmp(key, "preamble") == 0)
+		{
+			radio.preambleLength = (uint16_t)value;
+		}
+		else if (strcmp(key, "size") == 0)
+		{
+			size = (int)value;
+		}
+		else if (strcmp(key, "slots") == 0)
+		{
+			config.slots = (uint32_t)value;
+		}
+		else if (strcmp(key, "usb") == 0)
+		{
+			config.usbBytesPerUs = value / 1000.0;
+		}
+		else if (strcmp(key, "spi") == 0)
+		{
+			config.spiMHz = value;
+		}
+		else if (strcmp(key, "irq") == 0)
+		{
+			config.irqUs = value;
+		}
+		else if (strcmp(key, "stall") == 0)
+		{
+			config.stallUs = value * 1000.0;
+		}
+		else if (strcmp(key, "every") == 0)
+		{
+			config.everyUs = value * 1000.0;
+		}
+		else if (strcmp(key, "time") == 0)
+		{
+			config.timeUs = value * 1e6;
+		}
+		else
+		{
+			fprintf(stderr, "Unknown key %s\n", key);
+			return 1;
+		}
+	}
+	if ((size > RX_FRAME_MAX) || (config.slots == 0) || (config.usbBytesPerUs <= 0) || (config.spiMHz <= 0) || (config.everyUs <= 0) || (config.stallUs >= config.everyUs))
+	{
+		fprintf(stderr, "Invalid settings\n");
+		return 1;
+	}
+
+	for (int idx = 0; idx < RX_FRAME_MAX; idx++)
+	{
+		payload[idx] = (uint8_t)idx;
+	}
+	rxRingInit(&ring);
+
+	printf("SF%d BW%lukHz CR4/%d preamble %d, %lu ring slots, USB %.0fkB/s, SPI %.0fMHz, IRQ latency %.0fus",
+		   radio.spreadingFactor, (unsigned long)(nodeBandwidthHz(radio.bandwidth) / 1000), radio.codingRate + 4,
+		   radio.preambleLength, (unsigned long)config.slots, config.usbBytesPerUs * 1000.0, config.spiMHz, config.irqUs);
+	if (config.stallUs > 0)
+	{
+		printf(", host stalls %.0fms every %.0fms", config.stallUs / 1000.0, config.everyUs / 1000.0);
+	}
+	printf("\n\n");
+	printf("size airtime  air fps callback    stream  radio    recv      max   peak\n");
+	printf("        [ms]          [cycles]  [cycles]    fps     fps  no drop  slots\n");
+
+	double usPerCycle = 1.0 / M4_MHZ;
+	if (size >= 0)
+	{
+		benchPayload(&radio, &config, usPerCycle, (uint8_t)size);
+	}
+	else
+	{
+		static const uint8_t sizes[] = {1, 8, 18, 32, 64, 128, 255};
+		for (size_t idx = 0; idx < sizeof(sizes); idx++)
+		{
+			benchPayload(&radio, &config, usPerCycle, sizes[idx]);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file rxDump.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Print the frames of the receiver stream
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build:
+ *   g++ -O2 -o rxDump rxDump.cpp ../../PlatformIO/LoRa-DeepSleep/lib/rxStream/rxStream.cpp
+ *       -I../../PlatformIO/LoRa-DeepSleep/lib/rxStream -I../../PlatformIO/LoRa-DeepSleep/lib/rxRing
+ *
+ * Usage:
+ *   rxDump stream.bin              frames of a captured stream
+ *   rxDump /dev/ttyACM0            frames of a receiver, set the port to raw mode first: stty -F /dev/ttyACM0 raw
+ *   rxDump -                       frames from stdin
+ *
+ * One line per frame: sequence, time stamp in us, RSSI, SNR, channel, size and payload in hex.
+ * Gaps in the sequence are frames the receiver dropped. At the end the parser statistics are printed.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "rxStream.h"
+
+int main(int argc, char **argv)
+{
+	if (argc != 2)
+	{
+		fprintf(stderr, "Usage: rxDump <stream file, device or ->\n");
+		return 1;
+	}
+	FILE *input = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "rb");
+	if (input == NULL)
+	{
+		fprintf(stderr, "Cannot open %s\n", argv[1]);
+		return 1;
+	}
+
+	stream_parser_t parser;
+	streamParserInit(&parser);
+	rx_frame_t frame;
+	uint32_t lost = 0;
+	bool first = true;
+	uint16_t expected = 0;
+
+	uint8_t buffer[4096];
+	size_t length;
+	while ((length = fread(buffer, 1, sizeof(buffer), input)) > 0)
+	{
+		for (size_t idx = 0; idx < length; idx++)
+		{
+			if (!streamParse(&parser, buffer[idx], &frame))
+			{
+				continue;
+			}
+			if (!first)
+			{
+				lost += (uint16_t)(frame.sequence - expected);
+			}
+			first = false;
+			expected = frame.sequence + 1;
+
+			printf("%5u %10lu %4d dBm %3d dB ch %u %3u:", frame.sequence, (unsigned long)frame.time, frame.rssi,
+				   frame.snr, frame.channel, frame.size);
+			for (uint8_t byte = 0; byte < frame.size; byte++)
+			{
+				printf(" %02X", frame.data[byte]);
+			}
+			printf("\n");
+		}
+		fflush(stdout);
+	}
+	if (input != stdin)
+	{
+		fclose(input);
+	}
+	fprintf(stderr, "%lu frames, %lu dropped by the receiver, %lu broken messages, %lu overruns\n",
+			(unsigned long)parser.frames, (unsigned long)lost, (unsigned long)parser.errors, (unsigned long)parser.overruns);
+	return 0;
+}
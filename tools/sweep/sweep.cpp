@@ -0,0 +1,306 @@
+/**
+ * @file sweep.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Multi-threaded sweep over the radio settings, prints the Pareto front of energy, latency and delivery ratio
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build:
+ *   g++ -O2 -pthread -o sweep sweep.cpp ../../PlatformIO/LoRa-DeepSleep/lib/energyModel/energyModel.cpp
+ *       -I../common -I../../PlatformIO/LoRa-DeepSleep/lib/energyModel -I../../PlatformIO/LoRa-DeepSleep/lib/nodePayload
+ *
+ * Usage:
+ *   sweep [threads=N] [distance=2000 (m)] [exponent=2.7] [neighbours=4] [scaling]
+ *   The Pareto front is written to sweep.csv, "scaling" measures the speedup for 1..N threads.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "energyModel.h"
+#include "nodeSim.h"
+
+/** Values of each parameter that are swept */
+static const uint8_t sweepSf[] = {7, 8, 9, 10, 11, 12};
+static const uint8_t sweepBw[] = {0, 1, 2};
+static const uint8_t sweepCr[] = {1, 2, 3, 4};
+static const uint16_t sweepPreamble[] = {8, 12, 16, 32};
+static const int8_t sweepPower[] = {10, 14, 17, 20, 22};
+static const uint8_t sweepCad[] = {1, 2, 4, 8, 16};
+static const uint32_t sweepSleep[] = {10000, 30000, 60000, 120000, 300000};
+/** RX duty cycle listen / sleep time in ms, 0 / 0 is TX only */
+static const uint32_t sweepRx[][2] = {{0, 0}, {2, 10}, {2, 50}, {5, 100}, {10, 1000}};
+
+#define COUNT(x) (sizeof(x) / sizeof(x[0]))
+
+/** Link and traffic assumptions */
+static double distance = 2000.0;
+static double exponent = 2.7;
+static uint32_t neighbours = 4;
+
+/** Result of one configuration */
+typedef struct
+{
+	uint32_t index;
+	/** Average current in uA */
+	float current;
+	/** Uplink latency (wait for next wakeup + CAD + TX) plus downlink latency in ms */
+	float latency;
+	/** Probability a package arrives */
+	float delivery;
+} point_t;
+
+/**
+ * @brief Decode a sweep index into the node settings
+ */
+static node_config_t configFromIndex(uint32_t index)
+{
+	node_config_t config = nodeDefaultConfig();
+	config.spreadingFactor = sweepSf[index % COUNT(sweepSf)];
+	index /= COUNT(sweepSf);
+	config.bandwidth = sweepBw[index % COUNT(sweepBw)];
+	index /= COUNT(sweepBw);
+	config.codingRate = sweepCr[index % COUNT(sweepCr)];
+	index /= COUNT(sweepCr);
+	config.preambleLength = sweepPreamble[index % COUNT(sweepPreamble)];
+	index /= COUNT(sweepPreamble);
+	config.txPower = sweepPower[index % COUNT(sweepPower)];
+	index /= COUNT(sweepPower);
+	config.cadSymbols = sweepCad[index % COUNT(sweepCad)];
+	index /= COUNT(sweepCad);
+	config.sleepTime = sweepSleep[index % COUNT(sweepSleep)];
+	index /= COUNT(sweepSleep);
+	config.rxTime = sweepRx[index % COUNT(sweepRx)][0];
+	config.rxSleepTime = sweepRx[index % COUNT(sweepRx)][1];
+	config.txOnly = (config.rxTime == 0);
+	return config;
+}
+
+/**
+ * @brief Number of configurations in the sweep
+ */
+static uint32_t configCount(void)
+{
+	return COUNT(sweepSf) * COUNT(sweepBw) * COUNT(sweepCr) * COUNT(sweepPreamble) * COUNT(sweepPower) * COUNT(sweepCad) * COUNT(sweepSleep) * COUNT(sweepRx);
+}
+
+/**
+ * @brief Delivery ratio from link budget, collisions and missed CAD
+ */
+static double deliveryRatio(const node_config_t *config)
+{
+	// Sensitivity of the SX1262, -124dBm at SF7/125kHz, 2.5dB better per SF, 3dB worse per doubled bandwidth
+	double sensitivity = -124.0 - 2.5 * (config->spreadingFactor - 7) + 3.0 * config->bandwidth;
+	// Higher coding rate and longer preamble help a bit
+	sensitivity -= 0.5 * (config->codingRate - 1) + (config->preambleLength > 8 ? 0.5 : 0.0);
+	// Log distance path loss with 1m reference at the configured frequency
+	double lambda = 299792458.0 / config->frequency;
+	double pathLoss = 20.0 * log10(4.0 * M_PI / lambda) + 10.0 * exponent * log10(distance);
+	double margin = config->txPower - pathLoss - sensitivity;
+	double linkOk = 1.0 / (1.0 + exp(-margin));
+
+	// Pure ALOHA collisions with the neighbours, CAD avoids the ones that already started
+	double airtime = nodeTimeOnAir(config, config->payloadSize) / 1000.0;
+	double cadMiss = 0.4 / config->cadSymbols;
+	double load = neighbours * airtime / config->sleepTime;
+	double collisionFree = exp(-load * (1.0 + cadMiss));
+	return linkOk * collisionFree;
+}
+
+/**
+ * @brief Evaluate one configuration
+ */
+static point_t evaluate(uint32_t index)
+{
+	node_config_t config = configFromIndex(index);
+	energy_model_t model;
+	energyInit(&model);
+	// Every cycle of a configuration is the same, one is enough
+	nodeSimCycle(&config, &model, config.sleepTime);
+
+	point_t point;
+	point.index = index;
+	point.current = (float)((double)energyTotalCharge(&model) / (double)config.sleepTime);
+	double uplink = config.sleepTime / 2.0 + (nodeCadTime(&config) + nodeTimeOnAir(&config, config.payloadSize)) / 1000.0;
+	// Downlinks wait for the next listen window, TX only nodes only listen after their own uplink
+	double downlink = config.txOnly ? config.sleepTime / 2.0 : (config.rxTime + config.rxSleepTime) / 2.0;
+	point.latency = (float)(uplink + downlink);
+	point.delivery = (float)deliveryRatio(&config);
+	return point;
+}
+
+/**
+ * @brief True if a is at least as good as b in all metrics and better in one
+ */
+static bool dominates(const point_t &a, const point_t &b)
+{
+	bool notWorse = (a.current <= b.current) && (a.latency <= b.latency) && (a.delivery >= b.delivery);
+	bool better = (a.current < b.current) || (a.latency < b.latency) || (a.delivery > b.delivery);
+	return notWorse && better;
+}
+
+/**
+ * @brief Add a point to a Pareto front, drops the points it dominates
+ */
+static void addToFront(std::vector<point_t> &front, const point_t &point)
+{
+	for (size_t idx = 0; idx < front.size(); idx++)
+	{
+		if (dominates(front[idx], point))
+		{
+			return;
+		}
+	}
+	size_t keep = 0;
+	for (size_t idx = 0; idx < front.size(); idx++)
+	{
+		if (!dominates(point, front[idx]))
+		{
+			front[keep++] = front[idx];
+		}
+	}
+	front.resize(keep);
+	front.push_back(point);
+}
+
+/**
+ * @brief Run the sweep
+ *
+ * @param threads number of worker threads
+ * @return std::vector<point_t> the Pareto front
+ */
+static std::vector<point_t> sweep(unsigned threads)
+{
+	const uint32_t total = configCount();
+	const uint32_t chunk = 256;
+	std::atomic<uint32_t> next(0);
+	std::vector<std::vector<point_t> > fronts(threads);
+	std::vector<std::thread> workers;
+
+	// Each worker takes chunks of indices and keeps its own front, no locking in the hot path
+	for (unsigned worker = 0; worker < threads; worker++)
+	{
+		workers.push_back(std::thread([&, worker]() {
+			std::vector<point_t> &front = fronts[worker];
+			uint32_t start;
+			while ((start = next.fetch_add(chunk)) < total)
+			{
+				uint32_t end = std::min(start + chunk, total);
+				for (uint32_t index = start; index < end; index++)
+				{
+					addToFront(front, evaluate(index));
+				}
+			}
+		}));
+	}
+	for (size_t worker = 0; worker < workers.size(); worker++)
+	{
+		workers[worker].join();
+	}
+
+	std::vector<point_t> front;
+	for (size_t worker = 0; worker < fronts.size(); worker++)
+	{
+		for (size_t idx = 0; idx < fronts[worker].size(); idx++)
+		{
+			addToFront(front, fronts[worker][idx]);
+		}
+	}
+	// Sort by index first so the output does not depend on the number of threads
+	std::sort(front.begin(), front.end(), [](const point_t &a, const point_t &b) { return a.index < b.index; });
+	std::stable_sort(front.begin(), front.end(), [](const point_t &a, const point_t &b) { return a.current < b.current; });
+	return front;
+}
+
+/**
+ * @brief Measure the speedup for 1..N threads
+ */
+static void scaling(unsigned maxThreads)
+{
+	double single = 0.0;
+	for (unsigned threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		auto start = std::chrono::steady_clock::now();
+		sweep(threads);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (threads == 1)
+		{
+			single = seconds;
+		}
+		printf("%2u threads %7.3fs speedup %5.2f efficiency %3.0f%%\n", threads, seconds, single / seconds, 100.0 * single / seconds / threads);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned threads = std::thread::hardware_concurrency();
+	bool measureScaling = false;
+	if (threads == 0)
+	{
+		threads = 1;
+	}
+
+	for (int arg = 1; arg < argc; arg++)
+	{
+		double value;
+		if (strcmp(argv[arg], "scaling") == 0)
+		{
+			measureScaling = true;
+		}
+		else if (sscanf(argv[arg], "threads=%lf", &value) == 1)
+		{
+			threads = value < 1 ? 1 : (unsigned)value;
+		}
+		else if (sscanf(argv[arg], "distance=%lf", &value) == 1)
+		{
+			distance = value;
+		}
+		else if (sscanf(argv[arg], "exponent=%lf", &value) == 1)
+		{
+			exponent = value;
+		}
+		else if (sscanf(argv[arg], "neighbours=%lf", &value) == 1)
+		{
+			neighbours = (uint32_t)value;
+		}
+		else
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[arg]);
+			return 1;
+		}
+	}
+
+	if (measureScaling)
+	{
+		scaling(threads);
+		return 0;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<point_t> front = sweep(threads);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%u configurations, %u threads, %.3fs, %u on the Pareto front\n", configCount(), threads, seconds, (unsigned)front.size());
+
+	FILE *csv = fopen("sweep.csv", "w");
+	if (csv == NULL)
+	{
+		fprintf(stderr, "Cannot write sweep.csv\n");
+		return 1;
+	}
+	fprintf(csv, "current_ua,latency_ms,delivery,sf,bw,cr,preamble,power,cad,sleep_ms,rx_ms,rx_sleep_ms\n");
+	for (size_t idx = 0; idx < front.size(); idx++)
+	{
+		node_config_t config = configFromIndex(front[idx].index);
+		fprintf(csv, "%.1f,%.0f,%.4f,%d,%d,%d,%d,%d,%d,%lu,%lu,%lu\n", front[idx].current, front[idx].latency, front[idx].delivery,
+				config.spreadingFactor, config.bandwidth, config.codingRate, config.preambleLength, config.txPower,
+				config.cadSymbols, (unsigned long)config.sleepTime, (unsigned long)config.rxTime, (unsigned long)config.rxSleepTime);
+	}
+	fclose(csv);
+	return 0;
+}
@@ -0,0 +1,157 @@
+/**
+ * @file traceConv.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Convert the wake cycle trace from a captured log into Chrome / Perfetto trace JSON
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build:
+ *   g++ -O2 -o traceConv traceConv.cpp ../../PlatformIO/LoRa-DeepSleep/lib/wakeTrace/wakeTrace.cpp
+ *       -I../common -I../../PlatformIO/LoRa-DeepSleep/lib/wakeTrace
+ *
+ * Usage:
+ *   traceConv log.txt > trace.json
+ *   Open trace.json in https://ui.perfetto.dev or chrome://tracing
+ *   A summary of the wake durations is printed to stderr.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "traceLog.h"
+#include "wakeTrace.h"
+
+/** Track of a trace point in the viewer */
+#define TRACK_LOOP 1
+#define TRACK_RADIO 2
+#define TRACK_EVENTS 3
+
+static bool firstEvent = true;
+
+/**
+ * @brief Write a complete event ("X") or an instant event ("i")
+ */
+static void writeEvent(const char *name, int track, double start, double duration, const trace_record_t *record)
+{
+	printf("%s\n  {\"name\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,", firstEvent ? "" : ",", name, track, start);
+	if (duration >= 0.0)
+	{
+		printf("\"ph\":\"X\",\"dur\":%.3f,", duration);
+	}
+	else
+	{
+		printf("\"ph\":\"i\",\"s\":\"t\",");
+	}
+	printf("\"args\":{\"arg\":%d,\"data\":%d}}", record->arg, record->data);
+	firstEvent = false;
+}
+
+/**
+ * @brief Name the tracks
+ */
+static void writeTrackName(int track, const char *name)
+{
+	printf("%s\n  {\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", firstEvent ? "" : ",", track, name);
+	firstEvent = false;
+}
+
+int main(int argc, char **argv)
+{
+	FILE *file = stdin;
+	if (argc > 1)
+	{
+		file = fopen(argv[1], "r");
+		if (file == NULL)
+		{
+			fprintf(stderr, "Cannot open %s\n", argv[1]);
+			return 1;
+		}
+	}
+	std::vector<timed_record_t> timed = traceReconstructTime(traceReadLog(file));
+	if (file != stdin)
+	{
+		fclose(file);
+	}
+
+	printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	writeTrackName(TRACK_LOOP, "loop task");
+	writeTrackName(TRACK_RADIO, "radio");
+	writeTrackName(TRACK_EVENTS, "wakeup sources");
+
+	// Start of the open slices, negative if none is open
+	double wakeStart = -1.0;
+	double cadStart = -1.0;
+	double txStart = -1.0;
+	double timerWakeup = -1.0;
+	uint32_t wakes = 0;
+	double wakeSum = 0.0;
+	double wakeMax = 0.0;
+
+	for (size_t idx = 0; idx < timed.size(); idx++)
+	{
+		const trace_record_t *record = &timed[idx].record;
+		double time = timed[idx].time;
+		switch (record->event)
+		{
+		case TRACE_TIMER_WAKEUP:
+			timerWakeup = time;
+			writeEvent(traceEventName(record->event), TRACK_EVENTS, time, -1.0, record);
+			break;
+		case TRACE_LOOP_WAKE:
+			wakeStart = time;
+			if (timerWakeup >= 0.0)
+			{
+				writeEvent("Dispatch", TRACK_EVENTS, timerWakeup, time - timerWakeup, record);
+				timerWakeup = -1.0;
+			}
+			break;
+		case TRACE_LOOP_SLEEP:
+			if (wakeStart >= 0.0)
+			{
+				double duration = time - wakeStart;
+				writeEvent("Wake", TRACK_LOOP, wakeStart, duration, record);
+				wakes++;
+				wakeSum += duration;
+				wakeMax = duration > wakeMax ? duration : wakeMax;
+				wakeStart = -1.0;
+			}
+			break;
+		case TRACE_CAD_START:
+			cadStart = time;
+			break;
+		case TRACE_CAD_DONE:
+			if (cadStart >= 0.0)
+			{
+				writeEvent(record->arg ? "CAD busy" : "CAD free", TRACK_RADIO, cadStart, time - cadStart, record);
+				cadStart = -1.0;
+			}
+			break;
+		case TRACE_TX_START:
+			txStart = time;
+			break;
+		case TRACE_TX_DONE:
+		case TRACE_TX_TIMEOUT:
+			if (txStart >= 0.0)
+			{
+				writeEvent(record->event == TRACE_TX_DONE ? "TX" : "TX timeout", TRACK_RADIO, txStart, time - txStart, record);
+				txStart = -1.0;
+			}
+			break;
+		case TRACE_SEND_START:
+		case TRACE_BATTERY:
+			writeEvent(traceEventName(record->event), TRACK_LOOP, time, -1.0, record);
+			break;
+		default:
+			writeEvent(traceEventName(record->event), TRACK_RADIO, time, -1.0, record);
+			break;
+		}
+	}
+	printf("\n]}\n");
+
+	fprintf(stderr, "%u records, %u wakes, average awake %.0fus, longest %.0fus\n",
+			(unsigned)timed.size(), wakes, wakes ? wakeSum / wakes : 0.0, wakeMax);
+	return 0;
+}
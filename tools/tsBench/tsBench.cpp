@@ -0,0 +1,268 @@
+/**
+ * @file tsBench.cpp
+ * @author Bernd Giesecke (bernd.giesecke@rakwireless.com)
+ * @brief Ingest and range scan benchmark of the time-series store with a simulated fleet
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Build:
+ *   g++ -O2 -o tsBench tsBench.cpp -I../common
+ *
+ * Usage:
+ *   tsBench                        10 million samples of 256 nodes
+ *   samples=300000000              number of samples, each needs ~9 bytes on disk (2.7GB for 300 million)
+ *   devices=256                    nodes of the fleet
+ *   interval=10000 (ms)            send interval of the nodes
+ *   queries=1000                   random range queries of each kind
+ *   dir=/tmp/tsStore               store directory, existing node files in it are removed
+ *
+ * The nodes send in a fixed interval with some jitter, temperature, humidity, light and battery
+ * change in small random steps. The samples are appended in time order of the fleet, the same
+ * way tools/ingest stores them. Then the files are mapped and queried: a full scan of one column,
+ * one hour of one node, and min / max / mean of one node over a day with and without the block headers.
+ */
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "tsStore.h"
+
+/** Start of the simulated data, 2026-01-01 in ms since 1970 */
+#define START_TIME 1767225600000LL
+#define HOUR_MS (3600LL * 1000)
+#define DAY_MS (24 * HOUR_MS)
+
+/** Pseudo random numbers, the same on every run */
+static uint64_t randomState = 88172645463325252ULL;
+
+static uint32_t nextRandom(uint32_t range)
+{
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 7;
+	randomState ^= randomState << 17;
+	return (uint32_t)(randomState % range);
+}
+
+/**
+ * @brief Change a value by a random step and keep it inside its range
+ */
+static int64_t walk(int64_t value, int64_t step, int64_t low, int64_t high)
+{
+	value += (int64_t)nextRandom((uint32_t)(2 * step + 1)) - step;
+	return value < low ? low : (value > high ? high : value);
+}
+
+static double since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t samples = 10000000;
+	uint32_t devices = 256;
+	int64_t interval = 10000;
+	uint32_t queries = 1000;
+	const char *dir = "/tmp/tsStore";
+
+	for (int arg = 1; arg < argc; arg++)
+	{
+		char key[32];
+		char text[200];
+		if (sscanf(argv[arg], "%31[^=]=%199s", key, text) != 2)
+		{
+			fprintf(stderr, "Unknown argument %s\n", argv[arg]);
+			return 1;
+		}
+		if (strcmp(key, "samples") == 0)
+		{
+			samples = strtoull(text, NULL, 10);
+		}
+		else if (strcmp(key, "devices") == 0)
+		{
+			devices = (uint32_t)atol(text);
+		}
+		else if (strcmp(key, "interval") == 0)
+		{
+			interval = atol(text);
+		}
+		else if (strcmp(key, "queries") == 0)
+		{
+			queries = (uint32_t)atol(text);
+		}
+		else if (strcmp(key, "dir") == 0)
+		{
+			dir = argv[arg] + strlen("dir=");
+		}
+		else
+		{
+			fprintf(stderr, "Unknown key %s\n", key);
+			return 1;
+		}
+	}
+	if ((devices == 0) || (devices > 256) || (interval < 100) || (samples < devices))
+	{
+		fprintf(stderr, "Invalid settings\n");
+		return 1;
+	}
+	mkdir(dir, 0755);
+	for (uint32_t device = 0; device < 256; device++)
+	{
+		char path[512];
+		tsDevicePath(dir, (uint8_t)device, path, sizeof(path));
+		unlink(path);
+	}
+
+	// Ingest
+	std::vector<ts_writer_t> writer(devices);
+	std::vector<ts_sample_t> state(devices);
+	for (uint32_t device = 0; device < devices; device++)
+	{
+		if (!tsWriterOpen(&writer[device], dir, (uint8_t)device))
+		{
+			fprintf(stderr, "Cannot write to %s\n", dir);
+			return 1;
+		}
+		int64_t *value = state[device].value;
+		value[TS_TEMPERATURE] = 1500 + nextRandom(1500);
+		value[TS_HUMIDITY] = 4000 + nextRandom(3000);
+		value[TS_LIGHT] = nextRandom(10000);
+		value[TS_THRESHOLD] = 0x4B00;
+		value[TS_NODE_RSSI] = -80;
+		value[TS_BATTERY] = 4100;
+		value[TS_RSSI] = -70 - (int64_t)nextRandom(40);
+		value[TS_SNR] = 5;
+	}
+	auto start = std::chrono::steady_clock::now();
+	for (uint64_t count = 0; count < samples; count++)
+	{
+		uint32_t device = (uint32_t)(count % devices);
+		ts_sample_t *sample = &state[device];
+		int64_t *value = sample->value;
+		value[TS_TIME] = START_TIME + (int64_t)(count / devices) * interval + device * interval / devices + nextRandom(50);
+		value[TS_TEMPERATURE] = walk(value[TS_TEMPERATURE], 3, -2000, 5000);
+		value[TS_HUMIDITY] = walk(value[TS_HUMIDITY], 5, 0, 10000);
+		value[TS_LIGHT] = walk(value[TS_LIGHT], 20, 0, 65535);
+		value[TS_NODE_RSSI] = walk(value[TS_NODE_RSSI], 1, -130, -30);
+		value[TS_BATTERY] = (count / devices) % 64 == 0 ? walk(value[TS_BATTERY], 1, 3000, 4200) : value[TS_BATTERY];
+		value[TS_AGE] = 100 * nextRandom(3);
+		value[TS_RSSI] = walk(value[TS_RSSI], 2, -130, -30);
+		value[TS_SNR] = walk(value[TS_SNR], 1, -20, 12);
+		tsWriterAppend(&writer[device], sample);
+	}
+	uint64_t bytes = 0;
+	for (uint32_t device = 0; device < devices; device++)
+	{
+		tsWriterClose(&writer[device]);
+		bytes += writer[device].bytes;
+	}
+	double seconds = since(start);
+	int64_t span = (int64_t)(samples / devices) * interval;
+	printf("%llu samples of %u nodes over %.1f days\n", (unsigned long long)samples, devices, (double)span / DAY_MS);
+	printf("ingest      %8.3fs %8.1f M samples/s\n", seconds, samples / seconds / 1e6);
+	printf("store       %8.1f MB %8.2f bytes/sample (%u columns, %d bytes raw)\n", bytes / 1e6, (double)bytes / samples,
+		   TS_COLUMNS, (int)sizeof(ts_sample_t));
+
+	// Map all files
+	start = std::chrono::steady_clock::now();
+	std::vector<ts_reader_t> reader(devices);
+	for (uint32_t device = 0; device < devices; device++)
+	{
+		if (!tsReaderOpen(&reader[device], dir, (uint8_t)device))
+		{
+			fprintf(stderr, "Cannot read node %u\n", device);
+			return 1;
+		}
+	}
+	printf("open        %8.3fs\n", since(start));
+	uint64_t columnBytes[TS_COLUMNS] = {0};
+	for (uint32_t device = 0; device < devices; device++)
+	{
+		for (size_t block = 0; block < reader[device].block.size(); block++)
+		{
+			const ts_block_header_t *header = (const ts_block_header_t *)(reader[device].map + reader[device].block[block]);
+			for (uint8_t column = 0; column < TS_COLUMNS; column++)
+			{
+				columnBytes[column] += header->columnSize[column] & ~TS_RUNS;
+			}
+		}
+	}
+	printf("bytes/sample");
+	for (uint8_t column = 0; column < TS_COLUMNS; column++)
+	{
+		printf(" %s %.2f", tsColumnName(column), (double)columnBytes[column] / samples);
+	}
+	printf("\n");
+
+	// Full scan of one column
+	start = std::chrono::steady_clock::now();
+	uint64_t scanned = 0;
+	int64_t checksum = 0;
+	for (uint32_t device = 0; device < devices; device++)
+	{
+		scanned += tsScan(&reader[device], INT64_MIN, INT64_MAX, TS_TEMPERATURE, [&](int64_t, int64_t value) { checksum += value; });
+	}
+	seconds = since(start);
+	printf("full scan   %8.3fs %8.1f M samples/s of %s\n", seconds, scanned / seconds / 1e6, tsColumnName(TS_TEMPERATURE));
+	if (scanned != samples)
+	{
+		fprintf(stderr, "Scan found %llu samples\n", (unsigned long long)scanned);
+		return 1;
+	}
+
+	// One hour of one node
+	start = std::chrono::steady_clock::now();
+	scanned = 0;
+	for (uint32_t query = 0; query < queries; query++)
+	{
+		uint32_t device = nextRandom(devices);
+		int64_t from = START_TIME + (int64_t)nextRandom((uint32_t)(span / 1000)) * 1000;
+		scanned += tsScan(&reader[device], from, from + HOUR_MS, TS_HUMIDITY, [&](int64_t, int64_t value) { checksum += value; });
+	}
+	seconds = since(start);
+	printf("hour range  %8.1fus per query, %.0f samples per query\n", seconds * 1e6 / queries, (double)scanned / queries);
+
+	// Min / max / mean of a day, from the block headers and by scanning
+	double headerTime = 0;
+	double scanTime = 0;
+	uint64_t headerBlocks = 0;
+	uint64_t decodedBlocks = 0;
+	for (uint32_t query = 0; query < queries; query++)
+	{
+		uint32_t device = nextRandom(devices);
+		int64_t from = START_TIME + (int64_t)nextRandom((uint32_t)(span / 1000)) * 1000;
+		start = std::chrono::steady_clock::now();
+		ts_aggregate_t result = tsAggregate(&reader[device], from, from + DAY_MS, TS_BATTERY);
+		headerTime += since(start);
+		headerBlocks += result.headerBlocks;
+		decodedBlocks += result.decodedBlocks;
+
+		start = std::chrono::steady_clock::now();
+		ts_aggregate_t check = {0, INT64_MAX, INT64_MIN, 0, 0, 0};
+		tsScan(&reader[device], from, from + DAY_MS, TS_BATTERY, [&](int64_t, int64_t value) {
+			check.count++;
+			check.min = value < check.min ? value : check.min;
+			check.max = value > check.max ? value : check.max;
+			check.sum += value;
+		});
+		scanTime += since(start);
+		if ((check.count != result.count) || (check.sum != result.sum) || ((check.count != 0) && ((check.min != result.min) || (check.max != result.max))))
+		{
+			fprintf(stderr, "Aggregate of node %u differs from the scan\n", device);
+			return 1;
+		}
+	}
+	printf("day min/max %8.1fus per query with block headers (%.0f%% of the blocks from the header), %.1fus by scanning\n",
+		   headerTime * 1e6 / queries, 100.0 * headerBlocks / (headerBlocks + decodedBlocks + 1e-9), scanTime * 1e6 / queries);
+
+	for (uint32_t device = 0; device < devices; device++)
+	{
+		tsReaderClose(&reader[device]);
+	}
+	printf("checksum %lld\n", (long long)checksum);
+	return 0;
+}